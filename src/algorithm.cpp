@@ -1,513 +1,545 @@
-#include <qcanvas.h>
-#include <qvaluevector.h>
-#include <qmap.h>
-
-#include "geometry.h"
-#include "algorithm.h"
-#include "convex.h"
-
-void VoronoiAlgo::start()
-{ // {{{
-    calculate(pointList);
-} // }}}
-
-void VoronoiAlgo::calculate(QValueVector<DiagramPoint*> &pointSet)
-{ // {{{
-    QValueVector<DiagramPoint*> leftPointSet, rightPointSet;
-    int num;
-
-    /* Check for empty set */
-    if (pointSet.isEmpty())
-	return;
-
-    qDebug("-= enter calculate recursive function =-");
-    if ( (num = mapXAxis(pointSet)) == 1) {
-	if (pointSet.size() > 1)
-	    calHBisector(pointSet);
-	return;
-    } else {
-	split(pointSet, leftPointSet, rightPointSet);
-	calculate(leftPointSet);
-	calculate(rightPointSet);
-	qDebug("start merging ...");
-	merge(leftPointSet, rightPointSet, pointSet);
-	qDebug("end merging");
-	return;
-    }
-} // }}}
-
-int VoronoiAlgo::mapXAxis(const QValueVector<DiagramPoint*> &pointSet)
-{ // {{{
-    QValueVector<DiagramPoint*>::const_iterator it;
-    QMap<int, int> myMap;
-    for (it = pointSet.begin(); it!= pointSet.end(); it++)
-	myMap.insert((*it)->getX(), (*it)->getY());
-    qDebug("there are %d points map to X Axis.", myMap.size());
-    return myMap.size();
-} // }}}
-
-void VoronoiAlgo::calHBisector(QValueVector<DiagramPoint*> &pointSet)
-{ // {{{
-    for( unsigned int i=1; i<pointSet.size(); i++) {
-	DiagramBisector *bisector = new DiagramBisector(
-		DiagramLine(pointSet[i-1], pointSet[i], 
-		    canvasView->canvas()), 
-		canvasView->canvas());
-	edgeList.push_back(bisector);
-	qDebug("bisector between (%d,%d) - (%d,%d) is been added.", 
-		bisector->getLeftPoint()->getX(), 
-		bisector->getLeftPoint()->getY(), 
-		bisector->getRightPoint()->getX(), 
-		bisector->getRightPoint()->getY());
-    }
-    return;
-} // }}}
-
-void VoronoiAlgo::split(const QValueVector<DiagramPoint*> &pointSet, 
-	QValueVector<DiagramPoint*> &leftPointSet, 
-	QValueVector<DiagramPoint*> &rightPointSet)
-{ // {{{
-    unsigned int sum = 0; 
-    double center = 0;
-
-    for (unsigned int i=0; i<pointSet.size(); i++)
-	sum += pointSet[i]->getX();
-    center = sum/(double)pointSet.size();
-    qDebug("the center line is x= %f.",center);
-
-    for (unsigned int j=0; j<pointSet.size(); j++) {
-	if ((double)(pointSet[j]->getX()) <= center) {
-	    leftPointSet.push_back(pointSet[j]);
-	    qDebug("(%d,%d) split to leftPointSet.", 
-		    pointSet[j]->getX(), 
-		    pointSet[j]->getY());
-	} else {
-	    rightPointSet.push_back(pointSet[j]);
-	    qDebug("(%d,%d) split to rightPointSet.", 
-		    pointSet[j]->getX(), 
-		    pointSet[j]->getY());
-	}
-    }
-    return;
-} // }}}
-
-QPair<DiagramLine, DiagramLine> VoronoiAlgo::findBeginEndLine(
-	const QValueVector<DiagramPoint*> &leftPointSet, 
-	const QValueVector<DiagramPoint*> &rightPointSet)
-{ // {{{
-    DiagramPoint *point1, *point2, *point3, *point4;
-    ConvexHull leftConvex(leftPointSet);
-    ConvexHull rightConvex(rightPointSet);
-
-    bool isChanged = false;
-
-    leftConvex.rightMost();
-    rightConvex.leftMost();
-    do {
-	isChanged = false;
-	DiagramLine line(leftConvex.current(), rightConvex.current(), 
-		canvasView->canvas());
-	double a, b, c;
-	a = line.getA();	b = line.getB();	c = line.getC();
-
-	if (b < 0) {
-	    a *= (-1);	b *= (-1);	c *= (-1);
-	}
-
-	if (a*leftConvex.next()->getX() + b*leftConvex.next()->getY() < c) {
-	    leftConvex.forward();
-	    isChanged = true;
-	} else if (a*leftConvex.prev()->getX() + b*leftConvex.prev()->getY() < c) {
-	    leftConvex.backward();
-	    isChanged = true;
-	}
-	if (a*rightConvex.next()->getX() + b*rightConvex.next()->getY() < c) {
-	    rightConvex.forward();
-	    isChanged = true;
-	} else if (a*rightConvex.prev()->getX() + b*rightConvex.prev()->getY() < c) {
-	    rightConvex.backward();
-	    isChanged = true;
-	}
-    } while (isChanged);
-    point1 = leftConvex.current();	point2 = rightConvex.current();
-    
-    leftConvex.rightMost();
-    rightConvex.leftMost();
-    do {
-	isChanged = false;
-	DiagramLine line(leftConvex.current(), rightConvex.current(), 
-		canvasView->canvas());
-	double a, b, c;
-	a = line.getA();	b = line.getB();	c = line.getC();
-
-	if (b < 0) {
-	    a *= (-1);	b *= (-1);	c *= (-1);
-	}
-
-	if (a*leftConvex.next()->getX() + b*leftConvex.next()->getY() > c) {
-	    leftConvex.forward();
-	    isChanged = true;
-	} else if (a*leftConvex.prev()->getX() + b*leftConvex.prev()->getY() > c) {
-	    leftConvex.backward();
-	    isChanged = true;
-	}
-	if (a*rightConvex.next()->getX() + b*rightConvex.next()->getY() > c) {
-	    rightConvex.forward();
-	    isChanged = true;
-	} else if (a*rightConvex.prev()->getX() + b*rightConvex.prev()->getY() > c) {
-	    rightConvex.backward();
-	    isChanged = true;
-	}
-    } while (isChanged);
-    point3 = leftConvex.current();	point4 = rightConvex.current();
-
-
-    /* *BE CAREFUL* Easy to return a invalid memery address */
-    qDebug("BeginLine:(%d,%d)-(%d,%d), EndLine:(%d,%d)-(%d,%d).", 
-	    point1->getX(), point1->getY(), 
-	    point2->getX(), point2->getY(), 
-	    point3->getX(), point3->getY(), 
-	    point4->getX(), point4->getY()); 
-    return qMakePair(
-	    DiagramLine(point1, point2, 
-		canvasView->canvas()), 
-	    DiagramLine(point3, point4, 
-		canvasView->canvas()));
-} // }}}
-
-void VoronoiAlgo::merge(const QValueVector<DiagramPoint*> &leftPointSet, 
-	const QValueVector<DiagramPoint*> &rightPointSet, 
-	QValueVector<DiagramPoint*> &pointSet)
-{ // {{{
-    debug("merge size is %d:%d", leftPointSet.size(), rightPointSet.size());
-    DiagramBisector *curBisector = NULL;
-    QValueVector<DiagramBisector*> leftSetNeedCut, rightSetNeedCut;
-    QValueVector<DiagramBisector*> HPSet;
-    leftSetNeedCut.clear();	rightSetNeedCut.clear();
-    unsigned int bisectorCount = 0;
-
-    /* find the Begin and End lines which prepared to find HP */
-    QPair<DiagramLine, DiagramLine> foundLines(
-	    findBeginEndLine(leftPointSet, rightPointSet));
-
-    /* start find the HP from the upper common line */
-    curBisector = new DiagramBisector(
-	    DiagramLine(foundLines.first.getLeftPoint(), 
-		foundLines.first.getRightPoint(), 
-		canvasView->canvas()), 
-	    canvasView->canvas());
-    edgeList.push_back(curBisector);
-    curBisector->setHP(true);
-    HPSet.push_back(curBisector);
-    qDebug("first bisector between (%d,%d) - (%d,%d) is been added.", 
-	    curBisector->getLeftPoint()->getX(), 
-	    curBisector->getLeftPoint()->getY(), 
-	    curBisector->getRightPoint()->getX(), 
-	    curBisector->getRightPoint()->getY());
-
-    /* find out the others lien to construct HP */
-    while ( ! (curBisector->getLine() == foundLines.second)) {
-	int leftIntersectNum = 0, rightIntersectNum = 0;
-	double leftCandidatePointX = -1, leftCandidatePointY = -1;
-	double rightCandidatePointX = -1, rightCandidatePointY = -1;
-	DiagramBisector *leftCandidateBisector = NULL;
-	DiagramBisector *rightCandidateBisector = NULL;
-	DiagramPoint *leftPoint = NULL;
-	DiagramPoint *rightPoint = NULL;
-
-	if (curBisector->getLeftPoint()->getX() < 
-		curBisector->getRightPoint()->getX()) {
-	    leftPoint = curBisector->getLeftPoint();
-	    rightPoint = curBisector->getRightPoint();
-	} else {
-	    leftPoint = curBisector->getRightPoint();
-	    rightPoint = curBisector->getLeftPoint();
-	}
-
-
-	/* find out the left set intersect point with smallest y-value */
-	QValueVector<DiagramBisector*> &leftEdgeList = 
-	    leftPoint->getEdgeList();
-	if (!leftEdgeList.isEmpty()) {
-	    for (unsigned int i=0; i<leftEdgeList.size(); i++) {
-		if (curBisector->isIntersect(leftEdgeList[i]) && 
-			//!leftEdgeList[i]->hasCutter() && 
-			(leftEdgeList[i]->getCutter() == NULL || 
-			 !(leftEdgeList[i]->getComPoint(leftEdgeList[i]->getCutter()) 
-			 == curBisector->getRefPoint())) && 
-			!leftEdgeList[i]->isHP()) {  
-		    QPair<double, double> intersectPoint(
-			    curBisector->calIntersectPoint(
-				leftEdgeList[i]));
-		    if (leftIntersectNum == 0) {
-			if (*curBisector == *(HPSet[0]) || 
-				intersectPoint.second >= 
-				curBisector->getStartPoint().second) {
-			    leftIntersectNum++;
-			    leftCandidatePointX = intersectPoint.first;
-			    leftCandidatePointY = intersectPoint.second;
-			    leftCandidateBisector = leftEdgeList[i];
-			}
-		    } else {
-			leftIntersectNum++;
-			if ((*curBisector == *(HPSet[0]) || 
-				intersectPoint.second >= 
-				curBisector->getStartPoint().second) && 
-				intersectPoint.second < leftCandidatePointY) {
-			    leftCandidatePointX = intersectPoint.first;
-			    leftCandidatePointY = intersectPoint.second;
-			    leftCandidateBisector = leftEdgeList[i];
-			}
-		    }
-		}
-	    }
-	}
-
-	/* find out the right set intersect point with smallest y-value */
-	QValueVector<DiagramBisector*> &rightEdgeList = 
-	    rightPoint->getEdgeList();
-	if (!rightEdgeList.isEmpty()) {
-	    for (unsigned int i=0; i<rightEdgeList.size(); i++) {
-		if (curBisector->isIntersect(rightEdgeList[i]) && 
-			//!rightEdgeList[i]->hasCutter() && 
-			(rightEdgeList[i]->getCutter() == NULL || 
-			 !(rightEdgeList[i]->getComPoint(rightEdgeList[i]->getCutter()) 
-			 == curBisector->getRefPoint())) && 
-			!rightEdgeList[i]->isHP()) {  
-		    QPair<double, double> intersectPoint(
-			    curBisector->calIntersectPoint(
-				rightEdgeList[i]));
-		    if (rightIntersectNum == 0) {
-			if (*curBisector == *(HPSet[0]) || 
-				intersectPoint.second >= 
-				curBisector->getStartPoint().second) {
-			    rightIntersectNum++;
-			    rightCandidatePointX = intersectPoint.first;
-			    rightCandidatePointY = intersectPoint.second;
-			    rightCandidateBisector = rightEdgeList[i];
-			}
-		    } else {
-			rightIntersectNum++;
-			if ((*curBisector == *(HPSet[0]) || 
-				intersectPoint.second >= 
-				curBisector->getStartPoint().second) && 
-				intersectPoint.second < rightCandidatePointY) {
-			    rightCandidatePointX = intersectPoint.first;
-			    rightCandidatePointY = intersectPoint.second;
-			    rightCandidateBisector = rightEdgeList[i];
-			}
-		    }
-		}
-	    }
-	}
-
-	/* decide which point is the best intersect */
-	double candidatePointX = -1, candidatePointY = -1;
-	DiagramBisector* candidateBisector = NULL;
-	enum { LEFT = 0, RIGHT = 1 } dir = LEFT;  
-
-	if (leftIntersectNum > 0 && rightIntersectNum == 0) {
-	    candidatePointX = leftCandidatePointX;
-	    candidatePointY = leftCandidatePointY;
-	    candidateBisector = leftCandidateBisector;
-	    dir = LEFT;
-	} else if (leftIntersectNum == 0 && rightIntersectNum > 0) {
-	    candidatePointX = rightCandidatePointX;
-	    candidatePointY = rightCandidatePointY;
-	    candidateBisector = rightCandidateBisector;
-	    dir = RIGHT;
-	} else if (leftIntersectNum > 0 && rightIntersectNum > 0) {
-	    if (leftCandidatePointY < rightCandidatePointY) {
-		candidatePointX = leftCandidatePointX;
-		candidatePointY = leftCandidatePointY;
-		candidateBisector = leftCandidateBisector;
-		dir = LEFT;
-	    } else {
-		candidatePointX = rightCandidatePointX;
-		candidatePointY = rightCandidatePointY;
-		candidateBisector = rightCandidateBisector;
-		dir = RIGHT;
-	    }
-	} else {
-	    qFatal("Find the intersect failed when finding HP.");
-	}
-	qDebug("intersect with bisector of (%d,%d) - (%d,%d).", 
-		candidateBisector->getLeftPoint()->getX(), 
-		candidateBisector->getLeftPoint()->getY(), 
-		candidateBisector->getRightPoint()->getX(), 
-		candidateBisector->getRightPoint()->getY());
-
-	/* cut line with intersect point */
-	curBisector->endWithIntersect(candidatePointX, 
-		candidatePointY);
-	candidateBisector->addIntersectPoint(candidatePointX, 
-		candidatePointY, curBisector);
-	if ( dir == LEFT) {
-	    leftSetNeedCut.push_back(candidateBisector);
-	    candidateBisector->cutByIntersect(
-		    DiagramBisector::CUT_RIGHT);
-	} else {
-	    rightSetNeedCut.push_back(candidateBisector);
-	    candidateBisector->cutByIntersect(
-		    DiagramBisector::CUT_LEFT);
-	}
-
-	/* find the reference point */
-	DiagramPoint *refPoint = 
-	    curBisector->getComPoint(candidateBisector);
-	qDebug("refPoint(%d,%d)", 
-		refPoint->getX(), refPoint->getY());
-
-	/* find out two points to consturct the new bisector */
-	DiagramPoint *newLeftPoint = NULL;
-	DiagramPoint *newRightPoint = NULL;
-
-	if ( *(candidateBisector->getLeftPoint()) == *refPoint)
-	    newLeftPoint = candidateBisector->getRightPoint();
-	else
-	    newLeftPoint = candidateBisector->getLeftPoint();
-
-	if ( *(curBisector->getLeftPoint()) == *refPoint)
-	    newRightPoint = curBisector->getRightPoint();
-	else
-	    newRightPoint = curBisector->getLeftPoint();
-
-	/* add the new bisector */
-	bisectorCount++;
-	DiagramBisector *newBisector = new DiagramBisector(
-		DiagramLine(newLeftPoint, newRightPoint, 
-		    canvasView->canvas()), 
-		canvasView->canvas(), 
-		refPoint, 
-		candidatePointX, candidatePointY);
-	edgeList.push_back(newBisector);
-	newBisector->setHP(true);
-	HPSet.push_back(newBisector);
-	qDebug("New bisector between (%d,%d) - (%d,%d) is been added.", 
-		newBisector->getLeftPoint()->getX(), 
-		newBisector->getLeftPoint()->getY(), 
-		newBisector->getRightPoint()->getX(), 
-		newBisector->getRightPoint()->getY());
-
-	curBisector = newBisector;
-
-	if (bisectorCount > pointSet.size())
-	    qFatal("infinity loop in merge...");
-    }
-
-    /* clear the line existed at the right side */
-    for (unsigned int i=0; i<leftPointSet.size(); i++) {
-	QValueVector<DiagramBisector*> &edgeList = 
-	    leftPointSet[i]->getEdgeList();
-	for (unsigned int j=0; j<edgeList.size(); j++) {
-	    if (edgeList[j]->getLineType() != DiagramBisector::TWO_INF && 
-		    edgeList[j]->getCutter() == NULL && 
-		    edgeList[j]->isEnabled() && 
-		    !edgeList[j]->isHP()) {
-		double xValue = -1, yValue = -1;
-		double xAltValue = -1, yAltValue = -1;
-		if (edgeList[j]->getStartPoint().first < 
-			edgeList[j]->getEndPoint().first ||
-			!edgeList[j]->isStartPointINF()) {
-		    xValue = edgeList[j]->getStartPoint().first;
-		    yValue = edgeList[j]->getStartPoint().second;
-		    xAltValue = edgeList[j]->getEndPoint().first;
-		    yAltValue = edgeList[j]->getEndPoint().second;
-		} else {
-		    xValue = edgeList[j]->getEndPoint().first;
-		    yValue = edgeList[j]->getEndPoint().second;
-		    xAltValue = edgeList[j]->getStartPoint().first;
-		    yAltValue = edgeList[j]->getStartPoint().second;
-		}
-		for (unsigned int k=0; k<HPSet.size(); k++) {
-		    DiagramBisector *line = HPSet[k];
-		    if ((yValue <= line->getStartPoint().second && 
-				yValue >= line->getEndPoint().second) || 
-			    (yValue >= line->getStartPoint().second && 
-			     yValue <= line->getEndPoint().second)) {
-			double a = line->getA(),
-			       b = line->getB(),
-			       c = line->getC();
-			if (a < 0) {
-			    a*=(-1);	b*=(-1);	c*=(-1);
-			}
-			if (a*xValue + b*yValue > c || 
-				(a*xValue + b*yValue == c && 
-				 a*xAltValue + b*yAltValue > c)) {
-			    edgeList[j]->disable();
-			    qDebug("Disabled the bisector of (%d,%d) - (%d,%d).", 
-				    edgeList[j]->getLeftPoint()->getX(), 
-				    edgeList[j]->getLeftPoint()->getY(), 
-				    edgeList[j]->getRightPoint()->getX(), 
-				    edgeList[j]->getRightPoint()->getY());
-			    break;
-			}
-		    }
-		}
-	    }
-	}
-    }
-
-    /* clear the line existed at the left side */
-    for (unsigned int p=0; p<rightPointSet.size(); p++) {
-	QValueVector<DiagramBisector*> &edgeList = 
-	    rightPointSet[p]->getEdgeList();
-	for (unsigned int j=0; j<edgeList.size(); j++) {
-	    if (edgeList[j]->getLineType() != DiagramBisector::TWO_INF && 
-		    edgeList[j]->getCutter() == NULL && 
-		    edgeList[j]->isEnabled() && 
-		    !edgeList[j]->isHP()) {
-		double xValue = -1, yValue = -1;
-		double xAltValue = -1, yAltValue = -1;
-		if (edgeList[j]->getStartPoint().first > 
-			edgeList[j]->getEndPoint().first || 
-			!edgeList[j]->isStartPointINF()) {
-		    xValue = edgeList[j]->getStartPoint().first;
-		    yValue = edgeList[j]->getStartPoint().second;
-		    xAltValue = edgeList[j]->getEndPoint().first;
-		    yAltValue = edgeList[j]->getEndPoint().second;
-		} else {
-		    xValue = edgeList[j]->getEndPoint().first;
-		    yValue = edgeList[j]->getEndPoint().second;
-		    xAltValue = edgeList[j]->getStartPoint().first;
-		    yAltValue = edgeList[j]->getStartPoint().second;
-		}
-		for (unsigned int k=0; k<HPSet.size(); k++) {
-		    DiagramBisector *line = HPSet[k];
-		    if ((yValue <= line->getStartPoint().second && 
-				yValue >= line->getEndPoint().second) || 
-			    (yValue >= line->getStartPoint().second && 
-			     yValue <= line->getEndPoint().second)) {
-			double a = line->getA(),
-			       b = line->getB(),
-			       c = line->getC();
-			if (a < 0) {
-			    a*=(-1);	b*=(-1);	c*=(-1);
-			}
-			if (a*xValue + b*yValue < c || 
-				(a*xValue + b*yValue == c && 
-				 a*xAltValue + b*yAltValue < c)) {
-			    edgeList[j]->disable();
-			    qDebug("Disabled the bisector of (%d,%d) - (%d,%d).", 
-				    edgeList[j]->getLeftPoint()->getX(), 
-				    edgeList[j]->getLeftPoint()->getY(), 
-				    edgeList[j]->getRightPoint()->getX(), 
-				    edgeList[j]->getRightPoint()->getY());
-			    break;
-			}
-		    }
-		}
-	    }
-	}
-    }
-
-    /* clear the cutter */
-    for (unsigned int m=0; m<leftSetNeedCut.size(); m++)
-	leftSetNeedCut[m]->clearCutter();
-    for (unsigned int n=0; n<rightSetNeedCut.size(); n++)
-	rightSetNeedCut[n]->clearCutter();
-    /* clean HP flag */
-    for (unsigned int k=0; k<HPSet.size(); k++)
-	HPSet[k]->setHP(false);
-    return; 
-} // }}}
+#include <sys/time.h>
+
+#include <vector>
+#include <algorithm>
+
+#include "diagram.h"
+#include "algorithm.h"
+#include "convex.h"
+#include "taskpool.h"
+
+using namespace std;
+
+/* Runs one slice of the schedule; its edges go to the arena of its worker */
+class SliceTask : public VoronoiTask
+{
+    public:
+	SliceTask(VoronoiAlgo &algo, int slice)
+	    : algo(algo), slice(slice), result(false) {};
+	void run(int worker);
+	bool getResult() const { return result; };
+
+    private:
+	VoronoiAlgo &algo;
+	int slice;
+	bool result;
+};
+
+/* Runs the stages one after another, the slices of each as tasks */
+class TreeTask : public VoronoiTask
+{
+    public:
+	TreeTask(VoronoiAlgo &algo) : algo(algo), result(false) {};
+	void run(int worker) { result = algo.runStages(worker); };
+	bool getResult() const { return result; };
+
+    private:
+	VoronoiAlgo &algo;
+	bool result;
+};
+
+void SliceTask::run(int worker)
+{ // {{{
+    VoronoiAlgo::Context context;
+    context.worker = worker;
+    context.arena = (worker == 0) ? &algo.diagram.getArena() : 
+	algo.arenas[worker-1];
+    context.edges = new (context.arena->allocate(sizeof(IdArray))) 
+	IdArray(context.arena);
+    context.spare = new (context.arena->allocate(sizeof(IdArray))) 
+	IdArray(context.arena);
+    context.disabled = 0;
+    algo.sliceEdges[slice] = context.edges;
+    result = algo.runSlice(slice, context);
+} // }}}
+
+static double now()
+{ // {{{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+} // }}}
+
+VoronoiAlgo::VoronoiAlgo(VoronoiDiagram &diagram)
+    : diagram(diagram), threads(1), cutoff(DEFAULT_CUTOFF), pool(NULL), 
+    hulls(NULL)
+{ // {{{
+} // }}}
+
+VoronoiAlgo::~VoronoiAlgo()
+{ // {{{
+    delete pool;
+    for (unsigned int i=0; i<arenas.size(); i++)
+	delete arenas[i];
+} // }}}
+
+void VoronoiAlgo::setThreads(int count)
+{ // {{{
+    threads = (count < 1) ? TaskPool::processorCount() : count;
+} // }}}
+
+int VoronoiAlgo::getLevels() const
+{ // {{{
+    return tree.empty() ? 0 : tree.back().level + 1;
+} // }}}
+
+bool VoronoiAlgo::start()
+{ // {{{
+    buildTree();
+    buildSchedule();
+
+    bool result = false, done = false;
+    if (threads > 1 && stages.size() > 2) {
+	/* edges can't be added once the slots run out, so retry bigger */
+	for (int capacity = 4 * diagram.siteCount() + 16; ; capacity *= 2) {
+	    if (startParallel(capacity)) {
+		result = done = true;
+		break;
+	    }
+	    if (!diagram.isEdgeOverflow())
+		break;
+	}
+	/* leave the same partial diagram as a serial run would */
+    }
+    if (!done)
+	result = startSerial();
+
+    /* the merges leave the rays unclipped, one batch takes them all */
+    diagram.clipEdges();
+    return result;
+} // }}}
+
+void VoronoiAlgo::buildTree()
+{ // {{{
+    tree.clear();
+
+    /* the leaves, one for every run of sites sharing one x */
+    vector<int> level;
+    int count = diagram.siteCount();
+    for (int begin=0; begin<count; ) {
+	int end = begin + 1;
+	while (end < count && diagram.getX(end) == diagram.getX(begin))
+	    end++;
+	level.push_back(addNode(begin, VoronoiDiagram::NONE, end, 
+		    VoronoiDiagram::NONE, VoronoiDiagram::NONE, 0));
+	begin = end;
+    }
+
+    /* merge neighbours pairwise until one node is left */
+    for (int depth=1; level.size() > 1; depth++) {
+	vector<int> upper;
+	for (unsigned int i=0; i+1<level.size(); i+=2) {
+	    const MergeNode &left = tree[level[i]];
+	    const MergeNode &right = tree[level[i+1]];
+	    upper.push_back(addNode(left.begin, right.begin, right.end, 
+			level[i], level[i+1], depth));
+	}
+	if (level.size() % 2 != 0)
+	    upper.push_back(level.back());
+	level.swap(upper);
+    }
+} // }}}
+
+int VoronoiAlgo::addNode(int begin, int middle, int end, int left, 
+	int right, int level)
+{ // {{{
+    MergeNode node;
+    node.begin = begin;		node.middle = middle;	node.end = end;
+    node.left = left;		node.right = right;
+    node.parent = VoronoiDiagram::NONE;
+    node.level = level;
+    node.edges = 0;
+    node.seconds = 0;
+    tree.push_back(node);
+
+    int id = (int)tree.size() - 1;
+    if (left != VoronoiDiagram::NONE)
+	tree[left].parent = id;
+    if (right != VoronoiDiagram::NONE)
+	tree[right].parent = id;
+    return id;
+} // }}}
+
+void VoronoiAlgo::buildSchedule()
+{ // {{{
+    schedule.clear();
+    slices.clear();
+    stages.clear();
+
+    /*
+     * A block is the biggest subtree of at most cutoff sites (or a leaf
+     * bigger than that); its sites stay in cache while it is built.
+     */
+    int count = (int)tree.size();
+    vector<int> block(count, VoronoiDiagram::NONE);
+    vector<int> roots;
+    for (int i=count-1; i>=0; i--) {
+	const MergeNode &node = tree[i];
+	int parent = node.parent;
+	bool small = (node.end - node.begin <= cutoff || 
+		node.middle == VoronoiDiagram::NONE);
+	if (small && (parent == VoronoiDiagram::NONE || 
+		    tree[parent].end - tree[parent].begin > cutoff)) {
+	    block[i] = (int)roots.size();
+	    roots.push_back(i);
+	} else if (parent != VoronoiDiagram::NONE)
+	    block[i] = block[parent];
+    }
+
+    /* the roots were found right to left, the blocks run left to right */
+    vector< vector<int> > members(roots.size());
+    for (int j=0; j<count; j++) {
+	if (block[j] != VoronoiDiagram::NONE)
+	    members[roots.size() - 1 - block[j]].push_back(j);
+    }
+    stages.push_back(0);
+    for (unsigned int k=0; k<members.size(); k++) {
+	slices.push_back((int)schedule.size());
+	schedule.insert(schedule.end(), members[k].begin(), members[k].end());
+    }
+
+    /* above the blocks every node is a slice, every level a stage */
+    int level = -1;
+    for (int m=0; m<count; m++) {
+	if (block[m] != VoronoiDiagram::NONE)
+	    continue;
+	if (tree[m].level != level) {
+	    level = tree[m].level;
+	    stages.push_back((int)slices.size());
+	}
+	slices.push_back((int)schedule.size());
+	schedule.push_back(m);
+    }
+    slices.push_back((int)schedule.size());
+    stages.push_back((int)slices.size() - 1);
+} // }}}
+
+bool VoronoiAlgo::startSerial()
+{ // {{{
+    /* every run starts from an empty arena */
+    diagram.clearEdges();
+    diagram.reserveEdges(4 * diagram.siteCount() + 16);
+
+    ConvexHulls convex(diagram, &diagram.getArena());
+    hulls = &convex;
+
+    Context context;
+    context.worker = 0;
+    context.arena = &diagram.getArena();
+    context.edges = NULL;
+    context.spare = NULL;
+    context.disabled = 0;
+    bool result = true;
+    for (unsigned int i=0; i<schedule.size() && result; i++) {
+	result = runNode(schedule[i], context);
+
+	/*
+	 * The lines a merge takes out keep their slots, some ten for every
+	 * site by the end.  Once the slots fill up they go whenever they
+	 * are a quarter of the edges, which costs a pass over the edges
+	 * per quarter removed; the live ones keep their order.
+	 */
+	int total = diagram.edgeCount();
+	if (context.disabled > total / 4 && 
+		total > diagram.edgeCapacity() / 2) {
+	    diagram.compactEdges();
+	    context.disabled = 0;
+	}
+    }
+    if (context.disabled > 0)
+	diagram.compactEdges();
+    hulls = NULL;
+    return result;
+} // }}}
+
+bool VoronoiAlgo::startParallel(int capacity)
+{ // {{{
+    diagram.clearEdges();
+    diagram.reserveEdges(capacity);
+
+    if (pool == NULL) {
+	pool = new TaskPool(threads);
+	for (int i=1; i<threads; i++)
+	    arenas.push_back(new VoronoiArena);
+    }
+    for (unsigned int i=0; i<arenas.size(); i++)
+	arenas[i]->reset();
+
+    ConvexHulls convex(diagram, &diagram.getArena());
+    hulls = &convex;
+
+    VoronoiMutex edgeLock;
+    TreeTask task(*this);
+    sliceEdges.assign(slices.size() - 1, (IdArray *)NULL);
+    diagram.setEdgeLock(&edgeLock);
+    pool->execute(task);
+    diagram.setEdgeLock(NULL);
+    hulls = NULL;
+    if (!task.getResult())
+	return false;
+
+    /*
+     * The live edges, with the ids a serial run leaves them: in the order
+     * they were added, where a slot used twice counts by its last edge.
+     */
+    IdArray order(&diagram.getArena());
+    order.reserve(diagram.edgeCount());
+    vector<bool> seen(diagram.edgeCount(), false);
+    for (unsigned int j=sliceEdges.size(); j-->0; ) {
+	const IdArray &edges = *sliceEdges[j];
+	for (unsigned int k=edges.size(); k-->0; ) {
+	    int edge = edges[k];
+	    if (!seen[edge] && diagram.isEnabled(edge))
+		order.push_back(edge);
+	    seen[edge] = true;
+	}
+    }
+    reverse(order.begin(), order.end());
+    sliceEdges.clear();
+    diagram.reorderEdges(order);
+    return true;
+} // }}}
+
+bool VoronoiAlgo::runStages(int worker)
+{ // {{{
+    for (unsigned int i=0; i+1<stages.size(); i++) {
+	/* the tasks must stay put while the pool holds them */
+	vector<SliceTask> tasks;
+	tasks.reserve(stages[i+1] - stages[i]);
+	for (int slice=stages[i]; slice<stages[i+1]; slice++)
+	    tasks.push_back(SliceTask(*this, slice));
+	for (unsigned int j=0; j<tasks.size(); j++)
+	    pool->spawn(worker, &tasks[j]);
+
+	bool result = true;
+	for (unsigned int k=0; k<tasks.size(); k++) {
+	    pool->join(worker, &tasks[k]);
+	    result = result && tasks[k].getResult();
+	}
+	if (!result)
+	    return false;
+    }
+    return true;
+} // }}}
+
+bool VoronoiAlgo::runSlice(int slice, Context &context)
+{ // {{{
+    for (int i=slices[slice]; i<slices[slice+1]; i++) {
+	if (!runNode(schedule[i], context))
+	    return false;
+    }
+    return true;
+} // }}}
+
+bool VoronoiAlgo::runNode(int id, Context &context)
+{ // {{{
+    MergeNode &node = tree[id];
+    int before = (context.edges != NULL) ? (int)context.edges->size() : 
+	diagram.edgeCount();
+    double startTime = now();
+
+    bool result = true;
+    if (node.middle == VoronoiDiagram::NONE) {
+	hulls->makeSegment(node.begin, node.end);
+	if (node.end - node.begin > 1)
+	    result = calHBisector(node.begin, node.end, context);
+    } else
+	result = merge(node.begin, node.middle, node.end, context);
+
+    node.seconds = now() - startTime;
+    node.edges = ((context.edges != NULL) ? (int)context.edges->size() : 
+	    diagram.edgeCount()) - before;
+    return result;
+} // }}}
+
+int VoronoiAlgo::addEdge(Context &context, int leftSite, int rightSite, 
+	int refSite, double startX, double startY)
+{ // {{{
+    int edge;
+    if (context.spare != NULL && !context.spare->empty()) {
+	edge = diagram.reuseEdge(context.spare->back(), leftSite, rightSite,
+		refSite, startX, startY);
+	context.spare->pop_back();
+    } else
+	edge = diagram.addEdge(leftSite, rightSite, refSite, startX, startY);
+    if (edge != VoronoiDiagram::NONE && context.edges != NULL)
+	context.edges->push_back(edge);
+    return edge;
+} // }}}
+
+bool VoronoiAlgo::calHBisector(int begin, int end, Context &context)
+{ // {{{
+    for (int i=begin+1; i<end; i++) {
+	int edge = addEdge(context, i-1, i);
+	if (edge == VoronoiDiagram::NONE)
+	    return false;
+	diagram.linkEdge(edge, i-1, diagram.firstEdge(i-1));
+	diagram.linkEdge(edge, i, VoronoiDiagram::NONE);
+    }
+    return true;
+} // }}}
+
+void VoronoiAlgo::findBeginEndLine(int begin, int middle, 
+	int beginLine[2], int endLine[2])
+{ // {{{
+    /* the HP starts at the bridge of smallest y and ends at the other */
+    ConvexHulls::Bridges bridges;
+    hulls->findBridges(begin, middle, bridges);
+    beginLine[0] = hulls->site(begin, bridges.lowerLeft);
+    beginLine[1] = hulls->site(middle, bridges.lowerRight);
+    endLine[0] = hulls->site(begin, bridges.upperLeft);
+    endLine[1] = hulls->site(middle, bridges.upperRight);
+
+    /* the bridges are all the merged hull needs */
+    hulls->join(begin, middle, bridges);
+} // }}}
+
+int VoronoiAlgo::findCandidate(int left, int right, int curBisector, 
+	bool isLeft, Context &context)
+{ // {{{
+    /*
+     * The HP leaves the region of a site through the first edge after it
+     * in the ring of the site, counterclockwise on the left side and
+     * clockwise on the right side.  An edge whose next one reaches into
+     * the circle of its sites and the HP lies beyond the HP as a whole;
+     * it is removed on the way, which keeps the whole merge linear.
+     */
+    int site = isLeft ? left : right;
+    int candidate = isLeft ? diagram.nextEdge(site, curBisector) : 
+	diagram.prevEdge(site, curBisector);
+    if (candidate == curBisector || 
+	    diagram.orient(left, right, diagram.otherSite(candidate, site)) <= 0)
+	return VoronoiDiagram::NONE;
+
+    for (;;) {
+	int next = isLeft ? diagram.nextEdge(site, candidate) : 
+	    diagram.prevEdge(site, candidate);
+	if (next == curBisector || 
+		!diagram.inCircle(left, right, 
+		    diagram.otherSite(candidate, site), 
+		    diagram.otherSite(next, site)))
+	    break;
+	diagram.disable(candidate);
+	context.disabled++;
+	if (context.spare != NULL)
+	    context.spare->push_back(candidate);
+	candidate = next;
+    }
+
+    if (diagram.orient(left, right, diagram.otherSite(candidate, site)) <= 0)
+	return VoronoiDiagram::NONE;
+    return candidate;
+} // }}}
+
+bool VoronoiAlgo::merge(int begin, int middle, int end, Context &context)
+{ // {{{
+    int curBisector = VoronoiDiagram::NONE;
+    unsigned int bisectorCount = 0;
+
+    /* find the Begin and End lines which prepared to find HP */
+    int beginLine[2], endLine[2];
+    findBeginEndLine(begin, middle, beginLine, endLine);
+
+    /* start find the HP from the upper common line */
+    int leftPoint = beginLine[0], rightPoint = beginLine[1];
+    curBisector = addEdge(context, leftPoint, rightPoint);
+    if (curBisector == VoronoiDiagram::NONE)
+	return false;
+    diagram.linkEdge(curBisector, leftPoint, 
+	    diagram.findSlot(leftPoint, rightPoint));
+    diagram.linkEdge(curBisector, rightPoint, 
+	    diagram.findSlot(rightPoint, leftPoint));
+
+    /* find out the others lien to construct HP */
+    while (!diagram.hasSites(curBisector, endLine[0], endLine[1])) {
+	int leftCandidateBisector = findCandidate(leftPoint, rightPoint, 
+		curBisector, true, context);
+	int rightCandidateBisector = findCandidate(leftPoint, rightPoint, 
+		curBisector, false, context);
+
+	/* decide which point is the best intersect */
+	int candidateBisector = VoronoiDiagram::NONE;
+	enum { LEFT = 0, RIGHT = 1 } dir = LEFT;  
+
+	if (leftCandidateBisector != VoronoiDiagram::NONE && 
+		(rightCandidateBisector == VoronoiDiagram::NONE || 
+		 !diagram.inCircle(
+		     diagram.otherSite(leftCandidateBisector, leftPoint), 
+		     leftPoint, rightPoint, 
+		     diagram.otherSite(rightCandidateBisector, rightPoint)))) {
+	    candidateBisector = leftCandidateBisector;
+	    dir = LEFT;
+	} else if (rightCandidateBisector != VoronoiDiagram::NONE) {
+	    candidateBisector = rightCandidateBisector;
+	    dir = RIGHT;
+	} else {
+	    return false;	/* Find the intersect failed when finding HP */
+	}
+	/* from the sites; the line equations lose digits for large ones */
+	int thirdPoint = diagram.otherSite(candidateBisector, 
+		(dir == LEFT) ? leftPoint : rightPoint);
+	VoronoiCoord candidatePoint(
+		diagram.circumcenter(leftPoint, rightPoint, thirdPoint));
+	double candidatePointX = candidatePoint.first;
+	double candidatePointY = candidatePoint.second;
+
+	/* both lines end at the intersect point, on the side of their site */
+	diagram.cutByIntersect(curBisector, candidateBisector, 
+		candidatePointX, candidatePointY);
+	diagram.cutByIntersect(candidateBisector, curBisector, 
+		candidatePointX, candidatePointY);
+
+	/* find the reference point */
+	int refPoint = diagram.getComPoint(curBisector, candidateBisector);
+
+	/* find out two points to consturct the new bisector */
+	int newLeftPoint, newRightPoint;
+
+	if (diagram.getLeftPoint(candidateBisector) == refPoint)
+	    newLeftPoint = diagram.getRightPoint(candidateBisector);
+	else
+	    newLeftPoint = diagram.getLeftPoint(candidateBisector);
+
+	if (diagram.getLeftPoint(curBisector) == refPoint)
+	    newRightPoint = diagram.getRightPoint(curBisector);
+	else
+	    newRightPoint = diagram.getLeftPoint(curBisector);
+
+	/* add the new bisector */
+	bisectorCount++;
+	int newBisector = addEdge(context, newLeftPoint, newRightPoint, 
+		refPoint, candidatePointX, candidatePointY);
+	if (newBisector == VoronoiDiagram::NONE)
+	    return false;
+
+	/*
+	 * Around the site kept the new bisector comes right after the old
+	 * one, around the other site right after the crossed line; after
+	 * means counterclockwise on the left side and clockwise on the right.
+	 */
+	if (dir == LEFT) {
+	    diagram.linkEdge(newBisector, rightPoint, 
+		    diagram.prevEdge(rightPoint, curBisector));
+	    diagram.linkEdge(newBisector, newLeftPoint, candidateBisector);
+	    leftPoint = newLeftPoint;
+	} else {
+	    diagram.linkEdge(newBisector, leftPoint, curBisector);
+	    diagram.linkEdge(newBisector, newLeftPoint, 
+		    diagram.prevEdge(newLeftPoint, candidateBisector));
+	    rightPoint = newLeftPoint;
+	}
+
+	curBisector = newBisector;
+
+	/* every step closes a triangle of the dual, fewer than 2n of them */
+	if (bisectorCount > 2 * (unsigned int)(end - begin))
+	    return false;	/* infinity loop in merge */
+    }
+
+    /*
+     * Nothing is left to clear on either side: every line beyond the HP
+     * was taken out of the rings by findCandidate() when the walk passed
+     * it, so the pruning costs one step per line removed.
+     */
+    return true; 
+} // }}}
@@ -1,37 +1,100 @@
-#ifndef VORONOI_ALOG_H
-#define VORONOI_ALOG_H
-
-#include <qcanvas.h>
-#include "geometry.h"
-
-class VoronoiAlgo 
-{
-    public:
-	VoronoiAlgo(QValueVector<DiagramPoint*> &pointList, 
-		QValueVector<DiagramBisector*> &edgeList, 
-		DiagramView *canvasView)
-	    : pointList(pointList), edgeList(edgeList), canvasView(canvasView)
-	    {} ;
-	void start();
-
-    protected:
-	void calculate(QValueVector<DiagramPoint*> &pointSet);
-	int mapXAxis(const QValueVector<DiagramPoint*> &pointSet);
-	void calHBisector(QValueVector<DiagramPoint*> &pointSet);
-	void split(const QValueVector<DiagramPoint*> &pointSet, 
-		QValueVector<DiagramPoint*> &leftPointSet, 
-		QValueVector<DiagramPoint*> &rightPointSet);
-	QPair<DiagramLine, DiagramLine> findBeginEndLine(
-		const QValueVector<DiagramPoint*> &leftPointSet, 
-		const QValueVector<DiagramPoint*> &rightPointSet);
-	void merge(const QValueVector<DiagramPoint*> &leftPointSet, 
-		const QValueVector<DiagramPoint*> &rightPointSet, 
-		QValueVector<DiagramPoint*> &pointSet);
-
-    private:
-	QValueVector<DiagramPoint*> &pointList;
-	QValueVector<DiagramBisector*> &edgeList;
-	DiagramView  *canvasView;
-};
-
-#endif
+#ifndef VORONOI_ALOG_H
+#define VORONOI_ALOG_H
+
+#include <vector>
+#include <utility>
+
+#include "diagram.h"
+
+class TaskPool;
+class ConvexHulls;
+
+class VoronoiAlgo
+{
+    public:
+	enum { DEFAULT_CUTOFF = 1024 };
+
+	/*
+	 * A node of the merge tree.  The leaves are the runs of sites which
+	 * share one x; every other node merges the point sets of its two
+	 * children, [begin, middle) and [middle, end).
+	 */
+	struct MergeNode {
+	    int begin, middle, end;	/* middle is NONE for a leaf */
+	    int left, right, parent;	/* NONE where there is none */
+	    int level;			/* 0 for the leaves */
+	    int edges;			/* added by this node */
+	    double seconds;		/* spent on this node */
+	};
+
+	VoronoiAlgo(VoronoiDiagram &diagram);
+	~VoronoiAlgo();
+	/* 1 runs serially, 0 takes every processor */
+	void setThreads(int count);
+	/* subtrees of up to this many sites run as one cache-sized block */
+	void setCutoff(int sites) { cutoff = sites; };
+	bool start();
+	/* the tree of the last start(), level by level from the leaves up */
+	const std::vector<MergeNode> & getMergeTree() const { return tree; };
+	int getLevels() const;
+
+    protected:
+	/*
+	 * Where a node runs; edges and spare are NULL for a serial run.
+	 * A parallel run lists the edges each slice adds in edges, and
+	 * puts new edges into the slots of those it took out, in spare.
+	 */
+	struct Context {
+	    int worker;
+	    VoronoiArena *arena;
+	    IdArray *edges;
+	    IdArray *spare;
+	    int disabled;	/* edges taken out, for compacting */
+	};
+
+	/* a point set is the range [begin, end) of the sorted site ids */
+	int addEdge(Context &context, int leftSite, int rightSite,
+		int refSite = VoronoiDiagram::NONE,
+		double startX = -1, double startY = -1);
+	bool calHBisector(int begin, int end, Context &context);
+	void findBeginEndLine(int begin, int middle,
+		int beginLine[2], int endLine[2]);
+	int findCandidate(int left, int right, int curBisector, bool isLeft,
+		Context &context);
+	bool merge(int begin, int middle, int end, Context &context);
+
+    private:
+	friend class SliceTask;
+	friend class TreeTask;
+
+	void buildTree();
+	int addNode(int begin, int middle, int end, int left, int right,
+		int level);
+	void buildSchedule();
+	bool runNode(int node, Context &context);
+	bool runSlice(int slice, Context &context);
+	bool runStages(int worker);
+	bool startSerial();
+	bool startParallel(int capacity);
+
+	VoronoiDiagram &diagram;
+	int threads;
+	int cutoff;
+	TaskPool *pool;
+	ConvexHulls *hulls;	/* of the running start() */
+	std::vector<VoronoiArena *> arenas;	/* one per worker but 0 */
+
+	/*
+	 * The order of a serial run: the blocks one after another, each
+	 * one level by level, then the nodes above the blocks level by
+	 * level.  It is cut into slices which run on one worker each, and
+	 * the slices into stages whose slices may run at once.
+	 */
+	std::vector<MergeNode> tree;
+	std::vector<int> schedule;
+	std::vector<int> slices;	/* first schedule position, and the end */
+	std::vector<int> stages;	/* first slice, and the end */
+	std::vector<IdArray *> sliceEdges;	/* of a parallel run */
+};
+
+#endif
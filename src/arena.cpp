@@ -0,0 +1,112 @@
+#include <stdlib.h>
+#include <new>
+
+#include "arena.h"
+
+using namespace std;
+
+enum { ALIGNMENT = 16 };
+
+VoronoiArena::VoronoiArena(size_t blockSize)
+    : curBlock(0), curOffset(0), blockSize(blockSize),
+    bytes(0), largeBytes(0), allocations(0), reserved(0)
+{ // {{{
+} // }}}
+
+void *VoronoiArena::allocate(size_t size)
+{ // {{{
+    size = (size + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+    allocations++;
+
+    /* a large piece gets a block of its own, see deallocate() */
+    if (size >= blockSize) {
+	Block block;
+	block.data = (char *)malloc(size);
+	block.size = size;
+	if (block.data == NULL)
+	    throw bad_alloc();
+	large.push_back(block);
+	largeBytes += size;
+	reserved += size;
+	return block.data;
+    }
+    bytes += size;
+
+    /* skip the blocks which are too small for this request */
+    while (curBlock < blocks.size() &&
+	    curOffset + size > blocks[curBlock].size) {
+	curBlock++;
+	curOffset = 0;
+    }
+
+    if (curBlock == blocks.size()) {
+	/* grow geometrically so big runs need few blocks */
+	size_t newSize = blocks.empty() ? blockSize : blocks.back().size * 2;
+	if (newSize < size)
+	    newSize = size;
+	Block block;
+	block.data = (char *)malloc(newSize);
+	block.size = newSize;
+	if (block.data == NULL)
+	    throw bad_alloc();
+	blocks.push_back(block);
+	reserved += newSize;
+	curOffset = 0;
+    }
+
+    void *result = blocks[curBlock].data + curOffset;
+    curOffset += size;
+    return result;
+} // }}}
+
+void VoronoiArena::deallocate(void *piece, size_t size)
+{ // {{{
+    size = (size + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+    if (size < blockSize)
+	return;
+
+    /* the piece freed is most often one of the last allocated */
+    for (size_t i=large.size(); i-->0; ) {
+	if (large[i].data == piece) {
+	    free(piece);
+	    largeBytes -= large[i].size;
+	    reserved -= large[i].size;
+	    large[i] = large.back();
+	    large.pop_back();
+	    return;
+	}
+    }
+} // }}}
+
+void VoronoiArena::freeLarge()
+{ // {{{
+    for (unsigned int i=0; i<large.size(); i++) {
+	free(large[i].data);
+	reserved -= large[i].size;
+    }
+    large.clear();
+    largeBytes = 0;
+} // }}}
+
+void VoronoiArena::reset()
+{ // {{{
+    freeLarge();
+    curBlock = 0;
+    curOffset = 0;
+    bytes = 0;
+    allocations = 0;
+} // }}}
+
+void VoronoiArena::release()
+{ // {{{
+    reset();
+    for (unsigned int i=0; i<blocks.size(); i++)
+	free(blocks[i].data);
+    blocks.clear();
+    reserved = 0;
+} // }}}
+
+VoronoiArena::~VoronoiArena()
+{ // {{{
+    release();
+} // }}}
@@ -0,0 +1,96 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <new>
+#include <vector>
+
+/*
+ * Bump allocator for everything one calculation needs.  Small pieces are
+ * never given back one by one: reset() rewinds all blocks in one shot so
+ * the next run reuses them, release() returns the blocks to the system.
+ * Pieces of blockSize or more get a block of their own, which goes back
+ * to the system when the piece is deallocated or at reset(), so arrays
+ * that grow don't leave their old copies behind.
+ */
+class VoronoiArena
+{
+    public:
+	VoronoiArena(size_t blockSize = 64 * 1024);
+	~VoronoiArena();
+	void *allocate(size_t size);
+	/* a no-op but for large pieces */
+	void deallocate(void *piece, size_t size);
+	void reset();
+	void release();
+	size_t getBytes() const { return bytes + largeBytes; };
+	size_t getAllocations() const { return allocations; };
+	size_t getReserved() const { return reserved; };
+
+    private:
+	VoronoiArena(const VoronoiArena &);
+	VoronoiArena & operator=(const VoronoiArena &);
+
+	struct Block {
+	    char *data;
+	    size_t size;
+	};
+	void freeLarge();
+
+	std::vector<Block> blocks;
+	std::vector<Block> large;	/* pieces with a block of their own */
+	unsigned int curBlock;
+	size_t curOffset;
+	size_t blockSize;
+
+	size_t bytes;		/* handed out since the last reset */
+	size_t largeBytes;	/* in large pieces */
+	size_t allocations;	/* calls since the last reset */
+	size_t reserved;	/* held in blocks */
+};
+
+/* STL allocator drawing from a VoronoiArena */
+template <class T>
+class ArenaAllocator
+{
+    public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+	template <class U> struct rebind { typedef ArenaAllocator<U> other; };
+
+	ArenaAllocator(VoronoiArena *arena) : arena(arena) {};
+	template <class U> ArenaAllocator(const ArenaAllocator<U> &rhs)
+	    : arena(rhs.getArena()) {};
+	VoronoiArena *getArena() const { return arena; };
+
+	pointer allocate(size_type n, const void * = 0)
+	{ return (pointer)arena->allocate(n * sizeof(T)); };
+	void deallocate(pointer p, size_type n)
+	{ arena->deallocate(p, n * sizeof(T)); };
+	size_type max_size() const { return ((size_type)-1) / sizeof(T); };
+	pointer address(reference x) const { return &x; };
+	const_pointer address(const_reference x) const { return &x; };
+	void construct(pointer p, const T &value) { new ((void *)p) T(value); };
+	void destroy(pointer p) { p->~T(); };
+
+	template <class U> bool operator==(const ArenaAllocator<U> &rhs) const
+	{ return arena == rhs.getArena(); };
+	template <class U> bool operator!=(const ArenaAllocator<U> &rhs) const
+	{ return arena != rhs.getArena(); };
+
+    private:
+	VoronoiArena *arena;
+};
+
+/* std::vector living in a VoronoiArena */
+template <class T>
+struct ArenaVector {
+    typedef std::vector<T, ArenaAllocator<T> > type;
+};
+
+#endif
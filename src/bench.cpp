@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <vector>
+
+#include "clipper.h"
+
+using namespace std;
+
+/*
+ * voronoi-bench: times the ray clipping kernels against each other.
+ *
+ * The same random rays, from inside and around a box and in every
+ * direction, go through RayClipper::clipScalar() and RayClipper::clip()
+ * a number of rounds; the time per ray of both and the rays they
+ * disagree on are printed.
+ *
+ *	voronoi-bench [rays] [rounds]
+ */
+
+static double now()
+{ // {{{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+} // }}}
+
+int main(int argc, char **argv)
+{ // {{{
+    int count = (argc > 1) ? atoi(argv[1]) : 100000;
+    int rounds = (argc > 2) ? atoi(argv[2]) : 100;
+    if (count < 1 || rounds < 1) {
+	fprintf(stderr, "Usage: %s [rays] [rounds]\n", argv[0]);
+	return 2;
+    }
+
+    /* a tenth of the rays are axis-parallel, some start outside */
+    VoronoiBox box(0, 0, 640, 480);
+    vector<double> x(count), y(count), dx(count), dy(count);
+    srand(1);
+    for (int i=0; i<count; i++) {
+	x[i] = rand() % 960 - 160;
+	y[i] = rand() % 720 - 120;
+	dx[i] = (i % 20 == 0) ? 0 : rand() % 2001 - 1000;
+	dy[i] = (i % 20 == 10) ? 0 : rand() % 2001 - 1000;
+	if (dx[i] == 0 && dy[i] == 0)
+	    dx[i] = 1;
+    }
+
+    RayClipper clipper(box);
+    vector<double> scalarX(count), scalarY(count);
+    vector<double> vectorX(count), vectorY(count);
+
+    /* one round each untimed, for the caches and the comparison */
+    clipper.clipScalar(&x[0], &y[0], &dx[0], &dy[0], count,
+	    &scalarX[0], &scalarY[0]);
+    clipper.clip(&x[0], &y[0], &dx[0], &dy[0], count,
+	    &vectorX[0], &vectorY[0]);
+    double scalarStart = now();
+    for (int r=0; r<rounds; r++) {
+	clipper.clipScalar(&x[0], &y[0], &dx[0], &dy[0], count,
+		&scalarX[0], &scalarY[0]);
+    }
+    double scalarTime = now() - scalarStart;
+    double vectorStart = now();
+    for (int s=0; s<rounds; s++) {
+	clipper.clip(&x[0], &y[0], &dx[0], &dy[0], count,
+		&vectorX[0], &vectorY[0]);
+    }
+    double vectorTime = now() - vectorStart;
+
+    int differ = 0;
+    for (int j=0; j<count; j++) {
+	if (memcmp(&scalarX[j], &vectorX[j], sizeof(double)) != 0 ||
+		memcmp(&scalarY[j], &vectorY[j], sizeof(double)) != 0)
+	    differ++;
+    }
+    double rays = (double)count * rounds;
+    printf("%d rays, %d rounds\n", count, rounds);
+    printf("scalar: %.3f ns/ray\n", scalarTime / rays * 1e9);
+    printf("%s: %.3f ns/ray, %.2fx\n", RayClipper::kernel(),
+	    vectorTime / rays * 1e9, scalarTime / vectorTime);
+    printf("%d rays differ\n", differ);
+    return (differ == 0) ? 0 : 1;
+} // }}}
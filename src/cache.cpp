@@ -0,0 +1,381 @@
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "cache.h"
+#include "diagram.h"
+
+using namespace std;
+
+/*
+ * An entry: the header, the sites as int32 pairs, the live edges, and
+ * for every site the length of its ring and the edges in it, from its
+ * first edge on counterclockwise.  The numbers are in the byte order of
+ * the writer, which byteOrder tells.
+ */
+struct CacheHeader
+{
+    char magic[8];		/* "VORCACHE" */
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t options;
+    int32_t siteCount, edgeCount;
+    int32_t ringCount;		/* int32s of the rings */
+    uint64_t key;
+    double minX, minY, maxX, maxY;
+};
+
+struct CacheEdge
+{
+    int32_t left, right, ref;
+    uint32_t flags;		/* START_INF, END_INF */
+    double startX, startY, endX, endY;
+};
+
+enum {
+    CACHE_VERSION = 1,
+    CACHE_BYTE_ORDER = 0x01020304,
+    START_INF = 1,
+    END_INF = 2
+};
+
+static const char SUFFIX[] = ".vdc";
+/* Records that go to fread() and fwrite() at once */
+static const int BLOCK = 4096;
+
+static inline uint64_t mix(uint64_t hash, uint64_t word)
+{ // {{{
+    hash = (hash ^ word) * (((uint64_t)0x9e3779b9 << 32) | 0x7f4a7c15);
+    return hash ^ (hash >> 32);
+} // }}}
+
+static uint64_t bitsOf(double value)
+{ // {{{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+} // }}}
+
+VoronoiCache::VoronoiCache(const char *directory)
+    : directory(directory), maxBytes((uint64_t)1 << 30), maxEntries(256),
+    hits(0), misses(0), stores(0), evictions(0)
+{ // {{{
+    mkdir(directory, 0777);
+} // }}}
+
+uint64_t VoronoiCache::keyOf(const VoronoiDiagram &diagram,
+	unsigned int options)
+{ // {{{
+    const VoronoiBox &box = diagram.getBox();
+    uint64_t hash = mix(CACHE_VERSION, options);
+    hash = mix(hash, bitsOf(box.getMinX()));
+    hash = mix(hash, bitsOf(box.getMinY()));
+    hash = mix(hash, bitsOf(box.getMaxX()));
+    hash = mix(hash, bitsOf(box.getMaxY()));
+    hash = mix(hash, diagram.siteCount());
+    for (int site=0; site<diagram.siteCount(); site++) {
+	hash = mix(hash, (uint64_t)(uint32_t)diagram.getX(site) << 32 |
+		(uint32_t)diagram.getY(site));
+    }
+    return hash;
+} // }}}
+
+string VoronoiCache::pathOf(uint64_t key) const
+{ // {{{
+    char name[32];
+    sprintf(name, "/%08x%08x", (unsigned int)(key >> 32),
+	    (unsigned int)key);
+    return directory + name + SUFFIX;
+} // }}}
+
+bool VoronoiCache::load(VoronoiDiagram &diagram, unsigned int options)
+{ // {{{
+    uint64_t key = keyOf(diagram, options);
+    string path = pathOf(key);
+    if (!read(path, diagram, options, key)) {
+	diagram.clearEdges();
+	misses++;
+	return false;
+    }
+    /* the time of the last use, for evict() */
+    utime(path.c_str(), NULL);
+    hits++;
+    return true;
+} // }}}
+
+bool VoronoiCache::read(const string &path, VoronoiDiagram &diagram,
+	unsigned int options, uint64_t key)
+{ // {{{
+    FILE *in = fopen(path.c_str(), "rb");
+    if (in == NULL)
+	return false;
+
+    const VoronoiBox &box = diagram.getBox();
+    int sites = diagram.siteCount();
+    CacheHeader header;
+    bool good = fread(&header, sizeof(header), 1, in) == 1 &&
+	memcmp(header.magic, "VORCACHE", 8) == 0 &&
+	header.version == CACHE_VERSION &&
+	header.byteOrder == CACHE_BYTE_ORDER &&
+	header.options == options && header.key == key &&
+	header.siteCount == sites && header.edgeCount >= 0 &&
+	header.ringCount == sites + 2 * header.edgeCount &&
+	header.minX == box.getMinX() && header.minY == box.getMinY() &&
+	header.maxX == box.getMaxX() && header.maxY == box.getMaxY();
+
+    /* the same sites, not only the same key */
+    vector<int32_t> block;
+    for (int done=0; good && done<sites; done+=BLOCK) {
+	int count = min(BLOCK, sites - done);
+	block.resize(2 * count);
+	good = fread(&block[0], sizeof(int32_t), 2 * count, in) ==
+	    (size_t)(2 * count);
+	for (int i=0; good && i<count; i++) {
+	    good = block[2*i] == diagram.getX(done + i) &&
+		block[2*i+1] == diagram.getY(done + i);
+	}
+    }
+
+    int edges = good ? header.edgeCount : 0;
+    diagram.clearEdges();
+    diagram.reserveEdges(edges);
+    vector<CacheEdge> records;
+    for (int done=0; good && done<edges; done+=BLOCK) {
+	int count = min(BLOCK, edges - done);
+	records.resize(count);
+	good = fread(&records[0], sizeof(CacheEdge), count, in) ==
+	    (size_t)count;
+	for (int i=0; good && i<count; i++) {
+	    const CacheEdge &record = records[i];
+	    good = record.left >= 0 && record.left < sites &&
+		record.right >= 0 && record.right < sites &&
+		record.left != record.right &&
+		record.ref >= VoronoiDiagram::NONE && record.ref < sites;
+	    if (!good)
+		break;
+	    int edge = diagram.addEdge(record.left, record.right, record.ref);
+	    if (edge != done + i) {
+		good = false;
+		break;
+	    }
+	    diagram.setStart(edge, record.startX, record.startY,
+		    (record.flags & START_INF) != 0);
+	    diagram.setEnd(edge, record.endX, record.endY,
+		    (record.flags & END_INF) != 0);
+	}
+    }
+
+    /* every edge goes once into the ring of each of its sites */
+    vector<int32_t> rings(good ? header.ringCount : 0);
+    good = good && (rings.empty() || fread(&rings[0], sizeof(int32_t),
+		rings.size(), in) == rings.size());
+    vector<unsigned char> linked(edges, 0);
+    size_t next = 0;
+    for (int site=0; good && site<sites; site++) {
+	int length = rings[next++];
+	if (length < 0 || (size_t)length > rings.size() - next) {
+	    good = false;
+	    break;
+	}
+	int after = VoronoiDiagram::NONE;
+	for (int k=0; k<length; k++) {
+	    int edge = rings[next++];
+	    if (edge < 0 || edge >= edges) {
+		good = false;
+		break;
+	    }
+	    int side = (diagram.getLeftPoint(edge) == site) ? 1 :
+		(diagram.getRightPoint(edge) == site) ? 2 : 0;
+	    if (side == 0 || (linked[edge] & side) != 0) {
+		good = false;
+		break;
+	    }
+	    linked[edge] |= side;
+	    diagram.linkEdge(edge, site, after);
+	    after = edge;
+	}
+    }
+    for (int edge=0; good && edge<edges; edge++)
+	good = (linked[edge] == 3);
+    fclose(in);
+    return good;
+} // }}}
+
+bool VoronoiCache::store(const VoronoiDiagram &diagram, unsigned int options)
+{ // {{{
+    /* the live edges, renumbered in their order */
+    int sites = diagram.siteCount();
+    vector<int> newId(diagram.edgeCount(), VoronoiDiagram::NONE);
+    int edges = 0;
+    for (int edge=0; edge<diagram.edgeCount(); edge++) {
+	if (diagram.isEnabled(edge))
+	    newId[edge] = edges++;
+    }
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "VORCACHE", 8);
+    header.version = CACHE_VERSION;
+    header.byteOrder = CACHE_BYTE_ORDER;
+    header.options = options;
+    header.siteCount = sites;
+    header.edgeCount = edges;
+    header.ringCount = sites + 2 * edges;
+    header.key = keyOf(diagram, options);
+    header.minX = diagram.getBox().getMinX();
+    header.minY = diagram.getBox().getMinY();
+    header.maxX = diagram.getBox().getMaxX();
+    header.maxY = diagram.getBox().getMaxY();
+
+    /* renamed into place when complete */
+    string path = pathOf(header.key);
+    char suffix[32];
+    sprintf(suffix, ".%ld.tmp", (long)getpid());
+    string temporary = path + suffix;
+    FILE *out = fopen(temporary.c_str(), "wb");
+    if (out == NULL)
+	return false;
+    bool good = fwrite(&header, sizeof(header), 1, out) == 1;
+
+    vector<int32_t> block;
+    block.reserve(2 * BLOCK);
+    for (int site=0; good && site<sites; site++) {
+	block.push_back(diagram.getX(site));
+	block.push_back(diagram.getY(site));
+	if (block.size() == 2 * BLOCK || site == sites - 1) {
+	    good = fwrite(&block[0], sizeof(int32_t), block.size(), out) ==
+		block.size();
+	    block.clear();
+	}
+    }
+
+    vector<CacheEdge> records;
+    records.reserve(BLOCK);
+    for (int edge=0; good && edge<diagram.edgeCount(); edge++) {
+	if (newId[edge] != VoronoiDiagram::NONE) {
+	    CacheEdge record;
+	    record.left = diagram.getLeftPoint(edge);
+	    record.right = diagram.getRightPoint(edge);
+	    record.ref = diagram.getRefPoint(edge);
+	    record.flags = (diagram.isStartPointINF(edge) ? START_INF : 0) |
+		(diagram.isEndPointINF(edge) ? END_INF : 0);
+	    record.startX = diagram.getStartPoint(edge).first;
+	    record.startY = diagram.getStartPoint(edge).second;
+	    record.endX = diagram.getEndPoint(edge).first;
+	    record.endY = diagram.getEndPoint(edge).second;
+	    records.push_back(record);
+	}
+	if (!records.empty() && ((int)records.size() == BLOCK ||
+		    edge == diagram.edgeCount() - 1)) {
+	    good = fwrite(&records[0], sizeof(CacheEdge), records.size(),
+		    out) == records.size();
+	    records.clear();
+	}
+    }
+
+    int written = 0;
+    for (int site=0; good && site<sites; site++) {
+	/* the length goes first, so the ring is counted before */
+	int length = 0, first = diagram.firstEdge(site);
+	for (int edge=first; edge!=VoronoiDiagram::NONE; ) {
+	    length++;
+	    edge = diagram.nextEdge(site, edge);
+	    if (edge == first)
+		break;
+	}
+	block.push_back(length);
+	for (int edge=first; length>0; length--) {
+	    block.push_back(newId[edge]);
+	    edge = diagram.nextEdge(site, edge);
+	}
+	if ((int)block.size() >= 2 * BLOCK || site == sites - 1) {
+	    written += (int)block.size();
+	    good = fwrite(&block[0], sizeof(int32_t), block.size(), out) ==
+		block.size();
+	    block.clear();
+	}
+    }
+    /* rings that don't hold every live edge twice can't be read back */
+    good = good && written == header.ringCount;
+
+    if (fclose(out) != 0)
+	good = false;
+    if (!good || rename(temporary.c_str(), path.c_str()) != 0) {
+	int saved = errno;
+	unlink(temporary.c_str());
+	errno = saved;
+	return false;
+    }
+    stores++;
+    evict(path);
+    return true;
+} // }}}
+
+/* An entry of the directory, for evict() */
+struct CacheEntry
+{
+    bool kept;			/* just stored, evicted last */
+    struct timespec used;
+    uint64_t size;
+    string path;
+    bool operator<(const CacheEntry &other) const
+    {
+	if (kept != other.kept)
+	    return other.kept;
+	if (used.tv_sec != other.used.tv_sec)
+	    return used.tv_sec < other.used.tv_sec;
+	if (used.tv_nsec != other.used.tv_nsec)
+	    return used.tv_nsec < other.used.tv_nsec;
+	return path < other.path;
+    };
+};
+
+void VoronoiCache::evict(const string &kept)
+{ // {{{
+    DIR *dir = opendir(directory.c_str());
+    if (dir == NULL)
+	return;
+    vector<CacheEntry> entries;
+    uint64_t total = 0;
+    size_t suffix = strlen(SUFFIX);
+    struct dirent *item;
+    while ((item = readdir(dir)) != NULL) {
+	size_t length = strlen(item->d_name);
+	if (length != 16 + suffix ||
+		strcmp(item->d_name + 16, SUFFIX) != 0)
+	    continue;
+	CacheEntry entry;
+	entry.path = directory + "/" + item->d_name;
+	struct stat info;
+	if (stat(entry.path.c_str(), &info) != 0)
+	    continue;
+	/* to the nanosecond, so the order holds within a second */
+	entry.kept = (entry.path == kept);
+	entry.used = info.st_mtim;
+	entry.size = info.st_size;
+	total += entry.size;
+	entries.push_back(entry);
+    }
+    closedir(dir);
+
+    /* the least recently used first, and never the one just stored */
+    sort(entries.begin(), entries.end());
+    int count = (int)entries.size();
+    for (int i=0; i<(int)entries.size() && !entries[i].kept &&
+	    (total > maxBytes || count > maxEntries); i++) {
+	if (unlink(entries[i].path.c_str()) != 0)
+	    continue;
+	total -= entries[i].size;
+	count--;
+	evictions++;
+    }
+} // }}}
@@ -0,0 +1,65 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdint.h>
+
+#include <string>
+
+class VoronoiDiagram;
+
+/*
+ * Finished diagrams on disk, one file per set of sites, so that a run on
+ * sites seen before reads the edges back instead of computing them.
+ *
+ * The key hashes the sorted sites of the diagram, its box and the
+ * options of the run that change the edges: the engine, and for
+ * VoronoiAlgo the cutoff, which shapes the merge tree and so the order
+ * of the edges (the threads don't).  An entry holds the sites too and is only taken when they
+ * are the same, so a collision of keys costs a run and nothing else.
+ * A loaded diagram has the live edges of the stored one, in the same
+ * order, with the same ends and rings.
+ *
+ * Entries are written to a temporary file and renamed, so runs sharing
+ * the directory never see half an entry.  Taking an entry touches it,
+ * and storing one removes the least recently used ones until the
+ * directory is within the limits again.
+ */
+class VoronoiCache
+{
+    public:
+	enum { SWEEP = 1 };
+	/* the options of a run, the cutoff left out of a sweep */
+	static unsigned int optionsOf(bool sweep, int cutoff)
+	{ return sweep ? (unsigned int)SWEEP : (unsigned int)cutoff << 1; };
+
+	/* the directory is made if it isn't there */
+	VoronoiCache(const char *directory);
+	void setLimits(uint64_t bytes, int entries)
+	{ maxBytes = bytes; maxEntries = entries; };
+	/* of a diagram whose sites are sorted, with options or'ed together */
+	static uint64_t keyOf(const VoronoiDiagram &diagram,
+		unsigned int options);
+	/* the stored edges into diagram, false (and no edges) on a miss */
+	bool load(VoronoiDiagram &diagram, unsigned int options);
+	/* false if writing failed (see errno) */
+	bool store(const VoronoiDiagram &diagram, unsigned int options);
+
+	unsigned long getHits() const { return hits; };
+	unsigned long getMisses() const { return misses; };
+	unsigned long getStores() const { return stores; };
+	unsigned long getEvictions() const { return evictions; };
+
+    private:
+	std::string pathOf(uint64_t key) const;
+	bool read(const std::string &path, VoronoiDiagram &diagram,
+		unsigned int options, uint64_t key);
+	/* never the entry at kept */
+	void evict(const std::string &kept);
+
+	std::string directory;
+	uint64_t maxBytes;
+	int maxEntries;
+	unsigned long hits, misses, stores, evictions;
+};
+
+#endif
@@ -0,0 +1,338 @@
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "diagram.h"
+#include "algorithm.h"
+#include "fortune.h"
+#include "editor.h"
+#include "importer.h"
+
+using namespace std;
+
+/*
+ * voronoi-check: runs the engines against each other and against brute
+ * force, for the regression inputs in tests/ (see tests/check.sh).
+ *
+ * The sites of every file go through VoronoiAlgo, serially and then on
+ * one and four threads down to blocks of 16 sites, and through
+ * FortuneAlgo.  The two runs on small blocks have to give the same edges
+ * bit for bit, all of them the same pairs of neighbors; edges no longer
+ * than the rounding of their ends are left out of that, as four sites on
+ * a circle may have the diagonal or not.  For up to -n sites (2000 by
+ * default) every finite end is checked against all the sites: as far
+ * from the two sites of its edge as the rounding allows, and none nearer.
+ * Then -e edits (100 by default) insert, move and remove sites through
+ * VoronoiEditor, and the repaired diagram has to have the pairs of a new
+ * run on its sites.
+ *
+ * One line per file; the status is 1 if any check failed.
+ *
+ *	voronoi-check [-n sites] [-e edits] file...
+ */
+
+/* Relative to the magnitude of the coordinates */
+static const double TOLERANCE = 1e-9;
+
+/* Deep enough to merge on four threads even for small inputs */
+static const int SMALL_CUTOFF = 16;
+
+/* The sites of an edge by their coordinates, to match across runs */
+struct SitePair
+{
+    int coords[4];
+    bool operator<(const SitePair &other) const
+    {
+	return lexicographical_compare(coords, coords + 4,
+		other.coords, other.coords + 4);
+    };
+    bool operator==(const SitePair &other) const
+    { return equal(coords, coords + 4, other.coords); };
+};
+
+static VoronoiBox boundingBox(const VoronoiDiagram &diagram)
+{ // {{{
+    if (diagram.siteCount() == 0)
+	return VoronoiBox(0, 0, 0, 0);
+
+    double minX = diagram.getX(0), maxX = minX;
+    double minY = diagram.getY(0), maxY = minY;
+    for (int i=1; i<diagram.siteCount(); i++) {
+	minX = min(minX, (double)diagram.getX(i));
+	maxX = max(maxX, (double)diagram.getX(i));
+	minY = min(minY, (double)diagram.getY(i));
+	maxY = max(maxY, (double)diagram.getY(i));
+    }
+
+    /* as voronoi-cli does it */
+    double pad = max(max(maxX-minX, maxY-minY), 1.0) * 2;
+    return VoronoiBox(minX-pad, minY-pad, maxX+pad, maxY+pad);
+} // }}}
+
+static bool calculate(VoronoiDiagram &diagram, int threads, int cutoff)
+{ // {{{
+    diagram.sortSites();
+    VoronoiAlgo algorithm(diagram);
+    algorithm.setThreads(threads);
+    algorithm.setCutoff(cutoff);
+    return algorithm.start();
+} // }}}
+
+static bool sweep(VoronoiDiagram &diagram)
+{ // {{{
+    diagram.sortSites();
+    FortuneAlgo fortune(diagram);
+    return fortune.start();
+} // }}}
+
+static double scaleOf(const VoronoiDiagram &diagram, int edge)
+{ // {{{
+    double scale = 1;
+    int sites[2] = { diagram.getLeftPoint(edge),
+	diagram.getRightPoint(edge) };
+    for (int i=0; i<2; i++) {
+	scale = max(scale, fabs((double)diagram.getX(sites[i])));
+	scale = max(scale, fabs((double)diagram.getY(sites[i])));
+    }
+    VoronoiCoord ends[2] = { diagram.getStartPoint(edge),
+	diagram.getEndPoint(edge) };
+    for (int j=0; j<2; j++)
+	scale = max(scale, max(fabs(ends[j].first), fabs(ends[j].second)));
+    return scale;
+} // }}}
+
+static void pairsOf(const VoronoiDiagram &diagram, vector<SitePair> &pairs)
+{ // {{{
+    pairs.clear();
+    for (int edge=0; edge<diagram.edgeCount(); edge++) {
+	if (!diagram.isEnabled(edge))
+	    continue;
+	VoronoiCoord start = diagram.getStartPoint(edge);
+	VoronoiCoord end = diagram.getEndPoint(edge);
+	if (hypot(start.first - end.first, start.second - end.second) <=
+		TOLERANCE * scaleOf(diagram, edge))
+	    continue;
+
+	int a = diagram.getLeftPoint(edge), b = diagram.getRightPoint(edge);
+	if (!diagram.siteLess(a, b))
+	    swap(a, b);
+	SitePair pair;
+	pair.coords[0] = diagram.getX(a);
+	pair.coords[1] = diagram.getY(a);
+	pair.coords[2] = diagram.getX(b);
+	pair.coords[3] = diagram.getY(b);
+	pairs.push_back(pair);
+    }
+    sort(pairs.begin(), pairs.end());
+} // }}}
+
+static bool samePairs(const VoronoiDiagram &one, const VoronoiDiagram &two)
+{ // {{{
+    vector<SitePair> first, second;
+    pairsOf(one, first);
+    pairsOf(two, second);
+    return first == second;
+} // }}}
+
+static bool sameEdges(const VoronoiDiagram &one, const VoronoiDiagram &two)
+{ // {{{
+    if (one.edgeCount() != two.edgeCount())
+	return false;
+    for (int edge=0; edge<one.edgeCount(); edge++) {
+	if (one.isEnabled(edge) != two.isEnabled(edge) ||
+		one.getLeftPoint(edge) != two.getLeftPoint(edge) ||
+		one.getRightPoint(edge) != two.getRightPoint(edge) ||
+		one.getRefPoint(edge) != two.getRefPoint(edge) ||
+		one.getStartPoint(edge) != two.getStartPoint(edge) ||
+		one.getEndPoint(edge) != two.getEndPoint(edge) ||
+		one.isStartPointINF(edge) != two.isStartPointINF(edge) ||
+		one.isEndPointINF(edge) != two.isEndPointINF(edge))
+	    return false;
+    }
+    return true;
+} // }}}
+
+static bool checkEnd(const VoronoiDiagram &diagram, int edge,
+	const VoronoiCoord &end)
+{ // {{{
+    int a = diagram.getLeftPoint(edge), b = diagram.getRightPoint(edge);
+    double x = end.first, y = end.second;
+    double toA = hypot(x - diagram.getX(a), y - diagram.getY(a));
+    double toB = hypot(x - diagram.getX(b), y - diagram.getY(b));
+    double slack = TOLERANCE * scaleOf(diagram, edge);
+    if (fabs(toA - toB) > slack)
+	return false;
+    for (int site=0; site<diagram.siteCount(); site++) {
+	if (hypot(x - diagram.getX(site), y - diagram.getY(site)) <
+		toA - slack)
+	    return false;
+    }
+    return true;
+} // }}}
+
+static bool checkVertices(const VoronoiDiagram &diagram)
+{ // {{{
+    for (int edge=0; edge<diagram.edgeCount(); edge++) {
+	if (!diagram.isEnabled(edge))
+	    continue;
+	if (!diagram.isStartPointINF(edge) &&
+		!checkEnd(diagram, edge, diagram.getStartPoint(edge)))
+	    return false;
+	if (!diagram.isEndPointINF(edge) &&
+		!checkEnd(diagram, edge, diagram.getEndPoint(edge)))
+	    return false;
+    }
+    return true;
+} // }}}
+
+/* The same random numbers on every machine */
+static unsigned int nextRandom(unsigned long long &state)
+{ // {{{
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (unsigned int)(state >> 32);
+} // }}}
+
+static int randomIn(unsigned long long &state, int low, int high)
+{ // {{{
+    long long span = (long long)high - low + 1;
+    return (int)(low + (long long)(nextRandom(state) % span));
+} // }}}
+
+/* The edits on a serial run, then a new run on the sites left */
+static const char *checkEditor(const VoronoiDiagram &sites, int edits)
+{ // {{{
+    VoronoiDiagram edited(sites.getBox());
+    for (int i=0; i<sites.siteCount(); i++)
+	edited.addSite(sites.getX(i), sites.getY(i));
+    if (!calculate(edited, 1, VoronoiAlgo::DEFAULT_CUTOFF))
+	return "calculation failed before the edits";
+
+    /* within the sites, on the coordinates they use most of the time */
+    int minX = sites.getX(0), maxX = minX;
+    int minY = sites.getY(0), maxY = minY;
+    for (int j=1; j<sites.siteCount(); j++) {
+	minX = min(minX, sites.getX(j));	maxX = max(maxX, sites.getX(j));
+	minY = min(minY, sites.getY(j));	maxY = max(maxY, sites.getY(j));
+    }
+    unsigned long long state = 1;
+    VoronoiEditor editor(edited);
+    for (int k=0; k<edits; k++) {
+	int count = edited.siteCount();
+	int site = randomIn(state, 0, count - 1);
+	int other = randomIn(state, 0, count - 1);
+	int x = randomIn(state, minX, maxX);
+	int y = randomIn(state, minY, maxY);
+	if (nextRandom(state) % 2 == 0) {
+	    x = edited.getX(other);
+	    y = edited.getY(site);
+	}
+	switch (k % 3) {
+	    case 0:
+		editor.insertSite(x, y);
+		break;
+	    case 1:
+		editor.moveSite(site, x, y);
+		break;
+	    default:
+		if (count > 1)
+		    editor.removeSite(site);
+	}
+    }
+
+    VoronoiDiagram fresh(sites.getBox());
+    for (int m=0; m<edited.siteCount(); m++)
+	fresh.addSite(edited.getX(m), edited.getY(m));
+    if (!calculate(fresh, 1, VoronoiAlgo::DEFAULT_CUTOFF))
+	return "calculation failed after the edits";
+    if (!samePairs(edited, fresh))
+	return "the edits give other neighbors than a new run";
+    return NULL;
+} // }}}
+
+static const char *checkFile(const char *path, int bruteLimit, int edits,
+	int &siteCount, int &edgeCount)
+{ // {{{
+    SiteImporter importer;
+    if (!importer.import(path))
+	return (importer.getErrorOffset() == -1) ? strerror(errno) :
+	    "malformed input";
+
+    VoronoiDiagram serial(VoronoiBox(0, 0, 0, 0));
+    const int *x = importer.getX(), *y = importer.getY();
+    for (int i=0; i<importer.siteCount(); i++)
+	serial.addSite(x[i], y[i]);
+    serial.setBox(boundingBox(serial));
+    VoronoiDiagram blocks(serial.getBox()), parallel(serial.getBox());
+    VoronoiDiagram fortune(serial.getBox());
+    for (int j=0; j<serial.siteCount(); j++) {
+	blocks.addSite(serial.getX(j), serial.getY(j));
+	parallel.addSite(serial.getX(j), serial.getY(j));
+	fortune.addSite(serial.getX(j), serial.getY(j));
+    }
+    siteCount = serial.siteCount();
+    edgeCount = 0;
+
+    if (!calculate(serial, 1, VoronoiAlgo::DEFAULT_CUTOFF))
+	return "calculation failed";
+    if (!calculate(blocks, 1, SMALL_CUTOFF))
+	return "calculation failed on small blocks";
+    if (!calculate(parallel, 4, SMALL_CUTOFF))
+	return "calculation failed on four threads";
+    if (!sweep(fortune))
+	return "the sweep failed";
+    for (int edge=0; edge<serial.edgeCount(); edge++)
+	edgeCount += serial.isEnabled(edge) ? 1 : 0;
+
+    /* the cutoff shapes the merge tree, and with it the edge order */
+    if (!sameEdges(blocks, parallel))
+	return "other edges on four threads than on one";
+    if (!samePairs(serial, blocks))
+	return "other neighbors on small blocks";
+    if (!samePairs(serial, fortune))
+	return "other neighbors from the sweep";
+    if (siteCount <= bruteLimit &&
+	    (!checkVertices(serial) || !checkVertices(fortune)))
+	return "a vertex with a site nearer than those of its edge";
+    if (siteCount > 0 && edits > 0)
+	return checkEditor(serial, edits);
+    return NULL;
+} // }}}
+
+int main(int argc, char **argv)
+{ // {{{
+    int bruteLimit = 2000, edits = 100;
+    int argi = 1;
+    for (; argi + 1 < argc && argv[argi][0] == '-'; argi += 2) {
+	if (strcmp(argv[argi], "-n") == 0)
+	    bruteLimit = atoi(argv[argi+1]);
+	else if (strcmp(argv[argi], "-e") == 0)
+	    edits = atoi(argv[argi+1]);
+	else
+	    break;
+    }
+    if (argi >= argc || argv[argi][0] == '-') {
+	fprintf(stderr, "Usage: %s [-n sites] [-e edits] file...\n",
+		argv[0]);
+	return 2;
+    }
+
+    int failed = 0;
+    for (; argi<argc; argi++) {
+	int sites = 0, edges = 0;
+	errno = 0;
+	const char *error = checkFile(argv[argi], bruteLimit, edits,
+		sites, edges);
+	if (error != NULL) {
+	    fprintf(stderr, "%s: %s\n", argv[argi], error);
+	    failed++;
+	} else
+	    printf("%s: %d sites, %d edges: ok\n", argv[argi], sites,
+		    edges);
+    }
+    return (failed == 0) ? 0 : 1;
+} // }}}
@@ -0,0 +1,363 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include "diagram.h"
+#include "algorithm.h"
+#include "fortune.h"
+#include "dcel.h"
+#include "locator.h"
+#include "importer.h"
+#include "diagwriter.h"
+#include "exporter.h"
+#include "cache.h"
+
+using namespace std;
+
+/*
+ * voronoi-cli: headless driver for the divide-and-conquer algorithm, or
+ * with -f for Fortune's sweep.
+ *
+ * Reads "x y" or "x,y" integer pairs (one site per line), or packed 32-bit
+ * pairs, through SiteImporter and writes one line per Voronoi edge:
+ *	leftX leftY rightX rightY startX startY endX endY infinityEnds
+ *
+ * With -s the arena usage of the run and the predicates the floating
+ * point filter couldn't decide are reported on stderr.  -j runs the
+ * import and the halves of the divide-and-conquer on that many threads
+ * (0 for one per processor), down to point sets of -c sites; -j doesn't
+ * change the output, -c may change the order of the edges.
+ * -t prints the merge tree level by level on stderr.  -d writes the
+ * Delaunay triangulation instead of the edges, one line per Voronoi
+ * vertex with the sites around it counterclockwise:
+ *	x1 y1 x2 y2 x3 y3 ...
+ * -q reads "x y" query points from a file instead and writes the site
+ * whose cell holds each of them, on -j threads:
+ *	x y siteX siteY
+ * -m writes the diagram as a binary diagram file (see diagfile.h) instead,
+ * and -a adds the ring of edges around every site to it.
+ * -e writes the sites and the edges as svg or geojson instead, clipped
+ * to the box of -x (the box of the diagram by default); -p adds the
+ * cells.
+ * -C keeps finished diagrams in a directory (see cache.h) and reads the
+ * edges back from it when the same sites come again, within -l megabytes
+ * (1024 by default); -s reports the hits and misses.  -t doesn't use it.
+ */
+
+static void usage(const char *name)
+{ // {{{
+    fprintf(stderr, "Usage: %s [-s] [-t] [-f] [-d] [-m] [-a] [-j threads] "
+	    "[-c cutoff] [-b minX minY maxX maxY] [-q queries] "
+	    "[-e svg|geojson [-p] [-x minX minY maxX maxY]] "
+	    "[-C cache [-l megabytes]] [input [output]]\n", name);
+    exit(2);
+} // }}}
+
+static bool readSites(const char *path, VoronoiDiagram &diagram,
+	int threads)
+{ // {{{
+    SiteImporter importer;
+    importer.setThreads(threads);
+    bool done;
+    if (path != NULL)
+	done = importer.import(path);
+    else {
+	/* a pipe can't be mapped, so stdin is read into memory first */
+	vector<char> input;
+	char buffer[65536];
+	size_t n;
+	while ((n = fread(buffer, 1, sizeof(buffer), stdin)) > 0)
+	    input.insert(input.end(), buffer, buffer + n);
+	done = importer.parse(input.empty() ? NULL : &input[0], input.size());
+    }
+    if (!done) {
+	const char *name = (path != NULL) ? path : "stdin";
+	if (importer.getErrorOffset() == -1)
+	    perror(name);
+	else
+	    fprintf(stderr, "%s: malformed input at byte %ld\n", name,
+		    importer.getErrorOffset());
+	return false;
+    }
+
+    /* duplicated sites are dropped on the way in */
+    const int *x = importer.getX(), *y = importer.getY();
+    for (int i=0; i<importer.siteCount(); i++)
+	diagram.addSite(x[i], y[i]);
+    return true;
+} // }}}
+
+static VoronoiBox boundingBox(VoronoiDiagram &diagram)
+{ // {{{
+    if (diagram.siteCount() == 0)
+	return VoronoiBox(0, 0, 0, 0);
+
+    double minX = diagram.getX(0), maxX = minX;
+    double minY = diagram.getY(0), maxY = minY;
+    for (int i=1; i<diagram.siteCount(); i++) {
+	minX = min(minX, (double)diagram.getX(i));
+	maxX = max(maxX, (double)diagram.getX(i));
+	minY = min(minY, (double)diagram.getY(i));
+	maxY = max(maxY, (double)diagram.getY(i));
+    }
+
+    /* leave room for the Voronoi vertices outside the hull of the sites */
+    double pad = max(max(maxX-minX, maxY-minY), 1.0) * 2;
+    return VoronoiBox(minX-pad, minY-pad, maxX+pad, maxY+pad);
+} // }}}
+
+static void writeTree(FILE *out, const VoronoiAlgo &algorithm)
+{ // {{{
+    const vector<VoronoiAlgo::MergeNode> &tree = algorithm.getMergeTree();
+    for (int level=0; level<algorithm.getLevels(); level++) {
+	int nodes = 0, sites = 0, edges = 0;
+	double seconds = 0;
+	for (unsigned int i=0; i<tree.size(); i++) {
+	    if (tree[i].level != level)
+		continue;
+	    nodes++;
+	    sites += tree[i].end - tree[i].begin;
+	    edges += tree[i].edges;
+	    seconds += tree[i].seconds;
+	}
+	fprintf(out, "level %d: %d nodes, %d sites, %d edges, %.3f ms\n",
+		level, nodes, sites, edges, seconds * 1000);
+    }
+} // }}}
+
+static void writeDelaunay(FILE *out, VoronoiDiagram &diagram)
+{ // {{{
+    VoronoiDcel dcel;
+    dcel.build(diagram);
+
+    vector<int> sites;
+    for (int vertex=0; vertex<dcel.vertexCount(); vertex++) {
+	dcel.delaunayFace(vertex, sites);
+	for (unsigned int i=0; i<sites.size(); i++)
+	    fprintf(out, (i == 0) ? "%d %d" : " %d %d",
+		    diagram.getX(sites[i]), diagram.getY(sites[i]));
+	fprintf(out, "\n");
+    }
+} // }}}
+
+static bool writeCells(FILE *out, FILE *queries, VoronoiDiagram &diagram,
+	int threads)
+{ // {{{
+    vector<double> x, y;
+    double qx, qy;
+    int n;
+    while ((n = fscanf(queries, "%lf %lf", &qx, &qy)) == 2) {
+	x.push_back(qx);
+	y.push_back(qy);
+    }
+    if (n != EOF)
+	return false;
+
+    VoronoiLocator locator(diagram);
+    locator.setThreads(threads);
+    vector<int> sites(x.size());
+    if (!x.empty())
+	locator.locateAll(&x[0], &y[0], (int)x.size(), &sites[0]);
+    for (unsigned int i=0; i<sites.size(); i++) {
+	if (sites[i] == VoronoiDiagram::NONE)
+	    continue;
+	fprintf(out, "%.17g %.17g %d %d\n", x[i], y[i],
+		diagram.getX(sites[i]), diagram.getY(sites[i]));
+    }
+    return true;
+} // }}}
+
+static void writeEdges(FILE *out, VoronoiDiagram &diagram)
+{ // {{{
+    for (int edge=0; edge<diagram.edgeCount(); edge++) {
+	if (!diagram.isEnabled(edge))
+	    continue;
+	int left = diagram.getLeftPoint(edge);
+	int right = diagram.getRightPoint(edge);
+	fprintf(out, "%d %d %d %d %.17g %.17g %.17g %.17g %d\n",
+		diagram.getX(left), diagram.getY(left),
+		diagram.getX(right), diagram.getY(right),
+		diagram.getStartPoint(edge).first,
+		diagram.getStartPoint(edge).second,
+		diagram.getEndPoint(edge).first,
+		diagram.getEndPoint(edge).second,
+		diagram.getLineType(edge));
+    }
+} // }}}
+
+int main(int argc, char *argv[])
+{ // {{{
+    VoronoiDiagram diagram(VoronoiBox(0, 0, 0, 0));
+    bool hasBox = false, stats = false, showTree = false, sweep = false;
+    bool delaunay = false, binary = false, adjacency = false;
+    bool exporting = false, cells = false, hasClip = false;
+    VoronoiExporter::Format format = VoronoiExporter::SVG;
+    int threads = 1, cutoff = VoronoiAlgo::DEFAULT_CUTOFF;
+    VoronoiBox box, clip;
+    const char *queryFile = NULL, *cacheDir = NULL;
+    double cacheMB = 1024;
+    int argi = 1;
+
+    while (argi < argc && argv[argi][0] == '-' && argv[argi][1] != '\0') {
+	if (strcmp(argv[argi], "-s") == 0) {
+	    stats = true;
+	    argi++;
+	} else if (strcmp(argv[argi], "-d") == 0) {
+	    delaunay = true;
+	    argi++;
+	} else if (strcmp(argv[argi], "-m") == 0 ||
+		strcmp(argv[argi], "-a") == 0) {
+	    binary = true;
+	    adjacency = adjacency || argv[argi][1] == 'a';
+	    argi++;
+	} else if (strcmp(argv[argi], "-f") == 0) {
+	    sweep = true;
+	    argi++;
+	} else if (strcmp(argv[argi], "-t") == 0) {
+	    showTree = true;
+	    argi++;
+	} else if (strcmp(argv[argi], "-j") == 0 || 
+		strcmp(argv[argi], "-c") == 0) {
+	    if (argi + 1 >= argc)
+		usage(argv[0]);
+	    if (argv[argi][1] == 'j')
+		threads = atoi(argv[argi+1]);
+	    else
+		cutoff = atoi(argv[argi+1]);
+	    argi += 2;
+	} else if (strcmp(argv[argi], "-q") == 0) {
+	    if (argi + 1 >= argc)
+		usage(argv[0]);
+	    queryFile = argv[argi+1];
+	    argi += 2;
+	} else if (strcmp(argv[argi], "-C") == 0 ||
+		strcmp(argv[argi], "-l") == 0) {
+	    if (argi + 1 >= argc)
+		usage(argv[0]);
+	    if (argv[argi][1] == 'C')
+		cacheDir = argv[argi+1];
+	    else if ((cacheMB = atof(argv[argi+1])) <= 0)
+		usage(argv[0]);
+	    argi += 2;
+	} else if (strcmp(argv[argi], "-e") == 0) {
+	    if (argi + 1 >= argc ||
+		    !VoronoiExporter::formatOf(argv[argi+1], format))
+		usage(argv[0]);
+	    exporting = true;
+	    argi += 2;
+	} else if (strcmp(argv[argi], "-p") == 0) {
+	    cells = true;
+	    argi++;
+	} else if (strcmp(argv[argi], "-b") == 0 ||
+		strcmp(argv[argi], "-x") == 0) {
+	    if (argi + 4 >= argc)
+		usage(argv[0]);
+	    VoronoiBox given(atof(argv[argi+1]), atof(argv[argi+2]),
+		    atof(argv[argi+3]), atof(argv[argi+4]));
+	    if (argv[argi][1] == 'b') {
+		box = given;
+		hasBox = true;
+	    } else {
+		clip = given;
+		hasClip = true;
+	    }
+	    argi += 5;
+	} else
+	    usage(argv[0]);
+    }
+    if (argc - argi > 2)
+	usage(argv[0]);
+
+    if (!readSites((argi < argc) ? argv[argi] : NULL, diagram, threads))
+	return 1;
+    FILE *out = stdout;
+    const char *mode = binary ? "wb" : "w";
+    if (argi + 1 < argc && (out = fopen(argv[argi+1], mode)) == NULL) {
+	perror(argv[argi+1]);
+	return 1;
+    }
+    FILE *queries = NULL;
+    if (queryFile != NULL && (queries = fopen(queryFile, "r")) == NULL) {
+	perror(queryFile);
+	return 1;
+    }
+
+    diagram.setBox(hasBox ? box : boundingBox(diagram));
+    diagram.sortSites(threads);
+
+    VoronoiAlgo algorithm(diagram);
+    FortuneAlgo fortune(diagram);
+    algorithm.setThreads(threads);
+    algorithm.setCutoff(cutoff);
+    VoronoiCache *cache = NULL;
+    if (cacheDir != NULL && !showTree) {
+	cache = new VoronoiCache(cacheDir);
+	cache->setLimits((uint64_t)(cacheMB * 1048576), 1 << 20);
+    }
+    unsigned int options = VoronoiCache::optionsOf(sweep, cutoff);
+    bool done = cache != NULL && cache->load(diagram, options);
+    if (!done) {
+	done = sweep ? fortune.start() : algorithm.start();
+	if (done && cache != NULL && !cache->store(diagram, options))
+	    perror(cacheDir);
+    }
+    if (stats) {
+	const VoronoiArena &arena = diagram.getArena();
+	fprintf(stderr, "arena: %lu bytes in %lu allocations, "
+		"%lu bytes reserved\n",
+		(unsigned long)arena.getBytes(),
+		(unsigned long)arena.getAllocations(),
+		(unsigned long)arena.getReserved());
+	fprintf(stderr, "predicates: %lu orientations and %lu in-circle "
+		"tests taken to exact arithmetic\n",
+		diagram.getExactOrients(), diagram.getExactInCircles());
+	if (cache != NULL) {
+	    fprintf(stderr, "cache: %lu hits, %lu misses, %lu stored, "
+		    "%lu evicted\n", cache->getHits(), cache->getMisses(),
+		    cache->getStores(), cache->getEvictions());
+	}
+    }
+    if (showTree)
+	writeTree(stderr, algorithm);
+    if (!done) {
+	fprintf(stderr, "%s: calculation failed\n", argv[0]);
+	return 1;
+    }
+    if (queries != NULL) {
+	if (!writeCells(out, queries, diagram, threads)) {
+	    fprintf(stderr, "%s: malformed queries\n", argv[0]);
+	    return 1;
+	}
+	fclose(queries);
+    } else if (binary) {
+	VoronoiDcel dcel;
+	dcel.build(diagram);
+	VoronoiFileWriter writer(diagram, dcel);
+	writer.setAdjacency(adjacency);
+	if (!writer.write(out) || fflush(out) != 0) {
+	    perror((argi + 1 < argc) ? argv[argi+1] : "stdout");
+	    return 1;
+	}
+    } else if (exporting) {
+	VoronoiExporter exporter(diagram);
+	if (hasClip)
+	    exporter.setBox(clip);
+	exporter.setContent(VoronoiExporter::SITES | VoronoiExporter::EDGES |
+		(cells ? VoronoiExporter::CELLS : 0));
+	if (!exporter.write(out, format) || fflush(out) != 0) {
+	    perror((argi + 1 < argc) ? argv[argi+1] : "stdout");
+	    return 1;
+	}
+    } else if (delaunay)
+	writeDelaunay(out, diagram);
+    else
+	writeEdges(out, diagram);
+
+    if (out != stdout)
+	fclose(out);
+    return 0;
+} // }}}
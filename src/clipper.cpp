@@ -0,0 +1,183 @@
+#include <float.h>
+#include <math.h>
+
+#include <algorithm>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "clipper.h"
+
+using namespace std;
+
+RayClipper::RayClipper(const VoronoiBox &box)
+    : minX(box.getMinX()), minY(box.getMinY()),
+    maxX(box.getMaxX()), maxY(box.getMaxY()),
+    span(box.getMaxX() - box.getMinX() + box.getMaxY() - box.getMinY())
+{ // {{{
+} // }}}
+
+const char *RayClipper::kernel()
+{ // {{{
+#if defined(__AVX__)
+    return "AVX";
+#elif defined(__SSE2__)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+} // }}}
+
+void RayClipper::clipOne(double x, double y, double dx, double dy,
+	double &farX, double &farY) const
+{ // {{{
+    /*
+     * The ray is inside the slab between two sides of the box from enter
+     * to leave times (dx, dy); along a side it is either always in the
+     * slab or never.
+     */
+    double leaveX = ((dx > 0) ? maxX : minX) - x;
+    double enterX = ((dx > 0) ? minX : maxX) - x;
+    leaveX = (dx == 0) ? DBL_MAX : leaveX / dx;
+    enterX = (dx == 0) ? -DBL_MAX : enterX / dx;
+    bool missX = (dx == 0) && (x < minX || x > maxX);
+
+    double leaveY = ((dy > 0) ? maxY : minY) - y;
+    double enterY = ((dy > 0) ? minY : maxY) - y;
+    leaveY = (dy == 0) ? DBL_MAX : leaveY / dy;
+    enterY = (dy == 0) ? -DBL_MAX : enterY / dy;
+    bool missY = (dy == 0) && (y < minY || y > maxY);
+
+    double leave = min(leaveX, leaveY), enter = max(enterX, enterY);
+    bool hit = leave > 0 && leave >= enter && !missX && !missY;
+    double along = hit ? leave : span / (fabs(dx) + fabs(dy));
+    farX = x + dx * along;
+    farY = y + dy * along;
+} // }}}
+
+void RayClipper::clipScalar(const double *x, const double *y,
+	const double *dx, const double *dy, int count,
+	double *farX, double *farY) const
+{ // {{{
+    for (int i=0; i<count; i++)
+	clipOne(x[i], y[i], dx[i], dy[i], farX[i], farY[i]);
+} // }}}
+
+#if defined(__AVX__)
+
+/* mask ? yes : no, lane by lane */
+static inline __m256d select(__m256d mask, __m256d yes, __m256d no)
+{ // {{{
+    return _mm256_or_pd(_mm256_and_pd(mask, yes), _mm256_andnot_pd(mask, no));
+} // }}}
+
+/* clipOne() for one side, on four rays */
+static inline void slab(__m256d p, __m256d d, __m256d low, __m256d high,
+	__m256d &leave, __m256d &enter, __m256d &miss)
+{ // {{{
+    const __m256d zero = _mm256_setzero_pd();
+    __m256d forward = _mm256_cmp_pd(d, zero, _CMP_GT_OQ);
+    __m256d still = _mm256_cmp_pd(d, zero, _CMP_EQ_OQ);
+    leave = _mm256_div_pd(_mm256_sub_pd(select(forward, high, low), p), d);
+    enter = _mm256_div_pd(_mm256_sub_pd(select(forward, low, high), p), d);
+    leave = select(still, _mm256_set1_pd(DBL_MAX), leave);
+    enter = select(still, _mm256_set1_pd(-DBL_MAX), enter);
+    miss = _mm256_and_pd(still, _mm256_or_pd(
+		_mm256_cmp_pd(p, low, _CMP_LT_OQ),
+		_mm256_cmp_pd(p, high, _CMP_GT_OQ)));
+} // }}}
+
+void RayClipper::clip(const double *x, const double *y, const double *dx,
+	const double *dy, int count, double *farX, double *farY) const
+{ // {{{
+    const __m256d lowX = _mm256_set1_pd(minX), highX = _mm256_set1_pd(maxX);
+    const __m256d lowY = _mm256_set1_pd(minY), highY = _mm256_set1_pd(maxY);
+    const __m256d width = _mm256_set1_pd(span);
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    int i = 0;
+    for (; i+4<=count; i+=4) {
+	__m256d px = _mm256_loadu_pd(x + i), py = _mm256_loadu_pd(y + i);
+	__m256d vx = _mm256_loadu_pd(dx + i), vy = _mm256_loadu_pd(dy + i);
+	__m256d leaveX, enterX, missX, leaveY, enterY, missY;
+	slab(px, vx, lowX, highX, leaveX, enterX, missX);
+	slab(py, vy, lowY, highY, leaveY, enterY, missY);
+
+	__m256d leave = _mm256_min_pd(leaveX, leaveY);
+	__m256d enter = _mm256_max_pd(enterX, enterY);
+	__m256d hit = _mm256_andnot_pd(_mm256_or_pd(missX, missY),
+		_mm256_and_pd(
+		    _mm256_cmp_pd(leave, _mm256_setzero_pd(), _CMP_GT_OQ),
+		    _mm256_cmp_pd(leave, enter, _CMP_GE_OQ)));
+	__m256d length = _mm256_add_pd(_mm256_andnot_pd(sign, vx),
+		_mm256_andnot_pd(sign, vy));
+	__m256d along = select(hit, leave, _mm256_div_pd(width, length));
+	_mm256_storeu_pd(farX + i, _mm256_add_pd(px, _mm256_mul_pd(vx, along)));
+	_mm256_storeu_pd(farY + i, _mm256_add_pd(py, _mm256_mul_pd(vy, along)));
+    }
+    clipScalar(x + i, y + i, dx + i, dy + i, count - i, farX + i, farY + i);
+} // }}}
+
+#elif defined(__SSE2__)
+
+/* mask ? yes : no, lane by lane */
+static inline __m128d select(__m128d mask, __m128d yes, __m128d no)
+{ // {{{
+    return _mm_or_pd(_mm_and_pd(mask, yes), _mm_andnot_pd(mask, no));
+} // }}}
+
+/* clipOne() for one side, on two rays */
+static inline void slab(__m128d p, __m128d d, __m128d low, __m128d high,
+	__m128d &leave, __m128d &enter, __m128d &miss)
+{ // {{{
+    const __m128d zero = _mm_setzero_pd();
+    __m128d forward = _mm_cmpgt_pd(d, zero);
+    __m128d still = _mm_cmpeq_pd(d, zero);
+    leave = _mm_div_pd(_mm_sub_pd(select(forward, high, low), p), d);
+    enter = _mm_div_pd(_mm_sub_pd(select(forward, low, high), p), d);
+    leave = select(still, _mm_set1_pd(DBL_MAX), leave);
+    enter = select(still, _mm_set1_pd(-DBL_MAX), enter);
+    miss = _mm_and_pd(still,
+	    _mm_or_pd(_mm_cmplt_pd(p, low), _mm_cmpgt_pd(p, high)));
+} // }}}
+
+void RayClipper::clip(const double *x, const double *y, const double *dx,
+	const double *dy, int count, double *farX, double *farY) const
+{ // {{{
+    const __m128d lowX = _mm_set1_pd(minX), highX = _mm_set1_pd(maxX);
+    const __m128d lowY = _mm_set1_pd(minY), highY = _mm_set1_pd(maxY);
+    const __m128d width = _mm_set1_pd(span);
+    const __m128d sign = _mm_set1_pd(-0.0);
+    int i = 0;
+    for (; i+2<=count; i+=2) {
+	__m128d px = _mm_loadu_pd(x + i), py = _mm_loadu_pd(y + i);
+	__m128d vx = _mm_loadu_pd(dx + i), vy = _mm_loadu_pd(dy + i);
+	__m128d leaveX, enterX, missX, leaveY, enterY, missY;
+	slab(px, vx, lowX, highX, leaveX, enterX, missX);
+	slab(py, vy, lowY, highY, leaveY, enterY, missY);
+
+	__m128d leave = _mm_min_pd(leaveX, leaveY);
+	__m128d enter = _mm_max_pd(enterX, enterY);
+	__m128d hit = _mm_andnot_pd(_mm_or_pd(missX, missY),
+		_mm_and_pd(_mm_cmpgt_pd(leave, _mm_setzero_pd()),
+		    _mm_cmpge_pd(leave, enter)));
+	__m128d length = _mm_add_pd(_mm_andnot_pd(sign, vx),
+		_mm_andnot_pd(sign, vy));
+	__m128d along = select(hit, leave, _mm_div_pd(width, length));
+	_mm_storeu_pd(farX + i, _mm_add_pd(px, _mm_mul_pd(vx, along)));
+	_mm_storeu_pd(farY + i, _mm_add_pd(py, _mm_mul_pd(vy, along)));
+    }
+    clipScalar(x + i, y + i, dx + i, dy + i, count - i, farX + i, farY + i);
+} // }}}
+
+#else
+
+void RayClipper::clip(const double *x, const double *y, const double *dx,
+	const double *dy, int count, double *farX, double *farY) const
+{ // {{{
+    clipScalar(x, y, dx, dy, count, farX, farY);
+} // }}}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef CLIPPER_H
+#define CLIPPER_H
+
+#include "diagram.h"
+
+/*
+ * Finds where rays leave a VoronoiBox, many rays at a time.  The rays
+ * come in packed arrays and clip() runs on as many of them as one vector
+ * register holds: four with AVX, two with SSE2, whichever the compiler
+ * targets, and one at a time without either.  All the kernels do the
+ * same arithmetic in the same order, so they give the same answers.
+ *
+ * A ray that misses the box, or only meets it behind its origin, ends
+ * the width plus the height of the box ahead (in |dx| + |dy|) instead.
+ */
+class RayClipper
+{
+    public:
+	RayClipper(const VoronoiBox &box);
+	/* the ray from (x[i], y[i]) along (dx[i], dy[i]) leaves at far[i] */
+	void clip(const double *x, const double *y, const double *dx,
+		const double *dy, int count, double *farX, double *farY) const;
+	/* the same, one ray after the other */
+	void clipScalar(const double *x, const double *y, const double *dx,
+		const double *dy, int count, double *farX, double *farY) const;
+	/* "AVX", "SSE2" or "scalar", the kernel of clip() */
+	static const char *kernel();
+
+    private:
+	void clipOne(double x, double y, double dx, double dy,
+		double &farX, double &farY) const;
+
+	double minX, minY, maxX, maxY;
+	double span;		/* the width plus the height */
+};
+
+#endif
@@ -1,158 +1,140 @@
-#include <qvaluevector.h>
-
-#include "geometry.h"
-#include "convex.h"
-
-ConvexHull::ConvexHull(const QValueVector<DiagramPoint*> &pointSet)
-{ // {{{
-    if(!calConvexHull(pointSet))
-	qFatal("construct Convex Hull failed.");
-} // }}}
-
-bool ConvexHull::calConvexHull(const QValueVector<DiagramPoint*> &pointSet)
-{
-    qDebug("there are %d points in this convex hull",pointSet.size());
-    DiagramPoint* first = NULL;
-    curPos = 0;
-
-    /* if this point set has 1~3 point(s) */
-    if (pointSet.size() <= 3) { 
-	for (unsigned int i=0; i<pointSet.size(); i++) {
-	    convexPointSet.push_back(pointSet[i]);
-	    qDebug("(%d,%d) has been added into convexPointSet", 
-		    pointSet[i]->getX(), pointSet[i]->getY());
-	}
-	return true;
-    }
-
-    /* if all points in a line */
-    //QValueVector<DiagramBisector*> &degeList =
-
-    /* find the start point */
-    for (unsigned int i=0; i<pointSet.size(); i++) {
-	bool hasInfLine = false;
-	QValueVector<DiagramBisector*> &edgeList = 
-	    pointSet[i]->getEdgeList();
-
-	for (unsigned int j=0; j<edgeList.size(); j++) {
-	    if (edgeList[j]->getLineType() == DiagramBisector::ONE_INF &&
-		    edgeList[j]->isEnabled()) {
-		hasInfLine = true;
-		break;
-	    }
-	}
-
-	if (hasInfLine) {
-	    first = pointSet[i];
-	    break;
-	}
-    }
-
-    if (first == NULL)
-	return false;
-
-    /* find out the rest points which construct the convex hull */
-    /* TODO: debug */
-    DiagramPoint* prevPoint = NULL;
-    DiagramPoint* curPoint = first;
-    unsigned int pointCount = 0;
-
-    do {
-	QValueVector<DiagramBisector*> &edgeList = curPoint->getEdgeList();
-	bool hasCandidate = false;
-	pointCount++;
-
-	for (unsigned int i=0; i<edgeList.size(); i++) {
-	    if (edgeList[i]->getLineType() == DiagramBisector::ONE_INF && 
-		    edgeList[i]->isEnabled()) {
-		DiagramPoint *leftPoint = edgeList[i]->getLeftPoint();
-		DiagramPoint *rightPoint = edgeList[i]->getRightPoint();
-
-		if (*leftPoint == *curPoint) { /* rightPoint is candidate */
-		    if (prevPoint == NULL || !(*rightPoint == *prevPoint)) {
-			convexPointSet.push_back(rightPoint);
-			prevPoint = curPoint;
-			curPoint = rightPoint;
-			qDebug("(%d,%d) has been added into convexPointSet", 
-				rightPoint->getX(), rightPoint->getY());
-			hasCandidate = true;
-			break;
-		    }
-		} else { /* leftPoint is candidate */
-		    if (prevPoint == NULL || !(*leftPoint == *prevPoint)) {
-			convexPointSet.push_back(leftPoint);
-			prevPoint = curPoint;
-			curPoint = leftPoint;
-			qDebug("(%d,%d) has been added into convexPointSet", 
-				leftPoint->getX(), leftPoint->getY());
-			hasCandidate = true;
-			break;
-		    }
-		}
-	    }
-	}
-
-	if (!hasCandidate)
-	    qFatal("(%d,%d) has %d edges, but can't be a convex point.",
-		    curPoint->getX(), curPoint->getY(), edgeList.size());
-	if (pointCount > pointSet.size())
-	    qFatal("(%d,%d) has %d edges, but can't be a convex point.",
-		    curPoint->getX(), curPoint->getY(), edgeList.size());
-	
-    } while (!(*curPoint == *first));
-
-    return true;
-}
-
-DiagramPoint* ConvexHull::current()
-{ // {{{
-    return convexPointSet[curPos];
-} // }}}
-
-DiagramPoint* ConvexHull::backward()
-{ // {{{
-    int size = convexPointSet.size();
-    curPos = (curPos+size-1)%size;
-    return current();
-} // }}}
-
-DiagramPoint* ConvexHull::prev()
-{ // {{{
-    int size = convexPointSet.size();
-    return convexPointSet[(curPos+size-1)%size];
-} // }}}
-
-DiagramPoint* ConvexHull::forward()
-{ // {{{
-    int size = convexPointSet.size();
-    curPos = (curPos+1)%size;
-    return current();
-} // }}}
-
-DiagramPoint* ConvexHull::next()
-{ // {{{
-    int size = convexPointSet.size();
-    return convexPointSet[(curPos+1)%size];
-} // }}}
-
-DiagramPoint* ConvexHull::leftMost()
-{ // {{{
-    unsigned int minPos = 0;
-    for (unsigned int i = 1; i<convexPointSet.size(); i++) {
-	if (convexPointSet[i]->getX() < convexPointSet[minPos]->getX())
-	    minPos = i;
-    }
-    curPos = minPos;
-    return current();
-} // }}}
-
-DiagramPoint* ConvexHull::rightMost()
-{ // {{{
-    unsigned int maxPos = 0;
-    for (unsigned int i = 1; i<convexPointSet.size(); i++) {
-	if (convexPointSet[i]->getX() > convexPointSet[maxPos]->getX())
-	    maxPos = i;
-    }
-    curPos = maxPos;
-    return current();
-} // }}}
+#include <vector>
+
+#include "diagram.h"
+#include "convex.h"
+
+using namespace std;
+
+/* The lower or the upper chain of one hull, from its leftmost site on */
+class ConvexHulls::Chain
+{
+    public:
+	Chain(const int *hull, int size, int corner, bool upper)
+	    : hull(hull), size(size), corner(corner), upper(upper) {};
+	int count() const
+	{ return (upper && size > 1) ? size - corner + 1 : corner + 1; };
+	int pos(int i) const { return (upper && i > 0) ? size - i : i; };
+	int at(int i) const { return hull[pos(i)]; };
+
+    private:
+	const int *hull;
+	int size, corner;
+	bool upper;
+};
+
+ConvexHulls::ConvexHulls(const VoronoiDiagram &diagram, VoronoiArena *arena)
+    : diagram(diagram),
+    hullSite(diagram.siteCount(), VoronoiDiagram::NONE, arena),
+    hullScratch(diagram.siteCount(), VoronoiDiagram::NONE, arena),
+    hullSize(diagram.siteCount(), 0, arena),
+    hullCorner(diagram.siteCount(), 0, arena)
+{ // {{{
+} // }}}
+
+void ConvexHulls::makeSegment(int begin, int end)
+{ // {{{
+    /* sites sharing one x: only the two ends are corners */
+    hullSite[begin] = begin;
+    hullSize[begin] = 1;
+    if (end - begin > 1) {
+	hullSite[begin+1] = end-1;
+	hullSize[begin] = 2;
+    }
+    hullCorner[begin] = hullSize[begin] - 1;
+} // }}}
+
+int ConvexHulls::cross(int origin, int a, int b) const
+{ // {{{
+    /* exact, a wrong turn would take the bridges off the hulls */
+    return diagram.orient(origin, a, b);
+} // }}}
+
+int ConvexHulls::tangent(int site, const Chain &chain, double sign) const
+{ // {{{
+    /*
+     * Seen from a site left of the chain, the chain first bends away and
+     * then back, so the first corner with its successor on the far side
+     * of the line is the tangent point.
+     */
+    int low = 0, high = chain.count() - 1;
+    while (low < high) {
+	int mid = (low + high) / 2;
+	if (sign * cross(site, chain.at(mid), chain.at(mid+1)) < 0)
+	    low = mid + 1;
+	else
+	    high = mid;
+    }
+    return low;
+} // }}}
+
+void ConvexHulls::bridge(const Chain &left, const Chain &right, double sign,
+	int &leftPos, int &rightPos) const
+{ // {{{
+    /* move right on the left chain while the next corner is below */
+    int low = 0, high = left.count() - 1;
+    while (low < high) {
+	int mid = (low + high) / 2;
+	int touch = right.at(tangent(left.at(mid), right, sign));
+	if (sign * cross(left.at(mid), touch, left.at(mid+1)) <= 0)
+	    low = mid + 1;
+	else
+	    high = mid;
+    }
+    leftPos = left.pos(low);
+    rightPos = right.pos(tangent(left.at(low), right, sign));
+} // }}}
+
+void ConvexHulls::findBridges(int begin, int middle, Bridges &bridges) const
+{ // {{{
+    const int *leftHull = &hullSite[begin], *rightHull = &hullSite[middle];
+    int leftSize = hullSize[begin], rightSize = hullSize[middle];
+    int leftCorner = hullCorner[begin], rightCorner = hullCorner[middle];
+
+    /* the upper bridge is the lower one with y turned upside down */
+    bridge(Chain(leftHull, leftSize, leftCorner, false),
+	    Chain(rightHull, rightSize, rightCorner, false), 1,
+	    bridges.lowerLeft, bridges.lowerRight);
+    bridge(Chain(leftHull, leftSize, leftCorner, true),
+	    Chain(rightHull, rightSize, rightCorner, true), -1,
+	    bridges.upperLeft, bridges.upperRight);
+} // }}}
+
+void ConvexHulls::join(int begin, int middle, const Bridges &bridges)
+{ // {{{
+    int leftSize = hullSize[begin], rightSize = hullSize[middle];
+    int count = 0;
+
+    /* the lower chain of the left hull up to the lower bridge */
+    for (int i=0; i<=bridges.lowerLeft; i++)
+	hullScratch[begin + count++] = hullSite[begin + i];
+
+    /*
+     * The right hull from the lower to the upper bridge.  Its rightmost
+     * site is always part of the result, so bridges meeting at another
+     * site (as on a line) take the right hull all the way round.
+     */
+    int steps = (bridges.upperRight - bridges.lowerRight + rightSize) % 
+	rightSize + 1;
+    if (bridges.lowerRight == bridges.upperRight && 
+	    bridges.upperRight != hullCorner[middle])
+	steps = rightSize;
+    for (int j=0; j<steps; j++) {
+	int pos = (bridges.lowerRight + j) % rightSize;
+	if (pos == hullCorner[middle])
+	    hullCorner[begin] = count;	/* the rightmost site of all */
+	hullScratch[begin + count++] = hullSite[middle + pos];
+    }
+
+    /* the upper chain of the left hull back from the upper bridge */
+    if (bridges.upperLeft != 0) {
+	int first = bridges.upperLeft;
+	if (first == bridges.lowerLeft)
+	    first++;
+	for (int k=first; k<leftSize; k++)
+	    hullScratch[begin + count++] = hullSite[begin + k];
+    }
+
+    for (int m=0; m<count; m++)
+	hullSite[begin + m] = hullScratch[begin + m];
+    hullSize[begin] = count;
+} // }}}
@@ -1,23 +1,47 @@
-#ifndef CONVEX_H
-#define CONVEX_H
-
-class ConvexHull
-{
-    public:
-	ConvexHull(const QValueVector<DiagramPoint*> &pointSet);
-	DiagramPoint* current();
-	DiagramPoint* backward();
-	DiagramPoint* prev();
-	DiagramPoint* forward();
-	DiagramPoint* next();
-	DiagramPoint* leftMost();
-	DiagramPoint* rightMost();
-
-    private:
-	bool calConvexHull(const QValueVector<DiagramPoint*> &pointSet);
-
-	QValueVector<DiagramPoint*> convexPointSet;
-	int curPos;
-};
-
-#endif
+#ifndef CONVEX_H
+#define CONVEX_H
+
+#include <vector>
+
+#include "diagram.h"
+
+/*
+ * The convex hulls of all point sets of one VoronoiAlgo run.  The hull of
+ * the sorted sites [begin, end) is kept in the slots [begin, begin+size)
+ * of one array shared by the whole run, so disjoint sets never overlap.
+ *
+ * A hull runs counterclockwise (x to the right, y up) from its leftmost
+ * site: first the lower chain up to the rightmost site at position
+ * corner, then the upper chain back.
+ */
+class ConvexHulls
+{
+    public:
+	/* positions of the ends of the bridges between two hulls */
+	struct Bridges {
+	    int lowerLeft, lowerRight;
+	    int upperLeft, upperRight;
+	};
+
+	ConvexHulls(const VoronoiDiagram &diagram, VoronoiArena *arena);
+	void makeSegment(int begin, int end);
+	/* the hulls of [begin, middle) and [middle, end) */
+	void findBridges(int begin, int middle, Bridges &bridges) const;
+	void join(int begin, int middle, const Bridges &bridges);
+	int size(int begin) const { return hullSize[begin]; };
+	int site(int begin, int pos) const { return hullSite[begin+pos]; };
+
+    private:
+	class Chain;
+
+	int cross(int origin, int a, int b) const;
+	int tangent(int site, const Chain &chain, double sign) const;
+	void bridge(const Chain &left, const Chain &right, double sign,
+		int &leftPos, int &rightPos) const;
+
+	const VoronoiDiagram &diagram;
+	IdArray hullSite, hullScratch;
+	IdArray hullSize, hullCorner;	/* by the first site of the set */
+};
+
+#endif
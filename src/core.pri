@@ -0,0 +1,36 @@
+# GUI-free Voronoi kernel shared by voronoi.pro and voronoi-cli.pro
+CONFIG += thread
+HEADERS += algorithm.h \
+           arena.h \
+           cache.h \
+           clipper.h \
+           convex.h \
+           dcel.h \
+           diagfile.h \
+           diagram.h \
+           diagwriter.h \
+           editor.h \
+           exporter.h \
+           fortune.h \
+           importer.h \
+           locator.h \
+           sitehash.h \
+           sorter.h \
+           taskpool.h
+SOURCES += algorithm.cpp \
+           arena.cpp \
+           cache.cpp \
+           clipper.cpp \
+           convex.cpp \
+           dcel.cpp \
+           diagfile.cpp \
+           diagram.cpp \
+           diagwriter.cpp \
+           editor.cpp \
+           exporter.cpp \
+           fortune.cpp \
+           importer.cpp \
+           locator.cpp \
+           sitehash.cpp \
+           sorter.cpp \
+           taskpool.cpp
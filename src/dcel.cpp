@@ -0,0 +1,124 @@
+#include "diagram.h"
+#include "dcel.h"
+
+using namespace std;
+
+void VoronoiDcel::clear()
+{ // {{{
+    vertexX.clear();	vertexY.clear();	vertexFirst.clear();
+    halfEdge.clear();
+    halfOrigin.clear();	halfNext.clear();
+    halfPrev.clear();	halfFace.clear();
+    faceFirst.clear();
+} // }}}
+
+void VoronoiDcel::build(const VoronoiDiagram &diagram)
+{ // {{{
+    clear();
+
+    /* the live edges, each a pair of twins */
+    vector<int> pairOf(diagram.edgeCount(), NONE);
+    for (int edge=0; edge<diagram.edgeCount(); edge++) {
+	if (!diagram.isEnabled(edge))
+	    continue;
+	pairOf[edge] = (int)halfEdge.size();
+	halfEdge.push_back(edge);
+	halfFace.push_back(diagram.getLeftPoint(edge));
+	halfFace.push_back(diagram.getRightPoint(edge));
+    }
+    halfOrigin.assign(halfFace.size(), NONE);
+    halfNext.assign(halfFace.size(), NONE);
+    halfPrev.assign(halfFace.size(), NONE);
+    faceFirst.assign(diagram.siteCount(), NONE);
+
+    /*
+     * Around a face the edges come in the counterclockwise order of its
+     * ring.  Two of them in a row meet at a vertex unless the turn from
+     * the one neighbor to the other is half a circle or more; then both
+     * go off to infinity and the face is open there.
+     */
+    for (int site=0; site<diagram.siteCount(); site++) {
+	int first = diagram.firstEdge(site);
+	if (first == VoronoiDiagram::NONE)
+	    continue;
+	int edge = first;
+	do {
+	    int next = diagram.nextEdge(site, edge);
+	    int half = 2 * pairOf[edge] +
+		(diagram.getLeftPoint(edge) == site ? 0 : 1);
+	    int nextHalf = 2 * pairOf[next] +
+		(diagram.getLeftPoint(next) == site ? 0 : 1);
+	    if (faceFirst[site] == NONE)
+		faceFirst[site] = half;
+	    if (next != edge && diagram.orient(site,
+			diagram.otherSite(edge, site),
+			diagram.otherSite(next, site)) > 0) {
+		halfNext[half] = nextHalf;
+		halfPrev[nextHalf] = half;
+	    } else
+		faceFirst[site] = nextHalf;
+	    edge = next;
+	} while (edge != first);
+    }
+
+    /* a vertex is shared by every half-edge leaving it */
+    for (int half=0; half<halfEdgeCount(); half++) {
+	if (halfPrev[half] != NONE && halfOrigin[half] == NONE)
+	    placeVertex(diagram, half);
+    }
+} // }}}
+
+void VoronoiDcel::placeVertex(const VoronoiDiagram &diagram, int half)
+{ // {{{
+    /*
+     * An edge with one vertex has it at the only finite end.  Otherwise
+     * the half-edge runs a quarter turn counterclockwise from the
+     * direction to the neighbor along its face, so its origin is the end
+     * lying furthest back that way.
+     */
+    int edge = getEdge(half), site = halfFace[half];
+    int other = diagram.otherSite(edge, site);
+    double dx = -((double)diagram.getY(other) - diagram.getY(site));
+    double dy = (double)diagram.getX(other) - diagram.getX(site);
+    VoronoiCoord start = diagram.getStartPoint(edge);
+    VoronoiCoord end = diagram.getEndPoint(edge);
+    VoronoiCoord point = (start.first * dx + start.second * dy <=
+	    end.first * dx + end.second * dy) ? start : end;
+    if (diagram.getLineType(edge) == VoronoiDiagram::ONE_INF)
+	point = diagram.isStartPointINF(edge) ? end : start;
+
+    int vertex = vertexCount();
+    vertexX.push_back(point.first);
+    vertexY.push_back(point.second);
+    vertexFirst.push_back(half);
+
+    /* around the vertex, clockwise; a ring can't be longer than this */
+    int leaving = half;
+    for (int i=0; i<halfEdgeCount(); i++) {
+	halfOrigin[leaving] = vertex;
+	leaving = halfNext[twin(leaving)];
+	if (leaving == NONE || leaving == half)
+	    break;
+    }
+} // }}}
+
+bool VoronoiDcel::isOpen(int face) const
+{ // {{{
+    int first = faceFirst[face];
+    return first == NONE || halfPrev[first] == NONE;
+} // }}}
+
+int VoronoiDcel::delaunayFace(int vertex, vector<int> &sites) const
+{ // {{{
+    /* the faces around the vertex, counterclockwise */
+    sites.clear();
+    int first = vertexFirst[vertex], leaving = first;
+    do {
+	sites.push_back(halfFace[leaving]);
+	int arriving = halfPrev[leaving];
+	if (arriving == NONE)
+	    break;
+	leaving = twin(arriving);
+    } while (leaving != first && (int)sites.size() < halfEdgeCount());
+    return (int)sites.size();
+} // }}}
@@ -0,0 +1,67 @@
+#ifndef DCEL_H
+#define DCEL_H
+
+#include <vector>
+
+#include "diagram.h"
+
+/*
+ * The topology of a finished VoronoiDiagram as a doubly-connected edge
+ * list, read off the rings of the sites with no geometry matched.
+ *
+ * Every live edge of the diagram gives two twin half-edges; half-edge
+ * 2*i+0 runs along the face of the left site of the edge, 2*i+1 along
+ * the one of the right site, each counterclockwise (x to the right, y
+ * up) around its face.  Faces are the sites, with the same ids.  Ends at
+ * infinity have no vertex: such a half-edge has no next (or prev), and
+ * the face it bounds is open.
+ *
+ * Read the other way round, the same arrays are the Delaunay dual: its
+ * vertices are the sites, its edges the pairs of faces of twin
+ * half-edges, and its faces the Voronoi vertices.
+ */
+class VoronoiDcel
+{
+    public:
+	enum { NONE = -1 };
+
+	VoronoiDcel() {};
+	void build(const VoronoiDiagram &diagram);
+	void clear();
+
+	/* vertices */
+	int vertexCount() const { return (int)vertexX.size(); };
+	double getX(int vertex) const { return vertexX[vertex]; };
+	double getY(int vertex) const { return vertexY[vertex]; };
+	int vertexEdge(int vertex) const { return vertexFirst[vertex]; };
+
+	/* half-edges */
+	int halfEdgeCount() const { return (int)halfOrigin.size(); };
+	int getEdge(int half) const { return halfEdge[half / 2]; };
+	int twin(int half) const { return half ^ 1; };
+	int origin(int half) const { return halfOrigin[half]; };
+	int destination(int half) const { return halfOrigin[half ^ 1]; };
+	int next(int half) const { return halfNext[half]; };
+	int prev(int half) const { return halfPrev[half]; };
+	int face(int half) const { return halfFace[half]; };
+
+	/* faces */
+	int faceCount() const { return (int)faceFirst.size(); };
+	/* for an open face, the half-edge coming in from infinity */
+	int faceEdge(int face) const { return faceFirst[face]; };
+	bool isOpen(int face) const;
+
+	/* the Delaunay dual */
+	int delaunayFace(int vertex, std::vector<int> &sites) const;
+
+    private:
+	void placeVertex(const VoronoiDiagram &diagram, int half);
+
+	std::vector<double> vertexX, vertexY;
+	std::vector<int> vertexFirst;		/* a half-edge leaving it */
+	std::vector<int> halfEdge;		/* by twin pair */
+	std::vector<int> halfOrigin, halfNext, halfPrev, halfFace;
+	std::vector<int> faceFirst;
+};
+
+#endif
@@ -0,0 +1,175 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "diagfile.h"
+
+VoronoiFileReader::VoronoiFileReader()
+    : data(NULL), size(0), header(NULL), error(NULL)
+{ // {{{
+} // }}}
+
+VoronoiFileReader::~VoronoiFileReader()
+{ // {{{
+    close();
+} // }}}
+
+bool VoronoiFileReader::fail(const char *message)
+{ // {{{
+    error = message;
+    return false;
+} // }}}
+
+bool VoronoiFileReader::open(const char *path)
+{ // {{{
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+	return false;
+    struct stat info;
+    if (fstat(fd, &info) < 0) {
+	int saved = errno;
+	::close(fd);
+	errno = saved;
+	return false;
+    }
+    if ((size_t)info.st_size < sizeof(VoronoiFileHeader)) {
+	::close(fd);
+	return fail("shorter than the header");
+    }
+    void *mapped = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    int saved = errno;
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+	errno = saved;
+	return false;
+    }
+    data = (const char *)mapped;
+    size = (size_t)info.st_size;
+    header = (const VoronoiFileHeader *)data;
+
+    /* nothing past the header is read before it is known to be there */
+    if (memcmp(header->magic, "VORODIAG", 8) != 0)
+	return fail("not a diagram file");
+    if (header->byteOrder != VORONOI_FILE_BYTE_ORDER)
+	return fail("written with the other byte order");
+    if (header->version != VORONOI_FILE_VERSION)
+	return fail("of an unknown version");
+    if (header->headerSize < sizeof(VoronoiFileHeader) ||
+	    header->fileSize != size)
+	return fail("truncated");
+    if (header->siteCount < 0 || header->vertexCount < 0 ||
+	    header->edgeCount < 0 || header->adjacencyCount < 0)
+	return fail("of a negative size");
+    if (!hasSection(header->siteOffset, header->siteCount,
+		sizeof(VoronoiFileSite)) ||
+	    !hasSection(header->vertexOffset, header->vertexCount,
+		sizeof(VoronoiFileVertex)) ||
+	    !hasSection(header->edgeOffset, header->edgeCount,
+		sizeof(VoronoiFileEdge)))
+	return fail("with a section out of the file");
+    if (hasAdjacency() && (
+		!hasSection(header->firstOffset,
+		    (uint64_t)header->siteCount + 1, sizeof(uint32_t)) ||
+		!hasSection(header->adjacencyOffset, header->adjacencyCount,
+		    sizeof(int32_t))))
+	return fail("with a section out of the file");
+    return true;
+} // }}}
+
+void VoronoiFileReader::close()
+{ // {{{
+    if (data != NULL)
+	munmap((void *)data, size);
+    data = NULL;
+    size = 0;
+    header = NULL;
+    error = NULL;
+} // }}}
+
+bool VoronoiFileReader::hasSection(uint64_t offset, uint64_t count,
+	size_t item) const
+{ // {{{
+    return offset % 8 == 0 && offset >= header->headerSize &&
+	offset <= size && count <= (size - offset) / item;
+} // }}}
+
+const VoronoiFileSite * VoronoiFileReader::getSites() const
+{ // {{{
+    return (const VoronoiFileSite *)(data + header->siteOffset);
+} // }}}
+
+const VoronoiFileVertex * VoronoiFileReader::getVertices() const
+{ // {{{
+    return (const VoronoiFileVertex *)(data + header->vertexOffset);
+} // }}}
+
+const VoronoiFileEdge * VoronoiFileReader::getEdges() const
+{ // {{{
+    return (const VoronoiFileEdge *)(data + header->edgeOffset);
+} // }}}
+
+bool VoronoiFileReader::hasAdjacency() const
+{ // {{{
+    return (header->flags & VORONOI_FILE_HAS_ADJACENCY) != 0;
+} // }}}
+
+const uint32_t * VoronoiFileReader::getFirst() const
+{ // {{{
+    return hasAdjacency() ? (const uint32_t *)(data + header->firstOffset)
+	: NULL;
+} // }}}
+
+const int32_t * VoronoiFileReader::getAdjacency() const
+{ // {{{
+    return hasAdjacency() ? (const int32_t *)(data + header->adjacencyOffset)
+	: NULL;
+} // }}}
+
+bool VoronoiFileReader::validate()
+{ // {{{
+    if (data == NULL)
+	return fail("not open");
+
+    const VoronoiFileEdge *edges = getEdges();
+    for (int i=0; i<header->edgeCount; i++) {
+	const VoronoiFileEdge &edge = edges[i];
+	for (int end=0; end<2; end++) {
+	    if (edge.site[end] < 0 || edge.site[end] >= header->siteCount)
+		return fail("an edge with a site out of range");
+	    bool infinite = (edge.flags & (VORONOI_FILE_END0_INF << end)) != 0;
+	    if (infinite != (edge.vertex[end] == VORONOI_FILE_NO_VERTEX))
+		return fail("an end at infinity with a vertex, or the reverse");
+	    if (!infinite && (edge.vertex[end] < 0 ||
+			edge.vertex[end] >= header->vertexCount))
+		return fail("an edge with a vertex out of range");
+	}
+	if (edge.site[0] == edge.site[1])
+	    return fail("an edge between a site and itself");
+    }
+
+    if (!hasAdjacency())
+	return true;
+    const uint32_t *first = getFirst();
+    const int32_t *adjacency = getAdjacency();
+    if (first[0] != 0 ||
+	    first[header->siteCount] != (uint32_t)header->adjacencyCount)
+	return fail("adjacency that doesn't cover its entries");
+    for (int s=0; s<header->siteCount; s++) {
+	if (first[s] > first[s+1])
+	    return fail("adjacency running backwards");
+    }
+    for (int site=0; site<header->siteCount; site++) {
+	for (uint32_t j=first[site]; j<first[site+1]; j++) {
+	    int edge = adjacency[j];
+	    if (edge < 0 || edge >= header->edgeCount)
+		return fail("adjacency with an edge out of range");
+	    if (edges[edge].site[0] != site && edges[edge].site[1] != site)
+		return fail("adjacency with an edge of other sites");
+	}
+    }
+    return true;
+} // }}}
@@ -0,0 +1,109 @@
+#ifndef DIAGFILE_H
+#define DIAGFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The binary diagram file: a header, then the sites, the vertices and
+ * the edges of a finished diagram as packed arrays, and the ring of
+ * edges around every site when HAS_ADJACENCY is set.  Every section
+ * starts at the offset the header gives, a multiple of 8, so a reader
+ * can map the file and use the arrays where they lie.
+ *
+ * The numbers are in the byte order of the writer; byteOrder tells a
+ * reader on a host with the other order to refuse the file.  A version
+ * that only adds sections or header fields keeps VERSION, others bump
+ * it.
+ */
+
+struct VoronoiFileHeader
+{
+    char magic[8];		/* "VORODIAG" */
+    uint32_t version;
+    uint32_t byteOrder;		/* VORONOI_FILE_BYTE_ORDER */
+    uint32_t flags;
+    uint32_t headerSize;
+    int32_t siteCount, vertexCount, edgeCount;
+    int32_t adjacencyCount;	/* entries of the adjacency array */
+    double minX, minY, maxX, maxY;	/* the box the rays end at */
+    uint64_t siteOffset, vertexOffset, edgeOffset;
+    uint64_t firstOffset, adjacencyOffset;	/* 0 without adjacency */
+    uint64_t fileSize;
+    uint64_t reserved[2];
+};
+
+struct VoronoiFileSite
+{
+    int32_t x, y;
+};
+
+struct VoronoiFileVertex
+{
+    double x, y;
+};
+
+/*
+ * An edge as its two half-edges: end 0 is the origin of the half-edge
+ * along the face of site[0], end 1 the origin of its twin.  An end at
+ * infinity has no vertex and its point is where the ray leaves the box.
+ */
+struct VoronoiFileEdge
+{
+    int32_t site[2];
+    int32_t vertex[2];		/* NO_VERTEX at infinity */
+    double x[2], y[2];
+    uint32_t flags;		/* END0_INF, END1_INF */
+    uint32_t reserved;
+};
+
+enum {
+    VORONOI_FILE_VERSION = 1,
+    VORONOI_FILE_BYTE_ORDER = 0x01020304,
+    VORONOI_FILE_HAS_ADJACENCY = 1,
+    VORONOI_FILE_END0_INF = 1,
+    VORONOI_FILE_END1_INF = 2,
+    VORONOI_FILE_NO_VERTEX = -1
+};
+
+/*
+ * Maps a diagram file read-only and shared, so that any number of
+ * processes read the same pages.  open() checks the header and that the
+ * sections lie in the file; validate() reads the whole file once and
+ * checks every index in it.
+ */
+class VoronoiFileReader
+{
+    public:
+	VoronoiFileReader();
+	~VoronoiFileReader();
+	/* false if the file can't be mapped (see errno) or getError() */
+	bool open(const char *path);
+	void close();
+	bool validate();
+	/* what made open() or validate() fail, or NULL */
+	const char * getError() const { return error; };
+
+	const VoronoiFileHeader & getHeader() const { return *header; };
+	const VoronoiFileSite * getSites() const;
+	const VoronoiFileVertex * getVertices() const;
+	const VoronoiFileEdge * getEdges() const;
+	bool hasAdjacency() const;
+	/* the edges of site s are adjacency[first[s]] to first[s+1] */
+	const uint32_t * getFirst() const;
+	const int32_t * getAdjacency() const;
+
+    private:
+	VoronoiFileReader(const VoronoiFileReader &);
+	VoronoiFileReader & operator=(const VoronoiFileReader &);
+
+	bool fail(const char *message);
+	bool hasSection(uint64_t offset, uint64_t count, size_t item) const;
+
+	const char *data;
+	size_t size;
+	const VoronoiFileHeader *header;
+	const char *error;
+};
+
+#endif
@@ -0,0 +1,809 @@
+#include <math.h>
+
+#include <algorithm>
+
+#include "clipper.h"
+#include "diagram.h"
+#include "sorter.h"
+#include "taskpool.h"
+
+using namespace std;
+
+/* Gives the buffer of an arena array up without touching the arena */
+template <class T>
+static void dropArray(T &array)
+{ // {{{
+    T(array.get_allocator()).swap(array);
+} // }}}
+
+/*
+ * A signed integer wide enough for the in-circle determinant of int
+ * sites, in 16-bit limbs so that a product of two limbs plus the carries
+ * fits an unsigned long.  The predicates only fall back on it when the
+ * floating point filter can't tell the sign.
+ */
+class ExactInt
+{
+    public:
+	ExactInt() : negative(false) { fill(limbs, limbs + LIMBS, 0UL); };
+	ExactInt(int a, int b);		/* a - b */
+	ExactInt operator+(const ExactInt &rhs) const
+	{ return add(rhs, rhs.negative); };
+	ExactInt operator-(const ExactInt &rhs) const
+	{ return add(rhs, !rhs.negative); };
+	ExactInt operator*(const ExactInt &rhs) const;
+	int sign() const;
+	double toDouble() const;
+
+    private:
+	enum { LIMBS = 10, BITS = 16, BASE = 1 << BITS };
+
+	ExactInt add(const ExactInt &rhs, bool rhsNegative) const;
+	int compareMagnitude(const ExactInt &rhs) const;
+
+	unsigned long limbs[LIMBS];	/* least significant first */
+	bool negative;
+};
+
+ExactInt::ExactInt(int a, int b)
+    : negative(a < b)
+{ // {{{
+    /* the difference of two ints always fits 32 bits unsigned */
+    unsigned long magnitude = negative ? 
+	(unsigned int)b - (unsigned int)a : (unsigned int)a - (unsigned int)b;
+    fill(limbs, limbs + LIMBS, 0UL);
+    limbs[0] = magnitude & (BASE - 1);
+    limbs[1] = (magnitude >> BITS) & (BASE - 1);
+} // }}}
+
+ExactInt ExactInt::add(const ExactInt &rhs, bool rhsNegative) const
+{ // {{{
+    ExactInt sum;
+    if (negative == rhsNegative) {
+	unsigned long carry = 0;
+	for (int i=0; i<LIMBS; i++) {
+	    unsigned long digit = limbs[i] + rhs.limbs[i] + carry;
+	    sum.limbs[i] = digit & (BASE - 1);
+	    carry = digit >> BITS;
+	}
+	sum.negative = negative;
+	return sum;
+    }
+
+    /* the smaller magnitude comes off the larger one */
+    const ExactInt *large = this, *small = &rhs;
+    sum.negative = negative;
+    if (compareMagnitude(rhs) < 0) {
+	large = &rhs;
+	small = this;
+	sum.negative = rhsNegative;
+    }
+    unsigned long borrow = 0;
+    for (int j=0; j<LIMBS; j++) {
+	unsigned long digit = large->limbs[j] + BASE - small->limbs[j] - borrow;
+	sum.limbs[j] = digit & (BASE - 1);
+	borrow = (digit >> BITS) ? 0 : 1;
+    }
+    return sum;
+} // }}}
+
+ExactInt ExactInt::operator*(const ExactInt &rhs) const
+{ // {{{
+    /* the determinants stay well inside LIMBS, nothing is cut off */
+    ExactInt product;
+    for (int i=0; i<LIMBS; i++) {
+	if (limbs[i] == 0)
+	    continue;
+	unsigned long carry = 0;
+	for (int j=0; i+j<LIMBS; j++) {
+	    unsigned long digit = product.limbs[i+j] + 
+		limbs[i] * rhs.limbs[j] + carry;
+	    product.limbs[i+j] = digit & (BASE - 1);
+	    carry = digit >> BITS;
+	}
+    }
+    product.negative = (negative != rhs.negative);
+    return product;
+} // }}}
+
+int ExactInt::compareMagnitude(const ExactInt &rhs) const
+{ // {{{
+    for (int i=LIMBS-1; i>=0; i--) {
+	if (limbs[i] != rhs.limbs[i])
+	    return (limbs[i] < rhs.limbs[i]) ? -1 : 1;
+    }
+    return 0;
+} // }}}
+
+int ExactInt::sign() const
+{ // {{{
+    for (int i=0; i<LIMBS; i++) {
+	if (limbs[i] != 0)
+	    return negative ? -1 : 1;
+    }
+    return 0;
+} // }}}
+
+double ExactInt::toDouble() const
+{ // {{{
+    /* off by a few units in the last place at most */
+    double value = 0;
+    for (int i=LIMBS-1; i>=0; i--)
+	value = value * BASE + limbs[i];
+    return negative ? -value : value;
+} // }}}
+
+/*
+ * Below this every integer is a double and so is every product or sum of
+ * them that stays below, so a determinant whose terms add up to less has
+ * no rounding error at all.
+ */
+static const double EXACT_LIMIT = 9007199254740992.0;		/* 2^53 */
+/* Shewchuk's bounds on the rounding error, relative to those terms */
+static const double EPSILON = 1.1102230246251565e-16;		/* 2^-53 */
+static const double ORIENT_BOUND = (3.0 + 16.0 * EPSILON) * EPSILON;
+static const double INCIRCLE_BOUND = (10.0 + 96.0 * EPSILON) * EPSILON;
+
+VoronoiDiagram::VoronoiDiagram(const VoronoiBox &box)
+    : box(box), 
+    siteFirst(&arena), 
+    edgeTotal(0), edgeLock(NULL), edgeOverflow(false), 
+    exactOrients(0), exactInCircles(0), 
+    edgeLeft(&arena), edgeRight(&arena), edgeRef(&arena), 
+    nextLeft(&arena), prevLeft(&arena), nextRight(&arena), prevRight(&arena), 
+    edgeA(&arena), edgeB(&arena), edgeC(&arena), 
+    startX(&arena), startY(&arena), endX(&arena), endY(&arena), 
+    edgeFlags(&arena)
+{ // {{{
+} // }}}
+
+void VoronoiDiagram::sortSites(int threads)
+{ // {{{
+    /* the first of equal sites is kept, the others are dropped */
+    vector<int> order;
+    if (!siteX.empty()) {
+	SiteSorter sorter;
+	sorter.setThreads(threads);
+	sorter.sort(&siteX[0], &siteY[0], (int)siteX.size(), order);
+    }
+
+    vector<int> sortedX(order.size()), sortedY(order.size());
+    for (unsigned int j=0; j<order.size(); j++) {
+	sortedX[j] = siteX[order[j]];
+	sortedY[j] = siteY[order[j]];
+    }
+    siteX.swap(sortedX);
+    siteY.swap(sortedY);
+    clearEdges();
+} // }}}
+
+void VoronoiDiagram::reserveEdges(int count)
+{ // {{{
+    if (count > (int)edgeLeft.size())
+	resizeEdges(count);
+} // }}}
+
+void VoronoiDiagram::resizeEdges(int count)
+{ // {{{
+    edgeLeft.resize(count);	edgeRight.resize(count);
+    edgeRef.resize(count);
+    nextLeft.resize(count);	prevLeft.resize(count);
+    nextRight.resize(count);	prevRight.resize(count);
+    edgeA.resize(count);	edgeB.resize(count);	edgeC.resize(count);
+    startX.resize(count);	startY.resize(count);
+    endX.resize(count);		endY.resize(count);
+    edgeFlags.resize(count);
+} // }}}
+
+void VoronoiDiagram::clearEdges()
+{ // {{{
+    dropArray(siteFirst);
+    dropArray(edgeLeft);	dropArray(edgeRight);	dropArray(edgeRef);
+    dropArray(nextLeft);	dropArray(prevLeft);
+    dropArray(nextRight);	dropArray(prevRight);
+    dropArray(edgeA);		dropArray(edgeB);	dropArray(edgeC);
+    dropArray(startX);		dropArray(startY);
+    dropArray(endX);		dropArray(endY);
+    dropArray(edgeFlags);
+    edgeTotal = 0;
+    edgeOverflow = false;
+    exactOrients = 0;
+    exactInCircles = 0;
+
+    /* release the last run in one shot */
+    arena.reset();
+
+    siteFirst.assign(siteX.size(), NONE);
+} // }}}
+
+void VoronoiDiagram::clear()
+{ // {{{
+    siteX.clear();	siteY.clear();
+    clearEdges();
+} // }}}
+
+///////////////////////////////////////////////////////////////////////////////
+// 	Sites
+// {{{
+
+int VoronoiDiagram::addSite(int x, int y)
+{ // {{{
+    siteX.push_back(x);		siteY.push_back(y);
+    siteFirst.push_back(NONE);
+    return siteCount() - 1;
+} // }}}
+
+void VoronoiDiagram::moveSite(int site, int x, int y)
+{ // {{{
+    siteX[site] = x;	siteY[site] = y;
+} // }}}
+
+void VoronoiDiagram::removeSite(int site)
+{ // {{{
+    int last = siteCount() - 1;
+    if (site != last) {
+	siteX[site] = siteX[last];	siteY[site] = siteY[last];
+	siteFirst[site] = siteFirst[last];
+
+	/* the ring of the moved site follows it */
+	int first = siteFirst[last], edge = first;
+	if (first != NONE) {
+	    do {
+		int next = nextEdge(last, edge);
+		if (edgeLeft[edge] == last)
+		    edgeLeft[edge] = site;
+		else
+		    edgeRight[edge] = site;
+		edge = next;
+	    } while (edge != first);
+	}
+    }
+    siteX.pop_back();	siteY.pop_back();
+    siteFirst.pop_back();
+} // }}}
+
+bool VoronoiDiagram::siteLess(int lhs, int rhs) const
+{ // {{{
+    if (siteX[lhs] == siteX[rhs])
+	return (siteY[lhs] < siteY[rhs]);
+    return (siteX[lhs] < siteX[rhs]);
+} // }}}
+
+void VoronoiDiagram::lineOf(int leftSite, int rightSite,
+	double &a, double &b, double &c) const
+{ // {{{
+    int xa = siteX[leftSite];	int ya = siteY[leftSite];
+    int xb = siteX[rightSite];	int yb = siteY[rightSite];
+
+    a = (double)ya-yb;
+    b = (double)xb-xa;
+    c = a * (double)xa + b * (double)ya;
+} // }}}
+
+int VoronoiDiagram::orient(int a, int b, int c) const
+{ // {{{
+    double bx = (double)siteX[b] - siteX[a], by = (double)siteY[b] - siteY[a];
+    double cx = (double)siteX[c] - siteX[a], cy = (double)siteY[c] - siteY[a];
+    double left = bx * cy, right = by * cx;
+    double det = left - right;
+    double terms = fabs(left) + fabs(right);
+    if (terms < EXACT_LIMIT || fabs(det) > ORIENT_BOUND * terms)
+	return (det > 0) ? 1 : ((det < 0) ? -1 : 0);
+
+    countExact(exactOrients);
+    ExactInt exactBx(siteX[b], siteX[a]), exactBy(siteY[b], siteY[a]);
+    ExactInt exactCx(siteX[c], siteX[a]), exactCy(siteY[c], siteY[a]);
+    return (exactBx * exactCy - exactBy * exactCx).sign();
+} // }}}
+
+bool VoronoiDiagram::inCircle(int a, int b, int c, int d) const
+{ // {{{
+    double ax = (double)siteX[a] - siteX[d], ay = (double)siteY[a] - siteY[d];
+    double bx = (double)siteX[b] - siteX[d], by = (double)siteY[b] - siteY[d];
+    double cx = (double)siteX[c] - siteX[d], cy = (double)siteY[c] - siteY[d];
+    double liftA = ax*ax + ay*ay, liftB = bx*bx + by*by, liftC = cx*cx + cy*cy;
+    double det = liftA * (bx*cy - by*cx) - liftB * (ax*cy - ay*cx) +
+	liftC * (ax*by - ay*bx);
+    double terms = liftA * (fabs(bx*cy) + fabs(by*cx)) +
+	liftB * (fabs(ax*cy) + fabs(ay*cx)) +
+	liftC * (fabs(ax*by) + fabs(ay*bx));
+    if (terms < EXACT_LIMIT || fabs(det) > INCIRCLE_BOUND * terms)
+	return det > 0;
+
+    countExact(exactInCircles);
+    ExactInt exactAx(siteX[a], siteX[d]), exactAy(siteY[a], siteY[d]);
+    ExactInt exactBx(siteX[b], siteX[d]), exactBy(siteY[b], siteY[d]);
+    ExactInt exactCx(siteX[c], siteX[d]), exactCy(siteY[c], siteY[d]);
+    ExactInt exactDet = 
+	(exactAx * exactAx + exactAy * exactAy) * 
+	    (exactBx * exactCy - exactBy * exactCx) -
+	(exactBx * exactBx + exactBy * exactBy) * 
+	    (exactAx * exactCy - exactAy * exactCx) +
+	(exactCx * exactCx + exactCy * exactCy) * 
+	    (exactAx * exactBy - exactAy * exactBx);
+    return exactDet.sign() > 0;
+} // }}}
+
+void VoronoiDiagram::countExact(unsigned long &counter) const
+{ // {{{
+    /* merges on several threads share the counters; this path is rare */
+    if (edgeLock != NULL)
+	edgeLock->lock();
+    counter++;
+    if (edgeLock != NULL)
+	edgeLock->unlock();
+} // }}}
+
+VoronoiCoord VoronoiDiagram::circumcenter(int a, int b, int c) const
+{ // {{{
+    VoronoiCoord from = circumcenterFrom(a, b, c);
+    return make_pair(siteX[c] + from.first, siteY[c] + from.second);
+} // }}}
+
+VoronoiCoord VoronoiDiagram::circumcenterFrom(int a, int b, int c) const
+{ // {{{
+    double ax = (double)siteX[a] - siteX[c], ay = (double)siteY[a] - siteY[c];
+    double bx = (double)siteX[b] - siteX[c], by = (double)siteY[b] - siteY[c];
+    double left = ax * by, right = ay * bx;
+    double terms = fabs(left) + fabs(right);
+    if (terms < EXACT_LIMIT || fabs(left - right) > ORIENT_BOUND * terms) {
+	double d = 2 * (left - right);
+	double ux = (by * (ax*ax + ay*ay) - ay * (bx*bx + by*by)) / d;
+	double uy = (ax * (bx*bx + by*by) - bx * (ax*ax + ay*ay)) / d;
+	return make_pair(ux, uy);
+    }
+
+    /*
+     * Nearly collinear far apart: the divisor may round to zero while
+     * orient() knows better, and the numerators lose as much, so all
+     * three are taken exactly and only rounded for the division.
+     */
+    ExactInt exactAx(siteX[a], siteX[c]), exactAy(siteY[a], siteY[c]);
+    ExactInt exactBx(siteX[b], siteX[c]), exactBy(siteY[b], siteY[c]);
+    ExactInt liftA = exactAx * exactAx + exactAy * exactAy;
+    ExactInt liftB = exactBx * exactBx + exactBy * exactBy;
+    double d = 2 * (exactAx * exactBy - exactAy * exactBx).toDouble();
+    double ux = (exactBy * liftA - exactAy * liftB).toDouble() / d;
+    double uy = (exactAx * liftB - exactBx * liftA).toDouble() / d;
+    return make_pair(ux, uy);
+} // }}}
+
+void VoronoiDiagram::awayFrom(int site, int other, int far,
+	double &dx, double &dy) const
+{ // {{{
+    /*
+     * Along the bisector of site and other, in the direction (dx, dy),
+     * the distance to far shrinks against the distance to site at a rate
+     * of orient(site, other, far); its exact sign picks the way.
+     */
+    dx = -((double)siteY[other] - siteY[site]);
+    dy = (double)siteX[other] - siteX[site];
+    if (orient(site, other, far) > 0) {
+	dx = -dx;
+	dy = -dy;
+    }
+} // }}}
+
+int VoronoiDiagram::findSlot(int site, int neighbor) const
+{ // {{{
+    /* the edge after which the direction to neighbor comes, if any */
+    int first = siteFirst[site];
+    if (first == NONE)
+	return NONE;
+
+    int edge = first;
+    do {
+	int next = nextEdge(site, edge);
+	if (next == edge || isBetween(site, otherSite(edge, site), neighbor, 
+		    otherSite(next, site)))
+	    return edge;
+	edge = next;
+    } while (edge != first);
+    return first;
+} // }}}
+
+bool VoronoiDiagram::isBetween(int site, int first, int neighbor, 
+	int second) const
+{ // {{{
+    /* neighbor is strictly inside the counterclockwise turn first..second */
+    if (orient(site, first, second) > 0)
+	return orient(site, first, neighbor) > 0 && 
+	    orient(site, neighbor, second) > 0;
+    return !(orient(site, second, neighbor) >= 0 && 
+	    orient(site, neighbor, first) >= 0);
+} // }}}
+
+void VoronoiDiagram::linkEdge(int edge, int site, int after)
+{ // {{{
+    /* put edge right after the edge after, counterclockwise */
+    if (after == NONE) {
+	siteFirst[site] = edge;
+	setNext(site, edge, edge);
+	setPrev(site, edge, edge);
+	return;
+    }
+    int next = nextEdge(site, after);
+    setNext(site, edge, next);
+    setPrev(site, edge, after);
+    setPrev(site, next, edge);
+    setNext(site, after, edge);
+} // }}}
+
+void VoronoiDiagram::setNext(int site, int edge, int next)
+{ // {{{
+    if (edgeLeft[edge] == site)
+	nextLeft[edge] = next;
+    else
+	nextRight[edge] = next;
+} // }}}
+
+void VoronoiDiagram::setPrev(int site, int edge, int prev)
+{ // {{{
+    if (edgeLeft[edge] == site)
+	prevLeft[edge] = prev;
+    else
+	prevRight[edge] = prev;
+} // }}}
+// }}}
+
+///////////////////////////////////////////////////////////////////////////////
+// 	Edges
+// {{{
+
+int VoronoiDiagram::newEdge()
+{ // {{{
+    int edge = NONE;
+    if (edgeLock != NULL) {
+	/* the arrays are shared, they can't grow now */
+	edgeLock->lock();
+	if (edgeTotal < (int)edgeLeft.size())
+	    edge = edgeTotal++;
+	else
+	    edgeOverflow = true;
+	edgeLock->unlock();
+    } else {
+	if (edgeTotal == (int)edgeLeft.size())
+	    resizeEdges(max(2 * edgeTotal, 16));
+	edge = edgeTotal++;
+    }
+    return edge;
+} // }}}
+
+int VoronoiDiagram::addEdge(int leftSite, int rightSite, int refSite,
+	double startPointX, double startPointY)
+{ // {{{
+    int edge = newEdge();
+    if (edge == NONE)
+	return NONE;
+    return reuseEdge(edge, leftSite, rightSite, refSite,
+	    startPointX, startPointY);
+} // }}}
+
+int VoronoiDiagram::reuseEdge(int edge, int leftSite, int rightSite,
+	int refSite, double startPointX, double startPointY)
+{ // {{{
+    double la, lb, lc;
+    lineOf(leftSite, rightSite, la, lb, lc);
+    double middleX = ((double)siteX[leftSite] + siteX[rightSite]) / 2;
+    double middleY = ((double)siteY[leftSite] + siteY[rightSite]) / 2;
+
+    edgeLeft[edge] = leftSite;		edgeRight[edge] = rightSite;
+    edgeRef[edge] = refSite;
+    edgeA[edge] = lb;
+    edgeB[edge] = la * (-1);
+    edgeC[edge] = lb * middleX - la * middleY;
+    startX[edge] = -1;		startY[edge] = -1;
+    endX[edge] = -1;		endY[edge] = -1;
+    edgeFlags[edge] = ENABLED;
+
+    /* not in the rings of its sites until linkEdge() */
+    nextLeft[edge] = NONE;	prevLeft[edge] = NONE;
+    nextRight[edge] = NONE;	prevRight[edge] = NONE;
+
+    if (refSite == NONE) { /* There is no reference point */
+	double bound[4];
+	findBoundIntersect(edge, bound);
+	double boundStartPointX = bound[0],	boundStartPointY = bound[1];
+	double boundEndPointX = bound[2],	boundEndPointY = bound[3];
+	if (boundStartPointY <= boundEndPointY) {
+	    setStart(edge, boundStartPointX, boundStartPointY, true);
+	    setEnd(edge, boundEndPointX, boundEndPointY, true);
+	} else {
+	    setStart(edge, boundEndPointX, boundEndPointY, true);
+	    setEnd(edge, boundStartPointX, boundStartPointY, true);
+	}
+    } else {	/* There is a reference point */
+	double dx, dy;
+	awayFrom(leftSite, rightSite, refSite, dx, dy);
+	setRayUnclipped(edge, startPointX, startPointY, dx, dy);
+    }
+    return edge;
+} // }}}
+
+void VoronoiDiagram::setStart(int edge, double x, double y, bool inf)
+{ // {{{
+    startX[edge] = x;	startY[edge] = y;
+    if (inf)
+	edgeFlags[edge] |= START_INF;
+    else
+	edgeFlags[edge] &= ~START_INF;
+} // }}}
+
+void VoronoiDiagram::setEnd(int edge, double x, double y, bool inf)
+{ // {{{
+    endX[edge] = x;	endY[edge] = y;
+    if (inf)
+	edgeFlags[edge] |= END_INF;
+    else
+	edgeFlags[edge] &= ~END_INF;
+} // }}}
+
+void VoronoiDiagram::reorderEdges(const IdArray &order)
+{ // {{{
+    /* order[i] is the edge which becomes edge i */
+    IntArray newId(edgeTotal, NONE, &arena);
+    for (unsigned int i=0; i<order.size(); i++)
+	newId[order[i]] = i;
+
+    int count = (int)order.size();
+    IntArray left(count, 0, &arena), right(count, 0, &arena);
+    IntArray ref(count, 0, &arena);
+    IntArray nextL(count, 0, &arena), prevL(count, 0, &arena);
+    IntArray nextR(count, 0, &arena), prevR(count, 0, &arena);
+    DoubleArray a(count, 0, &arena), b(count, 0, &arena);
+    DoubleArray c(count, 0, &arena);
+    DoubleArray sx(count, 0, &arena), sy(count, 0, &arena);
+    DoubleArray ex(count, 0, &arena), ey(count, 0, &arena);
+    FlagArray flags(count, 0, &arena);
+    for (int j=0; j<count; j++) {
+	int edge = order[j];
+	left[j] = edgeLeft[edge];	right[j] = edgeRight[edge];
+	ref[j] = edgeRef[edge];
+	nextL[j] = (nextLeft[edge] == NONE) ? NONE : newId[nextLeft[edge]];
+	prevL[j] = (prevLeft[edge] == NONE) ? NONE : newId[prevLeft[edge]];
+	nextR[j] = (nextRight[edge] == NONE) ? NONE : newId[nextRight[edge]];
+	prevR[j] = (prevRight[edge] == NONE) ? NONE : newId[prevRight[edge]];
+	a[j] = edgeA[edge];	b[j] = edgeB[edge];	c[j] = edgeC[edge];
+	sx[j] = startX[edge];	sy[j] = startY[edge];
+	ex[j] = endX[edge];	ey[j] = endY[edge];
+	flags[j] = edgeFlags[edge];
+    }
+    for (unsigned int k=0; k<siteFirst.size(); k++) {
+	if (siteFirst[k] != NONE)
+	    siteFirst[k] = newId[siteFirst[k]];
+    }
+
+    edgeLeft.swap(left);	edgeRight.swap(right);	edgeRef.swap(ref);
+    nextLeft.swap(nextL);	prevLeft.swap(prevL);
+    nextRight.swap(nextR);	prevRight.swap(prevR);
+    edgeA.swap(a);		edgeB.swap(b);		edgeC.swap(c);
+    startX.swap(sx);		startY.swap(sy);
+    endX.swap(ex);		endY.swap(ey);
+    edgeFlags.swap(flags);
+    edgeTotal = count;
+} // }}}
+
+void VoronoiDiagram::compactEdges()
+{ // {{{
+    IntArray newId(edgeTotal, NONE, &arena);
+    int count = 0;
+    for (int edge=0; edge<edgeTotal; edge++) {
+	if (isEnabled(edge))
+	    newId[edge] = count++;
+    }
+
+    /* edges only move down, onto slots already done with */
+    for (int edge=0; edge<edgeTotal; edge++) {
+	int j = newId[edge];
+	if (j == NONE)
+	    continue;
+	edgeLeft[j] = edgeLeft[edge];	edgeRight[j] = edgeRight[edge];
+	edgeRef[j] = edgeRef[edge];
+	nextLeft[j] = (nextLeft[edge] == NONE) ? NONE : newId[nextLeft[edge]];
+	prevLeft[j] = (prevLeft[edge] == NONE) ? NONE : newId[prevLeft[edge]];
+	nextRight[j] = (nextRight[edge] == NONE) ? NONE :
+	    newId[nextRight[edge]];
+	prevRight[j] = (prevRight[edge] == NONE) ? NONE :
+	    newId[prevRight[edge]];
+	edgeA[j] = edgeA[edge];	edgeB[j] = edgeB[edge];	edgeC[j] = edgeC[edge];
+	startX[j] = startX[edge];	startY[j] = startY[edge];
+	endX[j] = endX[edge];		endY[j] = endY[edge];
+	edgeFlags[j] = edgeFlags[edge];
+    }
+    for (unsigned int k=0; k<siteFirst.size(); k++) {
+	if (siteFirst[k] != NONE)
+	    siteFirst[k] = newId[siteFirst[k]];
+    }
+    edgeTotal = count;
+} // }}}
+
+int VoronoiDiagram::getComPoint(int edge, int line) const
+{ // {{{
+    if (edgeLeft[edge] == edgeLeft[line] || edgeLeft[edge] == edgeRight[line])
+	return edgeLeft[edge];
+    if (edgeRight[edge] == edgeLeft[line] || edgeRight[edge] == edgeRight[line])
+	return edgeRight[edge];
+    return NONE;
+} // }}}
+
+bool VoronoiDiagram::isSameEdge(int edge, int line) const
+{ // {{{
+    return hasSites(edge, edgeLeft[line], edgeRight[line]);
+} // }}}
+
+bool VoronoiDiagram::hasSites(int edge, int leftSite, int rightSite) const
+{ // {{{
+    return ((edgeLeft[edge] == leftSite && edgeRight[edge] == rightSite) ||
+	    (edgeLeft[edge] == rightSite && edgeRight[edge] == leftSite));
+} // }}}
+
+VoronoiDiagram::LineType VoronoiDiagram::getLineType(int edge) const
+{ // {{{
+    int type = 0;
+    if (isStartPointINF(edge))
+	type++;
+    if (isEndPointINF(edge))
+	type++;
+
+    return (VoronoiDiagram::LineType)type;
+} // }}}
+
+int VoronoiDiagram::findBoundIntersect(int edge, double bound[4]) const
+{ // {{{
+    double a = edgeA[edge], b = edgeB[edge], c = edgeC[edge];
+    double left = box.getMinX(),	top = box.getMinY();
+    double right = box.getMaxX(),	bottom = box.getMaxY();
+    double found[8];
+    int count = 0;
+
+    bound[0] = bound[1] = bound[2] = bound[3] = -1;
+    if (a == 0 && b != 0) {
+	found[0] = left;	found[1] = (c/b);
+	found[2] = right;	found[3] = (c/b);
+	count = 2;
+    } else if (b == 0 && a != 0) {
+	found[0] = (c/a);	found[1] = top;
+	found[2] = (c/a);	found[3] = bottom;
+	count = 2;
+    } else {
+	double tmp1, tmp2, tmp3, tmp4;
+	tmp1 = (c - a*left)/b;		/* intersect with x = left */
+	tmp2 = (c - b*top)/a;		/* intersect with y = top */
+	tmp3 = (c - a*right)/b;		/* intersect with x = right */
+	tmp4 = (c - b*bottom)/a;	/* intersect with y = bottom */
+
+	if (tmp1 >= top && tmp1 <= bottom) {
+	    found[2*count] = left;	found[2*count+1] = tmp1;	count++;
+	}
+	if (tmp2 >= left && tmp2 <= right) {
+	    found[2*count] = tmp2;	found[2*count+1] = top;		count++;
+	}
+	if (tmp3 >= top && tmp3 <= bottom) {
+	    found[2*count] = right;	found[2*count+1] = tmp3;	count++;
+	}
+	if (tmp4 >= left && tmp4 <= right) {
+	    found[2*count] = tmp4;	found[2*count+1] = bottom;	count++;
+	}
+    }
+
+    for (int i=0; i<count && i<2; i++) {
+	bound[2*i] = found[2*i];
+	bound[2*i+1] = found[2*i+1];
+    }
+    return count;
+} // }}}
+
+void VoronoiDiagram::setSegment(int edge,
+	double xa, double ya, double xb, double yb)
+{ // {{{
+    setStart(edge, xa, ya, false);
+    setEnd(edge, xb, yb, false);
+} // }}}
+
+void VoronoiDiagram::setRay(int edge, double x, double y,
+	double dx, double dy)
+{ // {{{
+    /* the infinity end is where the ray leaves the box */
+    double farX, farY;
+    RayClipper(box).clip(&x, &y, &dx, &dy, 1, &farX, &farY);
+    setStart(edge, x, y, false);
+    setEnd(edge, farX, farY, true);
+} // }}}
+
+void VoronoiDiagram::setRayUnclipped(int edge, double x, double y,
+	double dx, double dy)
+{ // {{{
+    double reach = box.getMaxX() - box.getMinX() + 
+	    box.getMaxY() - box.getMinY();
+    /* clipEdges() reads the direction back; far out it must not round off */
+    if (x < box.getMinX() || x > box.getMaxX() || 
+	    y < box.getMinY() || y > box.getMaxY())
+	reach = max(reach, fabs(x) + fabs(y));
+    double along = reach / (fabs(dx) + fabs(dy));
+    setStart(edge, x, y, false);
+    setEnd(edge, x + dx * along, y + dy * along, true);
+} // }}}
+
+void VoronoiDiagram::clipEdges()
+{ // {{{
+    /* the rays go to the clipper in packed arrays and come back */
+    IntArray rays(&arena);
+    for (int edge=0; edge<edgeTotal; edge++) {
+	if (isEnabled(edge) && getLineType(edge) == ONE_INF)
+	    rays.push_back(edge);
+    }
+    int count = (int)rays.size();
+    DoubleArray x(count, 0, &arena), y(count, 0, &arena);
+    DoubleArray dx(count, 0, &arena), dy(count, 0, &arena);
+    DoubleArray farX(count, 0, &arena), farY(count, 0, &arena);
+    for (int i=0; i<count; i++) {
+	int edge = rays[i];
+	bool startINF = isStartPointINF(edge);
+	x[i] = startINF ? endX[edge] : startX[edge];
+	y[i] = startINF ? endY[edge] : startY[edge];
+	dx[i] = (startINF ? startX[edge] : endX[edge]) - x[i];
+	dy[i] = (startINF ? startY[edge] : endY[edge]) - y[i];
+    }
+    if (count > 0) {
+	RayClipper(box).clip(&x[0], &y[0], &dx[0], &dy[0], count, 
+		&farX[0], &farY[0]);
+    }
+    for (int j=0; j<count; j++) {
+	int edge = rays[j];
+	if (isStartPointINF(edge))
+	    setStart(edge, farX[j], farY[j], true);
+	else
+	    setEnd(edge, farX[j], farY[j], true);
+    }
+} // }}}
+
+void VoronoiDiagram::disable(int edge)
+{ // {{{
+    edgeFlags[edge] &= ~ENABLED;
+
+    /* a disabled edge leaves the rings of both of its sites */
+    int site[2] = { edgeLeft[edge], edgeRight[edge] };
+    for (int i=0; i<2; i++) {
+	int next = nextEdge(site[i], edge);
+	int prev = prevEdge(site[i], edge);
+	if (next == NONE)
+	    continue;		/* never linked */
+	if (next == edge) {
+	    siteFirst[site[i]] = NONE;
+	} else {
+	    setNext(site[i], prev, next);
+	    setPrev(site[i], next, prev);
+	    if (siteFirst[site[i]] == edge)
+		siteFirst[site[i]] = next;
+	}
+    }
+    nextLeft[edge] = NONE;	prevLeft[edge] = NONE;
+    nextRight[edge] = NONE;	prevRight[edge] = NONE;
+} // }}}
+
+void VoronoiDiagram::cutByIntersect(int edge, int cutter,
+	double intersectX, double intersectY)
+{ // {{{
+    int site = (cutter == NONE) ? NONE : getComPoint(edge, cutter);
+    if (site == NONE)
+	return;
+
+    /* the part kept runs from the intersection away from the far site */
+    double dx, dy;
+    awayFrom(site, otherSite(edge, site), otherSite(cutter, site), dx, dy);
+
+    /* the end further along stays, an infinite one only if it is ahead */
+    bool keepEnd = (endX[edge] - startX[edge]) * dx + 
+	(endY[edge] - startY[edge]) * dy > 0;
+    double keptX = keepEnd ? endX[edge] : startX[edge];
+    double keptY = keepEnd ? endY[edge] : startY[edge];
+    bool keptINF = keepEnd ? isEndPointINF(edge) : isStartPointINF(edge);
+    if (keptINF && (keptX - intersectX) * dx + (keptY - intersectY) * dy <= 0)
+	setRayUnclipped(edge, intersectX, intersectY, dx, dy);
+    else if (keepEnd)
+	setStart(edge, intersectX, intersectY, false);
+    else
+	setEnd(edge, intersectX, intersectY, false);
+} // }}}
+
+// }}}
@@ -0,0 +1,200 @@
+#ifndef DIAGRAM_H
+#define DIAGRAM_H
+
+#include <stdlib.h>
+#include <vector>
+#include <utility>
+
+#include "arena.h"
+
+class VoronoiMutex;
+
+/*
+ * GUI-free building blocks of the Voronoi diagram.  Nothing in here knows
+ * about QCanvas; DiagramView only renders what VoronoiAlgo leaves in a
+ * VoronoiDiagram.
+ */
+
+typedef std::pair<double, double> VoronoiCoord;
+typedef ArenaVector<int>::type IdArray;		/* site or edge ids */
+
+class VoronoiBox
+{
+    public:
+	VoronoiBox(double minX = 0, double minY = 0,
+		double maxX = 0, double maxY = 0)
+	    : minX(minX), minY(minY), maxX(maxX), maxY(maxY) {};
+	double getMinX() const { return minX; };
+	double getMinY() const { return minY; };
+	double getMaxX() const { return maxX; };
+	double getMaxY() const { return maxY; };
+
+    private:
+	double minX, minY, maxX, maxY;
+};
+
+/*
+ * The sites and the resulting edges of one run, stored as parallel arrays
+ * and addressed by integer ids.  Two sites are the same site iff their ids
+ * are equal, so the sites must be free of duplicates, and sorted by (x, y)
+ * before VoronoiAlgo::start() is called; sortSites() does both.
+ *
+ * Every site keeps its live edges in a ring, sorted counterclockwise by the
+ * direction to the site on the other side and doubly linked through the
+ * edge arrays (two links per end of an edge), so adding or removing an
+ * edge never allocates per site.  addEdge() leaves a new edge out of the
+ * rings; VoronoiAlgo links it where it belongs with linkEdge(), and
+ * disable() takes it out again.
+ *
+ * Everything written by a calculation, including the scratch space of
+ * VoronoiAlgo, comes from the arena and is dropped at once by clearEdges().
+ *
+ * Edges of disjoint sets of sites may be added from several threads once
+ * setEdgeLock() is given a lock.  The edge arrays can't move then, so the
+ * edges come from the slots made by reserveEdges() and addEdge() returns
+ * NONE after setting isEdgeOverflow() when they run out.
+ */
+class VoronoiDiagram
+{
+    public:
+	enum { NONE = -1 };
+	enum LineType { NO_INF = 0, ONE_INF = 1, TWO_INF = 2 };
+
+	VoronoiDiagram(const VoronoiBox &box);
+	const VoronoiBox & getBox() const { return box; };
+	void setBox(const VoronoiBox &newBox) { box = newBox; };
+	VoronoiArena & getArena() { return arena; };
+	const VoronoiArena & getArena() const { return arena; };
+	void sortSites(int threads = 1);
+	void reserveEdges(int count);
+	/* slots for edges, edgeCount() of them in use */
+	int edgeCapacity() const { return (int)edgeLeft.size(); };
+	void clearEdges();
+	void clear();
+	void setEdgeLock(VoronoiMutex *lock) { edgeLock = lock; };
+	bool isEdgeOverflow() const { return edgeOverflow; };
+	void reorderEdges(const IdArray &order);
+	/* drops the disabled edges in place; the others keep their order */
+	void compactEdges();
+
+	/* sites */
+	int addSite(int x, int y);
+	/* for a site with no live edges; the last site takes over its id */
+	void removeSite(int site);
+	/* for a site with no live edges */
+	void moveSite(int site, int x, int y);
+	int siteCount() const { return (int)siteX.size(); };
+	int getX(int site) const { return siteX[site]; };
+	int getY(int site) const { return siteY[site]; };
+	bool siteLess(int lhs, int rhs) const;
+	void lineOf(int leftSite, int rightSite,
+		double &a, double &b, double &c) const;
+	/*
+	 * Exact: a floating point filter answers most calls, integer
+	 * arithmetic the rest.  1 if a, b, c turn counterclockwise (x to the
+	 * right, y up), -1 clockwise, 0 on a line.
+	 */
+	int orient(int a, int b, int c) const;
+	/* d is inside the circle through the counterclockwise a, b, c */
+	bool inCircle(int a, int b, int c, int d) const;
+	/* the calls the filter left to the exact path since clearEdges() */
+	unsigned long getExactOrients() const { return exactOrients; };
+	unsigned long getExactInCircles() const { return exactInCircles; };
+	VoronoiCoord circumcenter(int a, int b, int c) const;
+	/* the same less site c, before the rounding of adding it back */
+	VoronoiCoord circumcenterFrom(int a, int b, int c) const;
+	/* along the bisector of site and other, away from the region of far */
+	void awayFrom(int site, int other, int far,
+		double &dx, double &dy) const;
+
+	/* the ring of edges around a site */
+	int firstEdge(int site) const { return siteFirst[site]; };
+	int nextEdge(int site, int edge) const
+	{ return (edgeLeft[edge] == site) ? nextLeft[edge] : nextRight[edge]; };
+	int prevEdge(int site, int edge) const
+	{ return (edgeLeft[edge] == site) ? prevLeft[edge] : prevRight[edge]; };
+	int otherSite(int edge, int site) const
+	{ return (edgeLeft[edge] == site) ? edgeRight[edge] : edgeLeft[edge]; };
+	int findSlot(int site, int neighbor) const;
+	void linkEdge(int edge, int site, int after);
+
+	/* edges */
+	int addEdge(int leftSite, int rightSite, int refSite = NONE,
+		double startX = -1, double startY = -1);
+	/* addEdge() into the slot of a disabled edge nothing refers to */
+	int reuseEdge(int edge, int leftSite, int rightSite, int refSite,
+		double startX, double startY);
+	int edgeCount() const { return edgeTotal; };
+	int getLeftPoint(int edge) const { return edgeLeft[edge]; };
+	int getRightPoint(int edge) const { return edgeRight[edge]; };
+	int getRefPoint(int edge) const { return edgeRef[edge]; };
+	int getComPoint(int edge, int line) const;
+	bool isSameEdge(int edge, int line) const;
+	bool hasSites(int edge, int leftSite, int rightSite) const;
+	double getA(int edge) const { return edgeA[edge]; };
+	double getB(int edge) const { return edgeB[edge]; };
+	double getC(int edge) const { return edgeC[edge]; };
+	LineType getLineType(int edge) const;
+	bool isStartPointINF(int edge) const
+	{ return (edgeFlags[edge] & START_INF) != 0; };
+	bool isEndPointINF(int edge) const
+	{ return (edgeFlags[edge] & END_INF) != 0; };
+	VoronoiCoord getStartPoint(int edge) const
+	{ return std::make_pair(startX[edge], startY[edge]); };
+	VoronoiCoord getEndPoint(int edge) const
+	{ return std::make_pair(endX[edge], endY[edge]); };
+	/* for the edges whose Voronoi vertices are known up front */
+	void setSegment(int edge, double xa, double ya, double xb, double yb);
+	void setRay(int edge, double x, double y, double dx, double dy);
+	/* a ray whose far end is only somewhere ahead until clipEdges() */
+	void setRayUnclipped(int edge, double x, double y,
+		double dx, double dy);
+	/* one end as it was, for a diagram read back (see VoronoiCache) */
+	void setStart(int edge, double x, double y, bool inf);
+	void setEnd(int edge, double x, double y, bool inf);
+	/* moves the far ends of all the rays to where they leave the box */
+	void clipEdges();
+	/* keeps the part of edge on the side of their common site */
+	void cutByIntersect(int edge, int cutter,
+		double intersectX, double intersectY);
+	void disable(int edge);
+	bool isEnabled(int edge) const
+	{ return (edgeFlags[edge] & ENABLED) != 0; };
+
+    private:
+	enum { ENABLED = 1, START_INF = 2, END_INF = 4 };
+	typedef ArenaVector<int>::type IntArray;
+	typedef ArenaVector<double>::type DoubleArray;
+	typedef ArenaVector<unsigned char>::type FlagArray;
+
+	VoronoiDiagram(const VoronoiDiagram &);
+	VoronoiDiagram & operator=(const VoronoiDiagram &);
+	int newEdge();
+	void resizeEdges(int count);
+	void setNext(int site, int edge, int next);
+	void setPrev(int site, int edge, int prev);
+	bool isBetween(int site, int first, int neighbor, int second) const;
+	int findBoundIntersect(int edge, double bound[4]) const;
+	void countExact(unsigned long &counter) const;
+
+	VoronoiBox box;
+	VoronoiArena arena;
+
+	/* sites */
+	std::vector<int> siteX, siteY;
+	IntArray siteFirst;		/* any edge of the ring */
+
+	/* edges, the arrays hold edgeTotal edges and some spare slots */
+	int edgeTotal;
+	VoronoiMutex *edgeLock;
+	bool edgeOverflow;
+	mutable unsigned long exactOrients, exactInCircles;
+	IntArray edgeLeft, edgeRight, edgeRef;
+	IntArray nextLeft, prevLeft;	/* counterclockwise around the sites */
+	IntArray nextRight, prevRight;
+	DoubleArray edgeA, edgeB, edgeC;	/* For ax+by=c */
+	DoubleArray startX, startY, endX, endY;
+	FlagArray edgeFlags;
+};
+
+#endif
@@ -0,0 +1,200 @@
+#include <string.h>
+
+#include <vector>
+
+#include "dcel.h"
+#include "diagfile.h"
+#include "diagram.h"
+#include "diagwriter.h"
+
+using namespace std;
+
+/* Records that go to fwrite() at once */
+static const unsigned int BLOCK = 4096;
+
+/* Collects the records of a section and writes them a block at a time */
+template <class T>
+class SectionWriter
+{
+    public:
+	SectionWriter(FILE *out, bool &good) : out(out), good(good) {};
+	~SectionWriter() { flush(); };
+	void put(const T &record)
+	{
+	    block.push_back(record);
+	    if (block.size() == BLOCK)
+		flush();
+	};
+	void flush()
+	{
+	    if (!block.empty() &&
+		    fwrite(&block[0], sizeof(T), block.size(), out) !=
+		    block.size())
+		good = false;
+	    block.clear();
+	};
+
+    private:
+	FILE *out;
+	bool &good;
+	std::vector<T> block;
+};
+
+static uint64_t alignUp(uint64_t offset)
+{ // {{{
+    return (offset + 7) & ~(uint64_t)7;
+} // }}}
+
+VoronoiFileWriter::VoronoiFileWriter(const VoronoiDiagram &diagram,
+	const VoronoiDcel &dcel)
+    : diagram(diagram), dcel(dcel), adjacency(false)
+{ // {{{
+} // }}}
+
+bool VoronoiFileWriter::write(FILE *out)
+{ // {{{
+    int sites = diagram.siteCount(), vertices = dcel.vertexCount();
+    int edges = dcel.halfEdgeCount() / 2;
+
+    /* the edges of the file by the edges of the diagram, for the rings */
+    vector<int> pairOf(diagram.edgeCount(), VoronoiDiagram::NONE);
+    for (int i=0; i<edges; i++)
+	pairOf[dcel.getEdge(2 * i)] = i;
+    vector<uint32_t> first;
+    if (adjacency) {
+	first.assign(sites + 1, 0);
+	for (int site=0; site<sites; site++) {
+	    uint32_t length = 0;
+	    int edge = diagram.firstEdge(site);
+	    if (edge != VoronoiDiagram::NONE) {
+		do {
+		    length++;
+		    edge = diagram.nextEdge(site, edge);
+		} while (edge != diagram.firstEdge(site));
+	    }
+	    first[site+1] = first[site] + length;
+	}
+    }
+
+    /* everything is placed before the first byte goes out */
+    VoronoiFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "VORODIAG", 8);
+    header.version = VORONOI_FILE_VERSION;
+    header.byteOrder = VORONOI_FILE_BYTE_ORDER;
+    header.flags = adjacency ? VORONOI_FILE_HAS_ADJACENCY : 0;
+    header.headerSize = sizeof(header);
+    header.siteCount = sites;
+    header.vertexCount = vertices;
+    header.edgeCount = edges;
+    header.adjacencyCount = adjacency ? first[sites] : 0;
+    header.minX = diagram.getBox().getMinX();
+    header.minY = diagram.getBox().getMinY();
+    header.maxX = diagram.getBox().getMaxX();
+    header.maxY = diagram.getBox().getMaxY();
+    header.siteOffset = alignUp(sizeof(header));
+    header.vertexOffset = alignUp(header.siteOffset +
+	    (uint64_t)sites * sizeof(VoronoiFileSite));
+    header.edgeOffset = alignUp(header.vertexOffset +
+	    (uint64_t)vertices * sizeof(VoronoiFileVertex));
+    header.fileSize = header.edgeOffset +
+	(uint64_t)edges * sizeof(VoronoiFileEdge);
+    if (adjacency) {
+	header.firstOffset = alignUp(header.fileSize);
+	header.adjacencyOffset = alignUp(header.firstOffset +
+		(uint64_t)(sites + 1) * sizeof(uint32_t));
+	header.fileSize = header.adjacencyOffset +
+	    (uint64_t)header.adjacencyCount * sizeof(int32_t);
+    }
+
+    bool good = (fwrite(&header, sizeof(header), 1, out) == 1);
+    {
+	SectionWriter<VoronoiFileSite> section(out, good);
+	for (int site=0; site<sites; site++) {
+	    VoronoiFileSite record;
+	    record.x = diagram.getX(site);
+	    record.y = diagram.getY(site);
+	    section.put(record);
+	}
+    }
+    {
+	SectionWriter<VoronoiFileVertex> section(out, good);
+	for (int vertex=0; vertex<vertices; vertex++) {
+	    VoronoiFileVertex record;
+	    record.x = dcel.getX(vertex);
+	    record.y = dcel.getY(vertex);
+	    section.put(record);
+	}
+    }
+    {
+	SectionWriter<VoronoiFileEdge> section(out, good);
+	for (int i=0; i<edges; i++) {
+	    int edge = dcel.getEdge(2 * i);
+	    int left = dcel.face(2 * i), right = dcel.face(2 * i + 1);
+	    VoronoiFileEdge record;
+	    memset(&record, 0, sizeof(record));
+	    record.site[0] = left;
+	    record.site[1] = right;
+	    record.vertex[0] = dcel.origin(2 * i);
+	    record.vertex[1] = dcel.origin(2 * i + 1);
+
+	    /*
+	     * End 0 is where VoronoiDcel::placeVertex() puts the origin of
+	     * half-edge 2i: the finite end of a ray that has it, else the
+	     * end furthest back along the face of the left site.
+	     */
+	    VoronoiCoord start = diagram.getStartPoint(edge);
+	    VoronoiCoord end = diagram.getEndPoint(edge);
+	    double dx = -((double)diagram.getY(right) - diagram.getY(left));
+	    double dy = (double)diagram.getX(right) - diagram.getX(left);
+	    bool startFirst = (start.first * dx + start.second * dy <=
+		    end.first * dx + end.second * dy);
+	    if (diagram.getLineType(edge) == VoronoiDiagram::ONE_INF) {
+		startFirst = (record.vertex[0] != VORONOI_FILE_NO_VERTEX) ?
+		    !diagram.isStartPointINF(edge) :
+		    diagram.isStartPointINF(edge);
+	    }
+	    VoronoiCoord point[2] = { startFirst ? start : end,
+		startFirst ? end : start };
+	    bool infinite[2] = {
+		startFirst ? diagram.isStartPointINF(edge) :
+		    diagram.isEndPointINF(edge),
+		startFirst ? diagram.isEndPointINF(edge) :
+		    diagram.isStartPointINF(edge) };
+	    for (int k=0; k<2; k++) {
+		if (record.vertex[k] != VORONOI_FILE_NO_VERTEX) {
+		    point[k].first = dcel.getX(record.vertex[k]);
+		    point[k].second = dcel.getY(record.vertex[k]);
+		}
+		record.x[k] = point[k].first;
+		record.y[k] = point[k].second;
+		if (infinite[k])
+		    record.flags |= VORONOI_FILE_END0_INF << k;
+	    }
+	    section.put(record);
+	}
+    }
+    if (adjacency) {
+	static const char padding[8] = { 0 };
+	size_t gap = header.firstOffset - (header.edgeOffset +
+		(uint64_t)edges * sizeof(VoronoiFileEdge));
+	good = good && fwrite(padding, 1, gap, out) == gap;
+	good = good && fwrite(&first[0], sizeof(uint32_t), first.size(), out)
+	    == first.size();
+	gap = header.adjacencyOffset - (header.firstOffset +
+		(uint64_t)(sites + 1) * sizeof(uint32_t));
+	good = good && fwrite(padding, 1, gap, out) == gap;
+
+	SectionWriter<int32_t> section(out, good);
+	for (int site=0; site<sites; site++) {
+	    int edge = diagram.firstEdge(site);
+	    if (edge == VoronoiDiagram::NONE)
+		continue;
+	    do {
+		section.put(pairOf[edge]);
+		edge = diagram.nextEdge(site, edge);
+	    } while (edge != diagram.firstEdge(site));
+	}
+    }
+    return good;
+} // }}}
@@ -0,0 +1,31 @@
+#ifndef DIAGWRITER_H
+#define DIAGWRITER_H
+
+#include <stdio.h>
+
+class VoronoiDiagram;
+class VoronoiDcel;
+
+/*
+ * Writes a finished diagram as a diagram file (see diagfile.h), front to
+ * back in one pass, so the output may be a pipe.  The vertices and the
+ * half-edges are the ones of the VoronoiDcel built from the diagram, and
+ * file edge i is its twin pair i.
+ */
+class VoronoiFileWriter
+{
+    public:
+	VoronoiFileWriter(const VoronoiDiagram &diagram,
+		const VoronoiDcel &dcel);
+	/* the ring of edges around every site too */
+	void setAdjacency(bool on) { adjacency = on; };
+	/* false if writing failed (see errno) */
+	bool write(FILE *out);
+
+    private:
+	const VoronoiDiagram &diagram;
+	const VoronoiDcel &dcel;
+	bool adjacency;
+};
+
+#endif
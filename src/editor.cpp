@@ -0,0 +1,507 @@
+#include <math.h>
+
+#include <algorithm>
+
+#include "diagram.h"
+#include "editor.h"
+
+using namespace std;
+
+/* Orders sites counterclockwise by their direction from one site */
+class AroundLess
+{
+    public:
+	AroundLess(const VoronoiDiagram &diagram, int center)
+	    : diagram(diagram), center(center) {};
+	bool operator() (int lhs, int rhs) const
+	{
+	    double ax = dx(lhs), ay = dy(lhs), bx = dx(rhs), by = dy(rhs);
+	    bool upperA = (ay > 0 || (ay == 0 && ax > 0));
+	    bool upperB = (by > 0 || (by == 0 && bx > 0));
+	    if (upperA != upperB)
+		return upperA;
+	    /* the cross product of 33-bit differences needs the exact sign */
+	    return diagram.orient(center, lhs, rhs) > 0;
+	};
+
+    private:
+	double dx(int site) const
+	{ return (double)diagram.getX(site) - diagram.getX(center); };
+	double dy(int site) const
+	{ return (double)diagram.getY(site) - diagram.getY(center); };
+
+	const VoronoiDiagram &diagram;
+	int center;
+};
+
+VoronoiEditor::VoronoiEditor(VoronoiDiagram &diagram)
+    : diagram(diagram), hint(VoronoiDiagram::NONE), stamp(0)
+{ // {{{
+} // }}}
+
+double VoronoiEditor::distance(int site, int x, int y) const
+{ // {{{
+    double dx = (double)diagram.getX(site) - x;
+    double dy = (double)diagram.getY(site) - y;
+    return dx * dx + dy * dy;
+} // }}}
+
+int VoronoiEditor::nearestSite(int x, int y)
+{ // {{{
+    return locate(x, y, VoronoiDiagram::NONE);
+} // }}}
+
+int VoronoiEditor::locate(int x, int y, int skip)
+{ // {{{
+    /*
+     * Start from the last change or the best of a few sites spread out,
+     * all of them in the rings; with no rings to walk look at them all.
+     */
+    int count = diagram.siteCount();
+    int site = VoronoiDiagram::NONE;
+    if (hint != VoronoiDiagram::NONE && hint < count && hint != skip &&
+	    diagram.firstEdge(hint) != VoronoiDiagram::NONE)
+	site = hint;
+    int step = max(1, count / (int)(pow((double)count, 1.0 / 3) + 1));
+    for (int i=0; i<count; i+=step) {
+	if (i != skip && diagram.firstEdge(i) != VoronoiDiagram::NONE &&
+		(site == VoronoiDiagram::NONE ||
+		 distance(i, x, y) < distance(site, x, y)))
+	    site = i;
+    }
+    if (site == VoronoiDiagram::NONE) {
+	for (int i=0; i<count; i++) {
+	    if (i != skip && (site == VoronoiDiagram::NONE ||
+			distance(i, x, y) < distance(site, x, y)))
+		site = i;
+	}
+	return site;
+    }
+
+    /* then walk to a nearer neighbor while there is one */
+    for (;;) {
+	int best = site;
+	int first = diagram.firstEdge(site), edge = first;
+	do {
+	    int other = diagram.otherSite(edge, site);
+	    if (distance(other, x, y) < distance(best, x, y))
+		best = other;
+	    edge = diagram.nextEdge(site, edge);
+	} while (edge != first);
+	if (best == site)
+	    break;
+	site = best;
+    }
+    hint = site;
+    return site;
+} // }}}
+
+int VoronoiEditor::insertSite(int x, int y)
+{ // {{{
+    touched.clear();
+    int nearest = nearestSite(x, y);
+    if (nearest != VoronoiDiagram::NONE &&
+	    diagram.getX(nearest) == x && diagram.getY(nearest) == y)
+	return VoronoiDiagram::NONE;
+
+    int site = diagram.addSite(x, y);
+    placeSite(site, nearest);
+    return site;
+} // }}}
+
+bool VoronoiEditor::moveSite(int site, int x, int y)
+{ // {{{
+    /*
+     * Out of the diagram and back in at the new place: both repairs stay
+     * within the cells next to the site, there and here.
+     */
+    touched.clear();
+    int oldX = diagram.getX(site), oldY = diagram.getY(site);
+    if (oldX == x && oldY == y)
+	return true;
+    if (diagram.firstEdge(site) != VoronoiDiagram::NONE)
+	fillHole(site);
+
+    int nearest = locate(x, y, site);
+    bool moved = (nearest == VoronoiDiagram::NONE ||
+	    diagram.getX(nearest) != x || diagram.getY(nearest) != y);
+    if (!moved) {
+	x = oldX;
+	y = oldY;
+	nearest = locate(x, y, site);
+    }
+    diagram.moveSite(site, x, y);
+    placeSite(site, nearest);
+    return moved;
+} // }}}
+
+void VoronoiEditor::placeSite(int site, int nearest)
+{ // {{{
+    hint = site;
+    if (nearest == VoronoiDiagram::NONE)
+	return;
+
+    findCavity(site, nearest);
+
+    /* the edges inside go, those around are cut at the new vertices */
+    for (unsigned int i=0; i<inner.size(); i++) {
+	if (diagram.isEnabled(inner[i])) {
+	    diagram.disable(inner[i]);
+	    touched.push_back(inner[i]);
+	}
+    }
+    for (unsigned int j=0; j<sides.size(); j++) {
+	cutSide(sides[j],
+		diagram.circumcenter(sides[j].one, sides[j].two, site));
+    }
+
+    /* sites collinear with all the others may have no cavity at all */
+    if (neighbors.empty())
+	neighbors.push_back(nearest);
+    fanOut(site);
+} // }}}
+
+bool VoronoiEditor::isOpen(int site, int edge) const
+{ // {{{
+    int next = diagram.nextEdge(site, edge);
+    return next == edge || diagram.orient(site,
+	    diagram.otherSite(edge, site), diagram.otherSite(next, site)) <= 0;
+} // }}}
+
+bool VoronoiEditor::isConflict(int site, int edge, int newSite) const
+{ // {{{
+    int other = diagram.otherSite(edge, site);
+    if (!isOpen(site, edge)) {
+	int next = diagram.otherSite(diagram.nextEdge(site, edge), site);
+	return diagram.inCircle(site, other, next, newSite);
+    }
+
+    /* outside the hull edge from other to site, or right on it */
+    int turn = diagram.orient(other, site, newSite);
+    if (turn != 0)
+	return turn < 0;
+    double ax = (double)diagram.getX(newSite) - diagram.getX(other);
+    double ay = (double)diagram.getY(newSite) - diagram.getY(other);
+    double bx = (double)diagram.getX(site) - diagram.getX(other);
+    double by = (double)diagram.getY(site) - diagram.getY(other);
+    double along = ax * bx + ay * by;
+    return along > 0 && along < bx * bx + by * by;
+} // }}}
+
+void VoronoiEditor::visit(int site, int edge, int newSite)
+{ // {{{
+    if (isMarked(visited, site, edge))
+	return;
+
+    /* a closed corner is seen from all three of its sites */
+    int corners[3], count = 0;
+    corners[count++] = corner(site, edge);
+    if (!isOpen(site, edge)) {
+	int other = diagram.otherSite(edge, site);
+	int next = diagram.nextEdge(site, edge);
+	corners[count++] = corner(other, diagram.prevEdge(other, edge));
+	corners[count++] = corner(diagram.otherSite(next, site), next);
+    }
+
+    bool found = isConflict(site, edge, newSite);
+    for (int i=0; i<count; i++) {
+	visited[corners[i]] = stamp;
+	if (found)
+	    conflict[corners[i]] = stamp;
+    }
+    if (found) {
+	cavity.push_back(site);
+	cavity.push_back(edge);
+    }
+} // }}}
+
+void VoronoiEditor::findCavity(int newSite, int nearest)
+{ // {{{
+    /*
+     * Bowyer-Watson on the rings: the corners whose circles hold the new
+     * site make up a cavity reached from the nearest site.  No site goes
+     * away, so all sites of those corners end up next to the new one.
+     */
+    stamp++;
+    cavity.clear();
+    neighbors.clear();
+    inner.clear();
+    sides.clear();
+    visited.resize(2 * diagram.edgeCount(), 0);
+    conflict.resize(2 * diagram.edgeCount(), 0);
+
+    int first = diagram.firstEdge(nearest), edge = first;
+    if (first == VoronoiDiagram::NONE)
+	return;
+    do {
+	/* an open cell also reaches out past the hull edge from it */
+	visit(nearest, edge, newSite);
+	visit(diagram.otherSite(edge, nearest), edge, newSite);
+	edge = diagram.nextEdge(nearest, edge);
+    } while (edge != first);
+
+    for (unsigned int i=0; i<cavity.size(); i+=2) {
+	int site = cavity[i], edge = cavity[i+1];
+	int other = diagram.otherSite(edge, site);
+	int next = diagram.nextEdge(site, edge);
+	int third = diagram.otherSite(next, site);
+	neighbors.push_back(site);
+	neighbors.push_back(other);
+	if (!isOpen(site, edge))
+	    neighbors.push_back(third);
+
+	/* the sides counterclockwise from site, open ones with no edge */
+	int side[3][3] = {
+	    { edge, site, other },
+	    { VoronoiDiagram::NONE, other, VoronoiDiagram::NONE },
+	    { VoronoiDiagram::NONE, third, site } };
+	if (!isOpen(site, edge)) {
+	    side[1][0] = diagram.prevEdge(other, edge);
+	    side[1][2] = third;
+	    side[2][0] = next;
+	}
+
+	for (int k=0; k<3; k++) {
+	    /* the corner beyond, or the open one next to an open side */
+	    int beyond = side[k][2], beyondEdge = side[k][0];
+	    if (side[k][0] == VoronoiDiagram::NONE) {
+		beyond = side[k][1];
+		beyondEdge = (k == 1) ? diagram.prevEdge(other, edge) : next;
+	    }
+	    visit(beyond, beyondEdge, newSite);
+	    if (side[k][0] == VoronoiDiagram::NONE)
+		continue;
+	    if (isMarked(conflict, beyond, beyondEdge))
+		inner.push_back(side[k][0]);
+	    else
+		sides.push_back(makeSide(side[k][0], side[k][1], side[k][2]));
+	}
+    }
+
+    sort(neighbors.begin(), neighbors.end());
+    neighbors.erase(unique(neighbors.begin(), neighbors.end()),
+	    neighbors.end());
+} // }}}
+
+VoronoiEditor::Side VoronoiEditor::makeSide(int edge, int one, int two) const
+{ // {{{
+    /*
+     * The end inside the cavity is the one furthest to the left of the
+     * side, so the far end is the other one; an edge with one vertex has
+     * it at the only finite end.
+     */
+    Side side;
+    side.edge = edge;
+    side.one = one;
+    side.two = two;
+    side.open = isOpen(two, edge) ||
+	diagram.getLineType(edge) == VoronoiDiagram::TWO_INF;
+    double dx = -((double)diagram.getY(two) - diagram.getY(one));
+    double dy = (double)diagram.getX(two) - diagram.getX(one);
+    VoronoiCoord start = diagram.getStartPoint(edge);
+    VoronoiCoord end = diagram.getEndPoint(edge);
+    VoronoiCoord far = (start.first * dx + start.second * dy <=
+	    end.first * dx + end.second * dy) ? start : end;
+    if (diagram.getLineType(edge) == VoronoiDiagram::ONE_INF)
+	far = diagram.isStartPointINF(edge) ? end : start;
+    side.farX = far.first;
+    side.farY = far.second;
+    return side;
+} // }}}
+
+void VoronoiEditor::cutSide(const Side &side, const VoronoiCoord &vertex)
+{ // {{{
+    /* the end inside the cavity moves to the vertex */
+    if (side.open) {
+	double dx = -((double)diagram.getY(side.two) - diagram.getY(side.one));
+	double dy = (double)diagram.getX(side.two) - diagram.getX(side.one);
+	diagram.setRay(side.edge, vertex.first, vertex.second, -dx, -dy);
+    } else {
+	diagram.setSegment(side.edge, side.farX, side.farY,
+		vertex.first, vertex.second);
+    }
+    touched.push_back(side.edge);
+} // }}}
+
+void VoronoiEditor::openSide(const Side &side)
+{ // {{{
+    /* the end inside the cavity goes off to infinity */
+    if (side.open) {
+	diagram.disable(side.edge);
+	touched.push_back(side.edge);
+	linkNew(side.one, side.two);
+    } else {
+	double dx = -((double)diagram.getY(side.two) - diagram.getY(side.one));
+	double dy = (double)diagram.getX(side.two) - diagram.getX(side.one);
+	diagram.setRay(side.edge, side.farX, side.farY, dx, dy);
+	touched.push_back(side.edge);
+    }
+} // }}}
+
+int VoronoiEditor::linkNew(int one, int two)
+{ // {{{
+    /* a whole line until it is cut */
+    int edge = diagram.addEdge(one, two);
+    diagram.linkEdge(edge, one, diagram.findSlot(one, two));
+    diagram.linkEdge(edge, two, diagram.findSlot(two, one));
+    touched.push_back(edge);
+    return edge;
+} // }}}
+
+void VoronoiEditor::fanOut(int newSite)
+{ // {{{
+    /* one edge to every site around the cavity, counterclockwise */
+    sort(neighbors.begin(), neighbors.end(), AroundLess(diagram, newSite));
+
+    int count = (int)neighbors.size();
+    int last = VoronoiDiagram::NONE;
+    for (int i=0; i<count; i++) {
+	int prev = neighbors[(i + count - 1) % count];
+	int site = neighbors[i];
+	int next = neighbors[(i + 1) % count];
+	bool hasStart = count > 1 && diagram.orient(newSite, prev, site) > 0;
+	bool hasEnd = count > 1 && diagram.orient(newSite, site, next) > 0;
+
+	/* it runs counterclockwise around the new site */
+	double dx = -((double)diagram.getY(site) - diagram.getY(newSite));
+	double dy = (double)diagram.getX(site) - diagram.getX(newSite);
+	int edge = diagram.addEdge(site, newSite);
+	if (hasStart && hasEnd) {
+	    VoronoiCoord start = diagram.circumcenter(newSite, prev, site);
+	    VoronoiCoord end = diagram.circumcenter(newSite, site, next);
+	    diagram.setSegment(edge, start.first, start.second,
+		    end.first, end.second);
+	} else if (hasStart) {
+	    VoronoiCoord start = diagram.circumcenter(newSite, prev, site);
+	    diagram.setRay(edge, start.first, start.second, dx, dy);
+	} else if (hasEnd) {
+	    VoronoiCoord end = diagram.circumcenter(newSite, site, next);
+	    diagram.setRay(edge, end.first, end.second, -dx, -dy);
+	}
+
+	diagram.linkEdge(edge, newSite, last);
+	diagram.linkEdge(edge, site, diagram.findSlot(site, newSite));
+	last = edge;
+	touched.push_back(edge);
+    }
+} // }}}
+
+void VoronoiEditor::removeSite(int site)
+{ // {{{
+    touched.clear();
+    if (diagram.firstEdge(site) != VoronoiDiagram::NONE)
+	fillHole(site);
+
+    int last = diagram.siteCount() - 1;
+    diagram.removeSite(site);
+    if (hint == last)
+	hint = site;
+} // }}}
+
+void VoronoiEditor::fillHole(int site)
+{ // {{{
+    /*
+     * The neighbors around the site, counterclockwise from an open corner
+     * if there is one, and the sides between them.
+     */
+    int first = diagram.firstEdge(site), edge = first, opens = 0;
+    do {
+	if (isOpen(site, edge)) {
+	    first = diagram.nextEdge(site, edge);
+	    opens++;
+	}
+	edge = diagram.nextEdge(site, edge);
+    } while (edge != diagram.firstEdge(site));
+
+    neighbors.clear();
+    sides.clear();
+    edge = first;
+    do {
+	int other = diagram.otherSite(edge, site);
+	neighbors.push_back(other);
+	if (!isOpen(site, edge)) {
+	    int next = diagram.otherSite(diagram.nextEdge(site, edge), site);
+	    sides.push_back(makeSide(diagram.prevEdge(other, edge),
+			other, next));
+	}
+	edge = diagram.nextEdge(site, edge);
+    } while (edge != first);
+
+    while ((edge = diagram.firstEdge(site)) != VoronoiDiagram::NONE) {
+	diagram.disable(edge);
+	touched.push_back(edge);
+    }
+
+    /* collinear with the site in between, the two become neighbors */
+    int count = (int)neighbors.size();
+    if (opens > 1) {
+	if (count == 2)
+	    linkNew(neighbors[0], neighbors[1]);
+	return;
+    }
+
+    /*
+     * Cut off ears of the hole while there are, first the one whose
+     * circle gives the site the greatest power (Devillers): that one is a
+     * Delaunay triangle of what is left.  The side after
+     * neighbor i is sides[i]; an open hole has no side after the last.
+     */
+    vector<int> prev(count), next(count);
+    for (int i=0; i<count; i++) {
+	prev[i] = (i + count - 1) % count;
+	next[i] = (i + 1) % count;
+    }
+    double sx = diagram.getX(site), sy = diagram.getY(site);
+    bool closed = (opens == 0);
+    int left = count, head = 0;
+    for (;;) {
+	int best = VoronoiDiagram::NONE;
+	double bestPower = 0;
+	VoronoiCoord bestCenter;
+	for (int j=head, i=0; i<left; i++, j=next[j]) {
+	    if (!closed && (j == 0 || j == count - 1))
+		continue;
+	    int a = neighbors[prev[j]], b = neighbors[j], c = neighbors[next[j]];
+	    if (diagram.orient(a, b, c) <= 0)
+		continue;
+	    VoronoiCoord center = diagram.circumcenter(a, b, c);
+	    double rx = center.first - diagram.getX(b);
+	    double ry = center.second - diagram.getY(b);
+	    double dx = center.first - sx, dy = center.second - sy;
+	    double power = dx * dx + dy * dy - rx * rx - ry * ry;
+	    if (best == VoronoiDiagram::NONE || power > bestPower) {
+		best = j;
+		bestPower = power;
+		bestCenter = center;
+	    }
+	}
+	if (best == VoronoiDiagram::NONE)
+	    break;
+
+	/* the last three close the hole by themselves */
+	int before = prev[best], after = next[best];
+	cutSide(sides[before], bestCenter);
+	cutSide(sides[best], bestCenter);
+	if (closed && left == 3) {
+	    cutSide(sides[after], bestCenter);
+	    return;
+	}
+	Side cut;
+	cut.edge = linkNew(neighbors[before], neighbors[after]);
+	cut.one = neighbors[before];
+	cut.two = neighbors[after];
+	cut.open = false;
+	cut.farX = bestCenter.first;
+	cut.farY = bestCenter.second;
+	sides[before] = cut;
+	next[before] = after;
+	prev[after] = before;
+	if (head == best)
+	    head = after;
+	left--;
+    }
+
+    /* what is left of an open hole is hull */
+    for (int j=0; !closed && j!=count-1; j=next[j])
+	openSide(sides[j]);
+} // }}}
@@ -0,0 +1,80 @@
+#ifndef EDITOR_H
+#define EDITOR_H
+
+#include <vector>
+
+#include "diagram.h"
+
+/*
+ * Changes a finished VoronoiDiagram site by site, touching only the cells
+ * around the change instead of running VoronoiAlgo again.
+ *
+ * The diagram is read through the rings of its sites.  A corner of a
+ * ring, between one edge and the next counterclockwise, is a Voronoi
+ * vertex; read as a Delaunay triangle it is the site and the two
+ * neighbors.  Where the turn between the neighbors is half a circle or
+ * more the corner is open, and it stands for the outside of the hull
+ * edge from the first neighbor to the site.
+ *
+ * Sites are appended, and a removed site leaves its id to the last one,
+ * so the diagram is no longer sorted afterwards; sortSites() has to come
+ * before the next full run.
+ */
+class VoronoiEditor
+{
+    public:
+	VoronoiEditor(VoronoiDiagram &diagram);
+	/* the new site, or NONE if there is one at (x, y) already */
+	int insertSite(int x, int y);
+	/* takes the site out; the last site gets its id */
+	void removeSite(int site);
+	/* false, and the site stays, if another one is at (x, y) */
+	bool moveSite(int site, int x, int y);
+	/* the site nearest to (x, y), NONE for an empty diagram */
+	int nearestSite(int x, int y);
+	/* edges added, cut or disabled by the last change */
+	const std::vector<int> & getTouched() const { return touched; };
+
+    private:
+	/*
+	 * A side of the cavity, which lies on the left from one to two.
+	 * Beyond it the edge keeps its far end, unless the corner there is
+	 * open.
+	 */
+	struct Side {
+	    int edge;
+	    int one, two;
+	    bool open;
+	    double farX, farY;
+	};
+
+	int corner(int site, int edge) const
+	{ return 2 * edge + (diagram.getLeftPoint(edge) == site ? 0 : 1); };
+	int locate(int x, int y, int skip);
+	void placeSite(int site, int nearest);
+	bool isOpen(int site, int edge) const;
+	bool isConflict(int site, int edge, int newSite) const;
+	void visit(int site, int edge, int newSite);
+	bool isMarked(const std::vector<int> &marks, int site, int edge) const
+	{ return marks[corner(site, edge)] == stamp; };
+	Side makeSide(int edge, int one, int two) const;
+	void findCavity(int newSite, int nearest);
+	void cutSide(const Side &side, const VoronoiCoord &vertex);
+	void openSide(const Side &side);
+	void fanOut(int newSite);
+	void fillHole(int site);
+	int linkNew(int one, int two);
+	double distance(int site, int x, int y) const;
+
+	VoronoiDiagram &diagram;
+	int hint;		/* where the next search starts */
+	int stamp;		/* of the last change, for the marks */
+	std::vector<int> visited, conflict;	/* by corner */
+	std::vector<int> cavity;	/* corners in conflict, by site, edge */
+	std::vector<int> neighbors;	/* around the cavity */
+	std::vector<int> inner;		/* edges inside it */
+	std::vector<Side> sides;
+	std::vector<int> touched;
+};
+
+#endif
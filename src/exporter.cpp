@@ -0,0 +1,354 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "diagram.h"
+#include "exporter.h"
+
+using namespace std;
+
+/* Keeps the part of polygon where nx*x + ny*y <= k, into kept */
+static void clipPolygon(const vector<VoronoiCoord> &polygon,
+	double nx, double ny, double k, vector<VoronoiCoord> &kept)
+{ // {{{
+    kept.clear();
+    int count = (int)polygon.size();
+    for (int i=0; i<count; i++) {
+	const VoronoiCoord &a = polygon[i];
+	const VoronoiCoord &b = polygon[(i + 1) % count];
+	double da = nx * a.first + ny * a.second - k;
+	double db = nx * b.first + ny * b.second - k;
+	if (da <= 0)
+	    kept.push_back(a);
+	if ((da < 0 && db > 0) || (da > 0 && db < 0)) {
+	    double t = da / (da - db);
+	    VoronoiCoord point(a.first + t * (b.first - a.first),
+		    a.second + t * (b.second - a.second));
+	    /* exactly on the sides of the box */
+	    if (ny == 0)
+		point.first = k / nx;
+	    else if (nx == 0)
+		point.second = k / ny;
+	    kept.push_back(point);
+	}
+    }
+} // }}}
+
+VoronoiExporter::VoronoiExporter(const VoronoiDiagram &diagram)
+    : diagram(diagram), box(diagram.getBox()), content(SITES | EDGES),
+    precision(10)
+{ // {{{
+} // }}}
+
+bool VoronoiExporter::formatOf(const char *name, Format &format)
+{ // {{{
+    if (strcmp(name, "svg") == 0)
+	format = SVG;
+    else if (strcmp(name, "geojson") == 0)
+	format = GEOJSON;
+    else
+	return false;
+    return true;
+} // }}}
+
+bool VoronoiExporter::inBox(double x, double y) const
+{ // {{{
+    return x >= box.getMinX() && x <= box.getMaxX() &&
+	y >= box.getMinY() && y <= box.getMaxY();
+} // }}}
+
+/*
+ * The part of an edge inside the box, false if there is none.  An end at
+ * infinity lies on the box of the diagram, so the edge goes on past it.
+ */
+bool VoronoiExporter::clipEdge(int edge, double &x0, double &y0,
+	double &x1, double &y1) const
+{ // {{{
+    VoronoiCoord start = diagram.getStartPoint(edge);
+    VoronoiCoord end = diagram.getEndPoint(edge);
+    double dx = end.first - start.first, dy = end.second - start.second;
+    if (dx == 0 && dy == 0) {
+	x0 = x1 = start.first;
+	y0 = y1 = start.second;
+	return inBox(x0, y0);
+    }
+
+    /* Liang-Barsky, along start + t * (dx, dy) */
+    double t0 = diagram.isStartPointINF(edge) ? -HUGE_VAL : 0;
+    double t1 = diagram.isEndPointINF(edge) ? HUGE_VAL : 1;
+    double p[4] = { -dx, dx, -dy, dy };
+    double q[4] = { start.first - box.getMinX(), box.getMaxX() - start.first,
+	start.second - box.getMinY(), box.getMaxY() - start.second };
+    double side[4] = { box.getMinX(), box.getMaxX(),
+	box.getMinY(), box.getMaxY() };
+    int side0 = -1, side1 = -1;		/* the sides the ends were cut at */
+    for (int k=0; k<4; k++) {
+	if (p[k] == 0) {
+	    if (q[k] < 0)
+		return false;
+	} else if (p[k] < 0) {
+	    if (q[k] / p[k] > t0) {
+		t0 = q[k] / p[k];
+		side0 = k;
+	    }
+	} else if (q[k] / p[k] < t1) {
+	    t1 = q[k] / p[k];
+	    side1 = k;
+	}
+    }
+    if (t0 > t1)
+	return false;
+    x0 = start.first + t0 * dx;		y0 = start.second + t0 * dy;
+    x1 = start.first + t1 * dx;		y1 = start.second + t1 * dy;
+    if (side0 >= 0)
+	(side0 < 2 ? x0 : y0) = side[side0];
+    if (side1 >= 0)
+	(side1 < 2 ? x1 : y1) = side[side1];
+    return true;
+} // }}}
+
+/*
+ * The cell of site inside the box, counterclockwise; empty if the box
+ * misses it.  A closed cell is read off the ring of the site, whose
+ * edges follow each other around it, and cut by the four sides of the
+ * box.  An open one is the box cut by the bisector of every neighbor.
+ */
+void VoronoiExporter::cellOf(int site, Polygon &cell, Polygon &scratch) const
+{ // {{{
+    double sx = diagram.getX(site), sy = diagram.getY(site);
+    int first = diagram.firstEdge(site);
+    bool open = (first == VoronoiDiagram::NONE);
+    int edge = first;
+    cell.clear();
+    while (!open) {
+	if (diagram.getLineType(edge) != VoronoiDiagram::NO_INF) {
+	    open = true;
+	    break;
+	}
+	/* the end where the boundary comes in */
+	VoronoiCoord a = diagram.getStartPoint(edge);
+	VoronoiCoord b = diagram.getEndPoint(edge);
+	double cross = (a.first - sx) * (b.second - sy) -
+	    (a.second - sy) * (b.first - sx);
+	cell.push_back(cross >= 0 ? a : b);
+	edge = diagram.nextEdge(site, edge);
+	if (edge == first)
+	    break;
+    }
+
+    if (open) {
+	cell.clear();
+	cell.push_back(make_pair(box.getMinX(), box.getMinY()));
+	cell.push_back(make_pair(box.getMaxX(), box.getMinY()));
+	cell.push_back(make_pair(box.getMaxX(), box.getMaxY()));
+	cell.push_back(make_pair(box.getMinX(), box.getMaxY()));
+	edge = first;
+	while (edge != VoronoiDiagram::NONE && !cell.empty()) {
+	    int other = diagram.otherSite(edge, site);
+	    double nx = diagram.getX(other) - sx;
+	    double ny = diagram.getY(other) - sy;
+	    double middleX = (sx + diagram.getX(other)) / 2;
+	    double middleY = (sy + diagram.getY(other)) / 2;
+	    clipPolygon(cell, nx, ny, nx * middleX + ny * middleY, scratch);
+	    cell.swap(scratch);
+	    edge = diagram.nextEdge(site, edge);
+	    if (edge == first)
+		break;
+	}
+	return;
+    }
+
+    clipPolygon(cell, -1, 0, -box.getMinX(), scratch);
+    clipPolygon(scratch, 1, 0, box.getMaxX(), cell);
+    clipPolygon(cell, 0, -1, -box.getMinY(), scratch);
+    clipPolygon(scratch, 0, 1, box.getMaxY(), cell);
+} // }}}
+
+/*
+ * In fixed point with precision digits before the fractional zeros are
+ * cut, as "%.*g" would print most coordinates but several times faster;
+ * printf() would take most of the time of an export.
+ */
+void VoronoiExporter::writeNumber(FILE *out, double value) const
+{ // {{{
+    double magnitude = fabs(value);
+    int digits = 1;
+    for (double power=10; power<=magnitude && digits<=15; power*=10)
+	digits++;
+    int decimals = min(max(precision - digits, 0), 17);
+    double scaled = magnitude * pow(10.0, decimals);
+    if (!(scaled < 9e18)) {
+	fprintf(out, "%.*g", precision, value);
+	return;
+    }
+
+    uint64_t fixed = (uint64_t)llround(scaled);
+    while (decimals > 0 && fixed % 10 == 0) {
+	fixed /= 10;
+	decimals--;
+    }
+    char text[32];
+    char *end = text + sizeof(text), *first = end;
+    for (int i=0; i<decimals; i++) {
+	*--first = (char)('0' + fixed % 10);
+	fixed /= 10;
+    }
+    if (decimals > 0)
+	*--first = '.';
+    do {
+	*--first = (char)('0' + fixed % 10);
+	fixed /= 10;
+    } while (fixed > 0);
+    /* no "-0" */
+    if (value < 0 && (end - first > 1 || *first != '0'))
+	*--first = '-';
+    fwrite(first, 1, end - first, out);
+} // }}}
+
+bool VoronoiExporter::write(FILE *out, Format format)
+{ // {{{
+    if (format == SVG)
+	writeSvg(out);
+    else
+	writeGeoJson(out);
+    return ferror(out) == 0;
+} // }}}
+
+void VoronoiExporter::writeSvg(FILE *out)
+{ // {{{
+    double width = box.getMaxX() - box.getMinX();
+    double height = box.getMaxY() - box.getMinY();
+    double line = max(width, height) / 1000;
+
+    fprintf(out, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	    "<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"");
+    writeNumber(out, box.getMinX());	fputc(' ', out);
+    writeNumber(out, box.getMinY());	fputc(' ', out);
+    writeNumber(out, width);		fputc(' ', out);
+    writeNumber(out, height);
+    fprintf(out, "\">\n");
+
+    if (content & CELLS) {
+	fprintf(out, "<g id=\"cells\" fill=\"#dde6ee\" stroke=\"#ffffff\" "
+		"stroke-width=\"");
+	writeNumber(out, line);
+	fprintf(out, "\">\n");
+	Polygon cell, scratch;
+	for (int site=0; site<diagram.siteCount(); site++) {
+	    cellOf(site, cell, scratch);
+	    if (cell.size() < 3)
+		continue;
+	    fprintf(out, "<polygon points=\"");
+	    for (unsigned int i=0; i<cell.size(); i++) {
+		if (i > 0)
+		    fputc(' ', out);
+		writeNumber(out, cell[i].first);
+		fputc(',', out);
+		writeNumber(out, cell[i].second);
+	    }
+	    fprintf(out, "\"/>\n");
+	}
+	fprintf(out, "</g>\n");
+    }
+
+    if (content & EDGES) {
+	fprintf(out, "<g id=\"edges\" stroke=\"#000000\" stroke-width=\"");
+	writeNumber(out, line);
+	fprintf(out, "\">\n");
+	for (int edge=0; edge<diagram.edgeCount(); edge++) {
+	    double x0, y0, x1, y1;
+	    if (!diagram.isEnabled(edge) || !clipEdge(edge, x0, y0, x1, y1))
+		continue;
+	    fprintf(out, "<line x1=\"");	writeNumber(out, x0);
+	    fprintf(out, "\" y1=\"");		writeNumber(out, y0);
+	    fprintf(out, "\" x2=\"");		writeNumber(out, x1);
+	    fprintf(out, "\" y2=\"");		writeNumber(out, y1);
+	    fprintf(out, "\"/>\n");
+	}
+	fprintf(out, "</g>\n");
+    }
+
+    if (content & SITES) {
+	fprintf(out, "<g id=\"sites\" fill=\"#000000\">\n");
+	for (int site=0; site<diagram.siteCount(); site++) {
+	    double x = diagram.getX(site), y = diagram.getY(site);
+	    if (!inBox(x, y))
+		continue;
+	    fprintf(out, "<circle cx=\"");	writeNumber(out, x);
+	    fprintf(out, "\" cy=\"");		writeNumber(out, y);
+	    fprintf(out, "\" r=\"");		writeNumber(out, 2 * line);
+	    fprintf(out, "\"/>\n");
+	}
+	fprintf(out, "</g>\n");
+    }
+    fprintf(out, "</svg>\n");
+} // }}}
+
+void VoronoiExporter::writeGeoJson(FILE *out)
+{ // {{{
+    const char *separator = "\n";
+    fprintf(out, "{\"type\":\"FeatureCollection\",\"features\":[");
+
+    if (content & SITES) {
+	for (int site=0; site<diagram.siteCount(); site++) {
+	    double x = diagram.getX(site), y = diagram.getY(site);
+	    if (!inBox(x, y))
+		continue;
+	    fprintf(out, "%s{\"type\":\"Feature\",\"properties\":"
+		    "{\"kind\":\"site\",\"site\":%d},\"geometry\":"
+		    "{\"type\":\"Point\",\"coordinates\":[", separator, site);
+	    writeNumber(out, x);
+	    fputc(',', out);
+	    writeNumber(out, y);
+	    fprintf(out, "]}}");
+	    separator = ",\n";
+	}
+    }
+
+    if (content & EDGES) {
+	for (int edge=0; edge<diagram.edgeCount(); edge++) {
+	    double x0, y0, x1, y1;
+	    if (!diagram.isEnabled(edge) || !clipEdge(edge, x0, y0, x1, y1))
+		continue;
+	    fprintf(out, "%s{\"type\":\"Feature\",\"properties\":"
+		    "{\"kind\":\"edge\",\"left\":%d,\"right\":%d},"
+		    "\"geometry\":{\"type\":\"LineString\",\"coordinates\":"
+		    "[[", separator, diagram.getLeftPoint(edge),
+		    diagram.getRightPoint(edge));
+	    writeNumber(out, x0);	fputc(',', out);
+	    writeNumber(out, y0);	fprintf(out, "],[");
+	    writeNumber(out, x1);	fputc(',', out);
+	    writeNumber(out, y1);
+	    fprintf(out, "]]}}");
+	    separator = ",\n";
+	}
+    }
+
+    if (content & CELLS) {
+	Polygon cell, scratch;
+	for (int site=0; site<diagram.siteCount(); site++) {
+	    cellOf(site, cell, scratch);
+	    if (cell.size() < 3)
+		continue;
+	    fprintf(out, "%s{\"type\":\"Feature\",\"properties\":"
+		    "{\"kind\":\"cell\",\"site\":%d},\"geometry\":"
+		    "{\"type\":\"Polygon\",\"coordinates\":[[", separator,
+		    site);
+	    /* the ring closes on its first point */
+	    for (unsigned int i=0; i<=cell.size(); i++) {
+		const VoronoiCoord &point = cell[i % cell.size()];
+		fprintf(out, (i > 0) ? ",[" : "[");
+		writeNumber(out, point.first);
+		fputc(',', out);
+		writeNumber(out, point.second);
+		fputc(']', out);
+	    }
+	    fprintf(out, "]]}}");
+	    separator = ",\n";
+	}
+    }
+    fprintf(out, "\n]}\n");
+} // }}}
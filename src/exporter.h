@@ -0,0 +1,58 @@
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include <stdio.h>
+
+#include <vector>
+
+#include "diagram.h"
+
+/*
+ * Writes a finished diagram as SVG or GeoJSON, straight from the
+ * VoronoiDiagram and front to back, so that it takes no memory beyond
+ * one cell whatever the size of the diagram.
+ *
+ * Everything is clipped to the box given with setBox(), the box of the
+ * diagram unless set: edges and rays are cut where they leave it, cells
+ * are the part of their site's region inside it, and what lies outside
+ * is left out.  Cells run counterclockwise (x to the right, y up); SVG
+ * has y down, as the canvas does.
+ *
+ * In GeoJSON every site, edge and cell is a feature whose "kind"
+ * property tells which, with the ids of its sites.
+ */
+class VoronoiExporter
+{
+    public:
+	enum Format { SVG, GEOJSON };
+	enum { SITES = 1, EDGES = 2, CELLS = 4 };
+
+	VoronoiExporter(const VoronoiDiagram &diagram);
+	void setBox(const VoronoiBox &newBox) { box = newBox; };
+	/* SITES, EDGES and CELLS or'ed together */
+	void setContent(int what) { content = what; };
+	/* significant digits of the coordinates */
+	void setPrecision(int digits) { precision = digits; };
+	/* false if writing failed (see errno) */
+	bool write(FILE *out, Format format);
+	/* "svg" or "geojson" */
+	static bool formatOf(const char *name, Format &format);
+
+    private:
+	typedef std::vector<VoronoiCoord> Polygon;
+
+	bool inBox(double x, double y) const;
+	bool clipEdge(int edge, double &x0, double &y0,
+		double &x1, double &y1) const;
+	void cellOf(int site, Polygon &cell, Polygon &scratch) const;
+	void writeNumber(FILE *out, double value) const;
+	void writeSvg(FILE *out);
+	void writeGeoJson(FILE *out);
+
+	const VoronoiDiagram &diagram;
+	VoronoiBox box;
+	int content;
+	int precision;
+};
+
+#endif
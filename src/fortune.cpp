@@ -0,0 +1,444 @@
+#include <math.h>
+
+#include <algorithm>
+
+#include "diagram.h"
+#include "fortune.h"
+
+using namespace std;
+
+/* Orders the event ids of the heap, the earliest event on top */
+class FortuneAlgo::EventLater
+{
+    public:
+	EventLater(const FortuneAlgo &algo) : algo(algo) {};
+	bool operator() (int lhs, int rhs) const
+	{
+	    if (algo.eventX[lhs] != algo.eventX[rhs])
+		return algo.eventX[lhs] > algo.eventX[rhs];
+	    return algo.eventY[lhs] > algo.eventY[rhs];
+	};
+
+    private:
+	const FortuneAlgo &algo;
+};
+
+/* Orders the ends of the edges by site, then counterclockwise */
+class HalfLess
+{
+    public:
+	HalfLess(const VoronoiDiagram &diagram) : diagram(diagram) {};
+	bool operator() (int lhs, int rhs) const
+	{
+	    int site = siteOf(lhs), other = siteOf(rhs);
+	    if (site != other)
+		return site < other;
+	    double ax = dx(lhs), ay = dy(lhs), bx = dx(rhs), by = dy(rhs);
+	    bool upperA = (ay > 0 || (ay == 0 && ax > 0));
+	    bool upperB = (by > 0 || (by == 0 && bx > 0));
+	    if (upperA != upperB)
+		return upperA;
+	    /* the cross product of 33-bit differences needs the exact sign */
+	    return diagram.orient(site, otherOf(lhs), otherOf(rhs)) > 0;
+	};
+
+    private:
+	/* half 2*edge is the left site of edge, 2*edge+1 the right one */
+	int siteOf(int half) const
+	{ return (half % 2 == 0) ? diagram.getLeftPoint(half / 2) :
+	    diagram.getRightPoint(half / 2); };
+	int otherOf(int half) const
+	{ return (half % 2 == 0) ? diagram.getRightPoint(half / 2) :
+	    diagram.getLeftPoint(half / 2); };
+	double dx(int half) const
+	{ return (double)diagram.getX(otherOf(half)) -
+	    diagram.getX(siteOf(half)); };
+	double dy(int half) const
+	{ return (double)diagram.getY(otherOf(half)) -
+	    diagram.getY(siteOf(half)); };
+
+	const VoronoiDiagram &diagram;
+};
+
+FortuneAlgo::FortuneAlgo(VoronoiDiagram &diagram)
+    : diagram(diagram), sweep(0), seed(2463534242U),
+    root(VoronoiDiagram::NONE),
+    arcSite(&diagram.getArena()), arcPriority(&diagram.getArena()),
+    arcParent(&diagram.getArena()), arcLower(&diagram.getArena()),
+    arcUpper(&diagram.getArena()),
+    arcPrev(&diagram.getArena()), arcNext(&diagram.getArena()),
+    arcEdge(&diagram.getArena()), arcEvent(&diagram.getArena()),
+    heap(&diagram.getArena()), eventArc(&diagram.getArena()),
+    eventX(&diagram.getArena()), eventY(&diagram.getArena()),
+    centerX(&diagram.getArena()), centerY(&diagram.getArena()),
+    vertexX(&diagram.getArena()), vertexY(&diagram.getArena()),
+    vertexFound(&diagram.getArena())
+{ // {{{
+} // }}}
+
+bool FortuneAlgo::start()
+{ // {{{
+    /* every run starts from an empty arena, so these arrays go first */
+    diagram.clearEdges();
+    int count = diagram.siteCount();
+    for (int i=1; i<count; i++) {
+	if (!diagram.siteLess(i-1, i))
+	    return false;	/* not sorted, or duplicated */
+    }
+    diagram.reserveEdges(3 * count);
+
+    IdArray *arrays[] = { &arcSite, &arcPriority, &arcParent, &arcLower,
+	&arcUpper, &arcPrev, &arcNext, &arcEdge, &arcEvent };
+    for (unsigned int j=0; j<sizeof(arrays)/sizeof(arrays[0]); j++)
+	arrays[j]->reserve(2 * count);
+    root = VoronoiDiagram::NONE;
+
+    /* merge the stream of sites with the heap of circle events */
+    for (int site=0; site<count; ) {
+	if (!heap.empty() && isBefore(heap.front(), site)) {
+	    pop_heap(heap.begin(), heap.end(), EventLater(*this));
+	    int event = heap.back();
+	    heap.pop_back();
+	    if (arcEvent[eventArc[event]] == event)
+		circleEvent(event);
+	} else
+	    siteEvent(site++);
+    }
+    while (!heap.empty()) {
+	pop_heap(heap.begin(), heap.end(), EventLater(*this));
+	int event = heap.back();
+	heap.pop_back();
+	if (arcEvent[eventArc[event]] == event)
+	    circleEvent(event);
+    }
+
+    finish();
+    linkRings();
+    return true;
+} // }}}
+
+///////////////////////////////////////////////////////////////////////////////
+// 	Beach line
+// {{{
+
+int FortuneAlgo::newArc(int site)
+{ // {{{
+    /* xorshift, so every run builds the same treap */
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+
+    arcSite.push_back(site);
+    arcPriority.push_back((int)(seed >> 1));
+    arcParent.push_back(VoronoiDiagram::NONE);
+    arcLower.push_back(VoronoiDiagram::NONE);
+    arcUpper.push_back(VoronoiDiagram::NONE);
+    arcPrev.push_back(VoronoiDiagram::NONE);
+    arcNext.push_back(VoronoiDiagram::NONE);
+    arcEdge.push_back(VoronoiDiagram::NONE);
+    arcEvent.push_back(VoronoiDiagram::NONE);
+    return (int)arcSite.size() - 1;
+} // }}}
+
+double FortuneAlgo::breakpoint(int lowerSite, int upperSite) const
+{ // {{{
+    /*
+     * Where the parabola of lowerSite gives way to the one of upperSite,
+     * going up.  Relative to lowerSite the two parabolas meet where
+     *	(du - dl) y^2 + 2 dl h y - dl (h^2 + du w) = 0,
+     * dl and du being the distances of the sites to the sweep line, h the
+     * rise and w the run from lowerSite to upperSite.  Each branch below
+     * is the root taken without cancellation.
+     */
+    double lx = diagram.getX(lowerSite), ly = diagram.getY(lowerSite);
+    double ux = diagram.getX(upperSite), uy = diagram.getY(upperSite);
+    double dl = lx - sweep, du = ux - sweep;
+    double h = uy - ly, w = ux - lx;
+
+    /* a site on the sweep line has only a ray for a parabola yet */
+    if (dl == 0)
+	return (du == 0) ? ly + h / 2 : ly;
+    if (du == 0)
+	return uy;
+    double root = sqrt(dl * du) * sqrt(h * h + w * w);
+    if (h <= 0 && w != 0)
+	return ly - (dl * h + root) / w;
+    return ly - dl * (h * h + du * w) / (root - dl * h);
+} // }}}
+
+int FortuneAlgo::findArc(double y) const
+{ // {{{
+    int arc = root;
+    while (arc != VoronoiDiagram::NONE) {
+	int prev = arcPrev[arc], next = arcNext[arc];
+	if (prev != VoronoiDiagram::NONE &&
+		y < breakpoint(arcSite[prev], arcSite[arc]))
+	    arc = arcLower[arc];
+	else if (next != VoronoiDiagram::NONE &&
+		y > breakpoint(arcSite[arc], arcSite[next]))
+	    arc = arcUpper[arc];
+	else
+	    break;
+    }
+    return arc;
+} // }}}
+
+void FortuneAlgo::insertAbove(int arc, int newArc)
+{ // {{{
+    /* in order, newArc comes right after arc */
+    int parent = arc;
+    if (arcUpper[arc] == VoronoiDiagram::NONE) {
+	arcUpper[arc] = newArc;
+    } else {
+	parent = arcUpper[arc];
+	while (arcLower[parent] != VoronoiDiagram::NONE)
+	    parent = arcLower[parent];
+	arcLower[parent] = newArc;
+    }
+    arcParent[newArc] = parent;
+
+    int next = arcNext[arc];
+    arcPrev[newArc] = arc;	arcNext[newArc] = next;
+    arcNext[arc] = newArc;
+    if (next != VoronoiDiagram::NONE)
+	arcPrev[next] = newArc;
+
+    while (arcParent[newArc] != VoronoiDiagram::NONE &&
+	    arcPriority[newArc] > arcPriority[arcParent[newArc]])
+	rotateUp(newArc);
+} // }}}
+
+void FortuneAlgo::removeArc(int arc)
+{ // {{{
+    /* rotate it down to a leaf, then cut it off */
+    while (arcLower[arc] != VoronoiDiagram::NONE ||
+	    arcUpper[arc] != VoronoiDiagram::NONE) {
+	int lower = arcLower[arc], upper = arcUpper[arc];
+	if (upper == VoronoiDiagram::NONE || (lower != VoronoiDiagram::NONE &&
+		    arcPriority[lower] > arcPriority[upper]))
+	    rotateUp(lower);
+	else
+	    rotateUp(upper);
+    }
+    int parent = arcParent[arc];
+    if (parent == VoronoiDiagram::NONE)
+	root = VoronoiDiagram::NONE;
+    else if (arcLower[parent] == arc)
+	arcLower[parent] = VoronoiDiagram::NONE;
+    else
+	arcUpper[parent] = VoronoiDiagram::NONE;
+
+    int prev = arcPrev[arc], next = arcNext[arc];
+    if (prev != VoronoiDiagram::NONE)
+	arcNext[prev] = next;
+    if (next != VoronoiDiagram::NONE)
+	arcPrev[next] = prev;
+} // }}}
+
+void FortuneAlgo::rotateUp(int arc)
+{ // {{{
+    int parent = arcParent[arc], grand = arcParent[parent];
+    if (arcLower[parent] == arc) {
+	arcLower[parent] = arcUpper[arc];
+	if (arcUpper[arc] != VoronoiDiagram::NONE)
+	    arcParent[arcUpper[arc]] = parent;
+	arcUpper[arc] = parent;
+    } else {
+	arcUpper[parent] = arcLower[arc];
+	if (arcLower[arc] != VoronoiDiagram::NONE)
+	    arcParent[arcLower[arc]] = parent;
+	arcLower[arc] = parent;
+    }
+    arcParent[parent] = arc;
+    arcParent[arc] = grand;
+
+    if (grand == VoronoiDiagram::NONE)
+	root = arc;
+    else if (arcLower[grand] == parent)
+	arcLower[grand] = arc;
+    else
+	arcUpper[grand] = arc;
+} // }}}
+// }}}
+
+///////////////////////////////////////////////////////////////////////////////
+// 	Events
+// {{{
+
+bool FortuneAlgo::isBefore(int event, int site) const
+{ // {{{
+    if (eventX[event] != diagram.getX(site))
+	return eventX[event] < diagram.getX(site);
+    return eventY[event] <= diagram.getY(site);
+} // }}}
+
+void FortuneAlgo::siteEvent(int site)
+{ // {{{
+    sweep = diagram.getX(site);
+    int arc = newArc(site);
+    if (root == VoronoiDiagram::NONE) {
+	root = arc;
+	return;
+    }
+
+    /*
+     * The sites on the first sweep line have no parabolas yet, they only
+     * stack up; the edge between two of them is open to the left.
+     */
+    if (diagram.getX(0) == sweep) {
+	int top = arc - 1;
+	insertAbove(top, arc);
+	arcEdge[top] = addEdge(top, arc);
+	return;
+    }
+
+    /* split the arc above the site in two around the new one */
+    int lower = findArc(diagram.getY(site));
+    dropEvent(lower);
+    int upper = newArc(arcSite[lower]);
+    insertAbove(lower, arc);
+    insertAbove(arc, upper);
+
+    int edge = addEdge(lower, arc);
+    arcEdge[upper] = arcEdge[lower];
+    arcEdge[lower] = edge;
+    arcEdge[arc] = edge;
+
+    checkCircle(lower);
+    checkCircle(upper);
+} // }}}
+
+void FortuneAlgo::circleEvent(int event)
+{ // {{{
+    int arc = eventArc[event];
+    int lower = arcPrev[arc], upper = arcNext[arc];
+    double x = centerX[event], y = centerY[event];
+    sweep = eventX[event];
+
+    /* both breakpoints of the arc end here, a new one starts */
+    setVertex(arcEdge[lower], arcSite[lower], arcSite[arc], true, x, y);
+    setVertex(arcEdge[arc], arcSite[arc], arcSite[upper], true, x, y);
+    arcEvent[arc] = VoronoiDiagram::NONE;
+    removeArc(arc);
+
+    dropEvent(lower);
+    dropEvent(upper);
+    arcEdge[lower] = addEdge(lower, upper);
+    setVertex(arcEdge[lower], arcSite[lower], arcSite[upper], false, x, y);
+
+    checkCircle(lower);
+    checkCircle(upper);
+} // }}}
+
+void FortuneAlgo::checkCircle(int arc)
+{ // {{{
+    int lower = arcPrev[arc], upper = arcNext[arc];
+    if (lower == VoronoiDiagram::NONE || upper == VoronoiDiagram::NONE)
+	return;
+
+    /* the breakpoints around the arc only meet on a clockwise turn */
+    int a = arcSite[lower], b = arcSite[arc], c = arcSite[upper];
+    if (diagram.orient(a, b, c) >= 0)
+	return;
+
+    double bx = diagram.getX(b), by = diagram.getY(b);
+    VoronoiCoord from = diagram.circumcenterFrom(a, c, b);
+    double ux = from.first, uy = from.second;
+
+    int event = (int)eventArc.size();
+    eventArc.push_back(arc);
+    centerX.push_back(bx + ux);
+    centerY.push_back(by + uy);
+    eventX.push_back(bx + ux + sqrt(ux*ux + uy*uy));
+    eventY.push_back(by + uy);
+    arcEvent[arc] = event;
+
+    heap.push_back(event);
+    push_heap(heap.begin(), heap.end(), EventLater(*this));
+} // }}}
+
+void FortuneAlgo::dropEvent(int arc)
+{ // {{{
+    /* the event stays in the heap and is skipped when it comes up */
+    arcEvent[arc] = VoronoiDiagram::NONE;
+} // }}}
+// }}}
+
+///////////////////////////////////////////////////////////////////////////////
+// 	Edges
+// {{{
+
+int FortuneAlgo::addEdge(int lowerArc, int upperArc)
+{ // {{{
+    int lowerSite = arcSite[lowerArc], upperSite = arcSite[upperArc];
+    int edge = diagram.addEdge(min(lowerSite, upperSite),
+	    max(lowerSite, upperSite));
+    for (int i=0; i<2; i++) {
+	vertexX.push_back(0);
+	vertexY.push_back(0);
+	vertexFound.push_back(0);
+    }
+    return edge;
+} // }}}
+
+void FortuneAlgo::setVertex(int edge, int lowerSite, int upperSite,
+	bool ahead, double x, double y)
+{ // {{{
+    /*
+     * End 1 of an edge lies clockwise from the direction of its left to
+     * its right site, which is where a breakpoint with the left site
+     * below runs to.  A breakpoint ends at the vertex ahead of it and
+     * starts at the one behind it.
+     */
+    int end = (lowerSite < upperSite) ? 1 : 0;
+    if (!ahead)
+	end = 1 - end;
+    vertexX[2*edge + end] = x;
+    vertexY[2*edge + end] = y;
+    vertexFound[2*edge + end] = 1;
+} // }}}
+
+void FortuneAlgo::finish()
+{ // {{{
+    for (int edge=0; edge<diagram.edgeCount(); edge++) {
+	int left = diagram.getLeftPoint(edge);
+	int right = diagram.getRightPoint(edge);
+	double dx = (double)diagram.getY(right) - diagram.getY(left);
+	double dy = (double)diagram.getX(left) - diagram.getX(right);
+
+	/* edges found by no vertex are whole lines, as addEdge() made them */
+	if (vertexFound[2*edge] && vertexFound[2*edge+1])
+	    diagram.setSegment(edge, vertexX[2*edge], vertexY[2*edge],
+		    vertexX[2*edge+1], vertexY[2*edge+1]);
+	else if (vertexFound[2*edge])
+	    diagram.setRayUnclipped(edge, vertexX[2*edge], vertexY[2*edge], 
+		    dx, dy);
+	else if (vertexFound[2*edge+1])
+	    diagram.setRayUnclipped(edge, vertexX[2*edge+1], 
+		    vertexY[2*edge+1], -dx, -dy);
+    }
+    diagram.clipEdges();
+} // }}}
+
+void FortuneAlgo::linkRings()
+{ // {{{
+    /* sorting the ends of the edges gives every ring at once */
+    IdArray halves(2 * diagram.edgeCount(), 0, &diagram.getArena());
+    for (unsigned int i=0; i<halves.size(); i++)
+	halves[i] = i;
+    sort(halves.begin(), halves.end(), HalfLess(diagram));
+
+    int site = VoronoiDiagram::NONE, prev = VoronoiDiagram::NONE;
+    for (unsigned int j=0; j<halves.size(); j++) {
+	int edge = halves[j] / 2;
+	int next = (halves[j] % 2 == 0) ? diagram.getLeftPoint(edge) :
+	    diagram.getRightPoint(edge);
+	if (next != site) {
+	    site = next;
+	    prev = VoronoiDiagram::NONE;
+	}
+	diagram.linkEdge(edge, site, prev);
+	prev = edge;
+    }
+} // }}}
+// }}}
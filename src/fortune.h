@@ -0,0 +1,69 @@
+#ifndef FORTUNE_H
+#define FORTUNE_H
+
+#include "diagram.h"
+
+/*
+ * Fortune's sweep over the sorted sites, an alternative to VoronoiAlgo
+ * leaving the same edges in the VoronoiDiagram.
+ *
+ * The sweep line moves to the right (x grows) and the sites come in one
+ * pass in their sorted order.  The beach line is a treap of arcs ordered
+ * by y, whose in-order neighbours are also linked directly; the circle
+ * events wait in a binary heap, and an event is dropped when its arc goes
+ * away first.  All scratch space comes from the arena of the diagram.
+ */
+class FortuneAlgo
+{
+    public:
+	FortuneAlgo(VoronoiDiagram &diagram);
+	bool start();
+
+    private:
+	typedef ArenaVector<double>::type DoubleArray;
+	class EventLater;
+	friend class EventLater;
+
+	/* the beach line */
+	int newArc(int site);
+	int findArc(double y) const;
+	double breakpoint(int lowerSite, int upperSite) const;
+	void insertAbove(int arc, int newArc);
+	void removeArc(int arc);
+	void rotateUp(int arc);
+
+	/* the events */
+	void siteEvent(int site);
+	void circleEvent(int event);
+	void checkCircle(int arc);
+	void dropEvent(int arc);
+	bool isBefore(int event, int site) const;
+
+	/* the edges */
+	int addEdge(int lowerArc, int upperArc);
+	void setVertex(int edge, int lowerSite, int upperSite, bool ahead,
+		double x, double y);
+	void finish();
+	void linkRings();
+
+	VoronoiDiagram &diagram;
+	double sweep;		/* x of the sweep line */
+	unsigned int seed;	/* of the treap priorities */
+
+	int root;
+	IdArray arcSite, arcPriority;
+	IdArray arcParent, arcLower, arcUpper;	/* in the treap */
+	IdArray arcPrev, arcNext;		/* along the beach line */
+	IdArray arcEdge;	/* traced by the breakpoint with arcNext */
+	IdArray arcEvent;	/* the pending circle event, if any */
+
+	IdArray heap;		/* of event ids, the earliest on top */
+	IdArray eventArc;
+	DoubleArray eventX, eventY, centerX, centerY;
+
+	/* the Voronoi vertices at the two ends of each edge, if found */
+	DoubleArray vertexX, vertexY;
+	IdArray vertexFound;
+};
+
+#endif
@@ -1,648 +1,528 @@
-#include <qaction.h>
-#include <qpopupmenu.h>
-#include <qcanvas.h>
-#include <qpainter.h>
-#include <qmessagebox.h>
-#include <qdir.h>
-#include <qpoint.h>
-#include <qpair.h>
-
-#include <algorithm>
-
-#include "geometry.h"
-#include "tooltip.h"
-#include "algorithm.h"
-
-using namespace std;
-
-///////////////////////////////////////////////////////////////////////////////
-// 	DiagramView
-// {{{
-
-DiagramView::DiagramView(QCanvas *canvas, QWidget *parent, const char *name)
-    : QCanvasView(canvas, parent, name)
-{ // {{{
-    viewport()->setMouseTracking(true);
-    dynTip = new DynamicTip(this);
-    createActions();
-} // }}}
-
-bool DiagramView::hasPoint(const int x, const int y)
-{ // {{{
-    return isDuplicate(x, y);
-} // }}}
-
-void DiagramView::createActions()
-{ // {{{
-    newAct = new QAction(tr("&New"), tr("Ctrl+N"), this);
-    newAct->setIconSet(QPixmap::fromMimeSource(
-		QDir::convertSeparators("images/filenew.png")));
-    connect(newAct, SIGNAL(activated()), this, SLOT(newFile()));
-    calAct = new QAction(tr("&Run"), tr("Ctrl+R"), this);
-    calAct->setIconSet(QPixmap::fromMimeSource(
-		QDir::convertSeparators("images/run.png")));
-    connect(calAct, SIGNAL(activated()), this, SLOT(calculate()));
-} // }}}  
-
-void DiagramView::newFile()
-{ // {{{
-    QValueVector<DiagramBisector*>::const_iterator it;
-    for (it = edgeList.begin(); it!=edgeList.end(); it++)
-	delete (*it);
-    edgeList.clear();
-
-    QValueVector<DiagramPoint*>::const_iterator it2;
-    for (it2 = pointList.begin(); it2!=pointList.end(); it2++)
-	delete (*it2);
-    pointList.clear();
-
-
-    canvas()->update();
-    qDebug("-===========New=============-");
-} // }}}
-
-void DiagramView::calculate()
-{ // {{{
-    qDebug("-===========Calculate=============-");
-    /* sort before starting algorithm */
-    stable_sort(pointList.begin(), pointList.end(), PtrLess<DiagramPoint *>());
-
-    /* For New Voronoi Diagram */
-    if (edgeList.size() > 0) {
-	/* Delete bisectors */
-	QValueVector<DiagramBisector*>::const_iterator it;
-	for (it = edgeList.begin(); it!=edgeList.end(); it++)
-	    delete (*it);
-	edgeList.clear();
-	/* Clear bisector associate with DiagramPoint */
-	QValueVector<DiagramPoint*>::const_iterator it2;
-	for (it2 = pointList.begin(); it2!=pointList.end(); it2++)
-	    (*it2)->getEdgeList().clear();
-	canvas()->update();
-    }
-
-    /* start the divide-and-conquer algorithm */
-    VoronoiAlgo algorithm(pointList, edgeList, this);
-    algorithm.start();
-
-    /* draw the canvas */
-    for (QValueVector<DiagramBisector *>::iterator it = edgeList.begin();
-	    it != edgeList.end(); it++) {
-	(*it)->draw();
-	qDebug("bisector of (%d,%d)-(%d,%d) has %d infinity end.", 
-		(*it)->getLeftPoint()->getX(), 
-		(*it)->getLeftPoint()->getY(), 
-		(*it)->getRightPoint()->getX(), 
-		(*it)->getRightPoint()->getY(), 
-		(*it)->getLineType());
-    }
-} // }}}
-
-void DiagramView::contentsContextMenuEvent(QContextMenuEvent *event)
-{ // {{{
-    QPopupMenu contextMenu(this);
-    newAct->addTo(&contextMenu);
-    calAct->addTo(&contextMenu);
-    contextMenu.exec(event->globalPos());
-} // }}}
-
-bool DiagramView::isDuplicate(int x, int y)
-{ // {{{
-    QValueVector<DiagramPoint*>::const_iterator it;
-    for (it = pointList.begin(); it!=pointList.end(); it++) {
-	if ( (*it)->x() == x && (*it)->y() == y) {
-	    return true;
-	}
-    }
-    return false;
-} // }}}
-
-void DiagramView::contentsMousePressEvent(QMouseEvent *event)
-{ // {{{
-    if (event->button() == LeftButton)
-	addPoint(event->pos().x(), event->pos().y());
-} // }}}
-
-void DiagramView::contentsMouseMoveEvent(QMouseEvent *event)
-{ // {{{
-    emit locationChanged(event->pos().x(), event->pos().y());
-} // }}}
-
-void DiagramView::addPoint(int x, int y)
-{ // {{{
-    if (!isDuplicate(x, y) && 
-	    x >= 0 && x <= canvas()->width() && 
-	    y >= 0 && y <= canvas()->height()) {
-	DiagramPoint *newPoint = new DiagramPoint(x, y, 
-		DiagramPoint::DIAMETER, canvas());
-	pointList.push_back(newPoint);
-	qDebug("(%d,%d) is been added.", x, y);
-    }
-} // }}}
-
-DiagramView::~DiagramView()
-{ // {{{
-    delete dynTip;
-    dynTip = 0;
-} // }}}
-// }}}
-
-///////////////////////////////////////////////////////////////////////////////
-// 	DiagramPoint
-// {{{
-
-DiagramPoint::DiagramPoint(int x, int y, int diameter, QCanvas *canvas)
-    : QCanvasEllipse(diameter,diameter,canvas), posX(x), posY(y)
-{ // {{{
-    setBrush(QColor(Qt::black));
-    move(x, y);
-    show();
-    canvas->update();
-} // }}}
-
-void DiagramPoint::addEdge(DiagramBisector *edge)
-{ // {{{
-    edgeList.push_back(edge);
-} // }}}
-
-bool DiagramPoint::operator==(DiagramPoint &rhs) const
-{ // {{{
-    return ( posX == rhs.getX() && posY == rhs.getY());
-} // }}}
-
-bool DiagramPoint::operator<(const DiagramPoint &rhs) const
-{ // {{{
-    if (posX <= rhs.getX()) {
-	if (posX == rhs.getX()) {
-	    if (posY < rhs.getY())
-		return true;
-	    return false;
-	}
-	return true;
-    }
-    return false;
-} // }}}
-
-DiagramPoint::~DiagramPoint()
-{ // {{{
-    hide();
-} // }}}
-// }}}
-
-///////////////////////////////////////////////////////////////////////////////
-// 	DiagramLine
-// {{{
-
-DiagramLine::DiagramLine(DiagramPoint *leftPoint, DiagramPoint *rightPoint, 
-	QCanvas *canvas) : QCanvasLine(canvas), leftPoint(leftPoint),
-			   rightPoint(rightPoint)
-{ // {{{
-    int xa = leftPoint->getX();		int ya = leftPoint->getY();
-    int xb = rightPoint->getX();	int yb = rightPoint->getY();
-
-    setPoints(xa, ya, xb, yb);
-    a = (double)ya-yb;
-    b = (double)xb-xa;
-    c = a * (double)xa + b * (double)ya;
-    middleX = (double)( xa + xb ) / 2;
-    middleY = (double)( ya + yb ) / 2;
-
-} // }}}
-
-void DiagramLine::draw()
-{ // {{{
-    setPen(QPen(QColor(Qt::red), 0, DotLine));
-    show();
-    canvas()->update();
-} // }}}
-
-bool DiagramLine::operator==(DiagramLine &rhs) const
-{ // {{{
-    if ( *(rhs.getLeftPoint()) == *leftPoint
-	    && *(rhs.getRightPoint()) == *rightPoint ) {
-	return true;
-    } else if ( *(rhs.getRightPoint()) == *leftPoint
-	    && *(rhs.getLeftPoint()) == *rightPoint ) {
-	return true;
-    }
-    return false;
-} // }}}
-
-bool DiagramLine::isDiffArea(double xa, double ya, double xb, double yb)
-{ // {{{
-    if ( ((a*xa+b*ya)-c) * ((a*xb+b*yb)-c) <= 0)
-	return true;
-    return false;
-} // }}}
-
-DiagramLine::~DiagramLine()
-{ // {{{
-    hide();
-} // }}}
-// }}}
-
-///////////////////////////////////////////////////////////////////////////////
-// 	DiagramBisector
-// {{{
-
-DiagramBisector::DiagramBisector(DiagramLine line, QCanvas *canvas, 
-	DiagramPoint* refPoint, 
-	double startX, double startY)
-    : QCanvasLine(canvas), line(line),
-    leftPoint(line.getLeftPoint()), rightPoint(line.getRightPoint()), 
-    refPoint(refPoint)
-{ // {{{
-    QPair<double, double> middlePoint(line.getMiddlePoint());
-    a = line.getB();
-    b = line.getA() * (-1);
-    c = a * middlePoint.first + b * middlePoint.second;
-
-    enable = true;
-    HP = false;
-
-    boundStartPointX = -1;	boundStartPointY = -1;
-    boundEndPointX = -1;	boundEndPointY = -1;
-    intersectPointX = -1;	intersectPointY = -1;
-    cutter = NULL;
-
-    /* Add relationship between DiagramBisector and DiagramPoint */
-    leftPoint->addEdge(this);	rightPoint->addEdge(this);
-
-    findBoundIntersect(canvas);
-    if (refPoint == NULL) { /* There is no reference point */
-	if (boundStartPointY <= boundEndPointY) {
-	    startPointX = boundStartPointX;	startPointY = boundStartPointY;
-	    endPointX = boundEndPointX;		endPointY = boundEndPointY;
-	    isStartINF = true; isEndINF = true;
-	} else {
-	    startPointX = boundEndPointX;	startPointY = boundEndPointY;
-	    endPointX = boundStartPointX;	endPointY = boundStartPointY;
-	    isStartINF = true; isEndINF = true;
-	}
-    } else {	/* There is a reference point */
-	startPointX = startX;	startPointY = startY;
-	isStartINF = false;
-	if (boundStartPointY <= boundEndPointY) {
-	    endPointX = boundEndPointX;		endPointY = boundEndPointY;
-	    isEndINF = true;
-	} else {
-	    endPointX = boundStartPointX;	endPointY = boundStartPointY;
-	    isEndINF = true;
-	}
-
-	if (startY > endPointY) {
-	    endPointX = startPointX*2-endPointX;
-	    endPointY = startPointY*2-endPointY;
-	}
-    }
-} // }}}
-
-DiagramPoint* DiagramBisector::getComPoint(DiagramBisector *line)
-{ // {{{
-    if (*leftPoint == *(line->getLeftPoint()) || 
-	    *leftPoint == *(line->getRightPoint()))
-	return leftPoint;
-    if (*rightPoint == *(line->getLeftPoint()) || 
-	    *rightPoint == *(line->getRightPoint()))
-	return rightPoint;
-    return NULL;
-} // }}}
-
-DiagramBisector::LineType DiagramBisector::getLineType() const
-{ // {{{
-    int type = 0;
-    if (isStartINF) 
-	type++;
-    if (isEndINF) 
-	type++;
-
-    return (DiagramBisector::LineType)type;
-} // }}}
-
-void DiagramBisector::findBoundIntersect(QCanvas *canvas)
-{ // {{{
-    double width = (double)canvas->width();
-    double height = (double)canvas->height();
-    
-    if (a == 0 && b != 0) {
-	setBoundPoints(0, (c/b));
-	setBoundPoints(width, (c/b));
-    } else if (b == 0 && a != 0) {
-	setBoundPoints((c/a), 0);
-	setBoundPoints((c/a), height);
-    } else {
-	double tmp1, tmp2, tmp3, tmp4;
-	tmp1 = (c/b); /* intersect with x = 0 */
-	tmp2 = (c/a); /* intersect with y = 0 */
-	tmp3 = (c - a*width)/b; 	/* intersect with x = width */
-	tmp4 = (c - b*height)/a;	/* intersect with y = height */
-
-	if (tmp1 >= 0 && tmp1 <= height)
-	    setBoundPoints(0, tmp1);
-	if (tmp2 >= 0 && tmp2 <= width)
-	    setBoundPoints(tmp2, 0);
-	if (tmp3 >=0 && tmp3 <=height)
-	    setBoundPoints(width, tmp3);
-	if (tmp4 >= 0 && tmp4 <= width)
-	    setBoundPoints(tmp4, height);
-    }
-} // }}}
-
-void DiagramBisector::setBoundPoints(double x, double y)
-{ // {{{
-    if (boundStartPointX == -1) {
-	boundStartPointX = x;	boundStartPointY = y;
-    } else if (boundEndPointX == -1) {
-	boundEndPointX = x;	boundEndPointY = y;
-    }
-} // }}}
-
-void DiagramBisector::draw()
-{ // {{{
-    if (enable) {
-	line.draw(); /* Draw the line consist of two DigramPoint */
-	qDebug("!!Bisector of (%d,%d)-(%d,%d) whose two point (%f,%f) (%f,%f) to draw",
-		leftPoint->getX(), leftPoint->getY(), 
-		rightPoint->getX(), rightPoint->getY(), 
-		startPointX, startPointY, endPointX, endPointY); 
-	setPoints((int)startPointX, (int)startPointY, 
-		(int)endPointX, (int)endPointY);
-	setPen(QColor(Qt::blue));
-	show();
-	canvas()->update();
-    }
-} // }}}
-
-bool DiagramBisector::isOnLine(double x, double y)
-{ // {{{
-    /* TODO: type ``double'' bug */
-    if ((a*x+b*y-c) == 0)
-	return true;
-    return false;
-} // }}}
-
-bool DiagramBisector::isDiffArea(double xa, double ya, double xb, double yb)
-{ // {{{
-    if ( ((a*xa+b*ya)-c) * ((a*xb+b*yb)-c) <= 0)
-	return true;
-    return false;
-} // }}}
-
-bool DiagramBisector::isIntersect(DiagramBisector *line)
-{ // {{{
-    return (!((a*line->getB()) == (line->getA()*b)));
-} // }}}
-
-QPair<double, double> DiagramBisector::calIntersectPoint(DiagramBisector *line)
-{ // {{{
-    double d = (a * line->getB() - line->getA() * b);
-    return qMakePair((c * line->getB() - line->getC() * b) / d, 
-	    (a * line->getC() - line->getA() * c) / d);
-} // }}}
-
-void DiagramBisector::endWithIntersect(double intersectX, double intersectY)
-{ // {{{
-	endPointX = intersectX;
-	endPointY = intersectY;
-	isEndINF = false;
-	if (isStartINF == true && endPointY < startPointY) {
-	    startPointX = endPointX*2-startPointX;
-	    startPointY = endPointY*2-startPointY;
-	}
-} // }}}
-
-void DiagramBisector::addIntersectPoint(double intersectX, double intersectY, 
-	DiagramBisector *cutter)
-{ // {{{
-    intersectPointX = intersectX;
-    intersectPointY = intersectY;
-    this->cutter = cutter;
-} // }}}
-
-void DiagramBisector::cutByIntersect(CutDirection dir)
-{ // TODO: debug {{{
-    if (cutter == NULL)
-	return;
-
-    double a, b, c;
-    a = cutter->getA();
-    b = cutter->getB();
-    c = cutter->getC();
-
-    if ( a < 0) {
-	a *= (-1);	b *= (-1);	c *= (-1);
-    }
-
-    if (getLineType() == NO_INF) {
-	if (dir == CUT_LEFT) {
-	    if (startPointX * a + startPointY * b < c) {
-		startPointX = intersectPointX;
-		startPointY = intersectPointY;
-		isStartINF = false;
-	    } else if (endPointX * a + endPointY * b < c) {
-		endPointX = intersectPointX;
-		endPointY = intersectPointY;
-		isEndINF = false;
-	    }
-	} else if (dir == CUT_RIGHT) {
-	    if (startPointX * a + startPointY * b > c) {
-		startPointX = intersectPointX;
-		startPointY = intersectPointY;
-		isStartINF = false;
-	    } else if (endPointX * a + endPointY * b > c) {
-		endPointX = intersectPointX;
-		endPointY = intersectPointY;
-		isEndINF = false;
-	    }
-	}
-    } else if (getLineType() == ONE_INF) {
-	if (dir == CUT_LEFT) {
-	    if (isStartINF == false) {
-		if (startPointX * a + startPointY * b > c) {
-		    endPointX = intersectPointX;
-		    endPointY = intersectPointY;
-		    isEndINF = false;
-		} else if (startPointX * a + startPointY * b < c) {
-		    startPointX = intersectPointX;
-		    startPointY = intersectPointY;
-		    isStartINF = false;
-		} else {
-		    if (endPointX * a + endPointY * b < c) {
-			endPointX = intersectPointX;
-			endPointY = intersectPointY;
-			isEndINF = false;
-		    }
-		}
-	    } else {
-		if (endPointX * a + endPointY * b > c) {
-		    startPointX = intersectPointX;
-		    startPointY = intersectPointY;
-		    isStartINF = false;
-		} else if (endPointX * a + endPointY * b < c) {
-		    endPointX = intersectPointX;
-		    endPointY = intersectPointY;
-		    isEndINF = false;
-		} else {
-		    if (startPointX * a + startPointY * b < c) {
-			startPointX = intersectPointX;
-			startPointY = intersectPointY;
-			isStartINF = false;
-		    }
-		}
-	    }
-	} else if (dir == CUT_RIGHT) {
-	    if (isStartINF == false) {
-		if (startPointX * a + startPointY * b < c) {
-		    endPointX = intersectPointX;
-		    endPointY = intersectPointY;
-		    isEndINF = false;
-		} else if (startPointX * a + startPointY * b > c) {
-		    startPointX = intersectPointX;
-		    startPointY = intersectPointY;
-		    isStartINF = false;
-		} else {
-		    if (endPointX * a + endPointY * b > c) {
-			endPointX = intersectPointX;
-			endPointY = intersectPointY;
-			isEndINF = false;
-		    }
-		}
-	    } else {
-		if (endPointX * a + endPointY * b < c) {
-		    startPointX = intersectPointX;
-		    startPointY = intersectPointY;
-		    isStartINF = false;
-		} else if (endPointX * a + endPointY * b > c) {
-		    endPointX = intersectPointX;
-		    endPointY = intersectPointY;
-		    isEndINF = false;
-		} else {
-		    if (startPointX * a + startPointY * b > c) {
-			startPointX = intersectPointX;
-			startPointY = intersectPointY;
-			isStartINF = false;
-		    }
-		}
-	    }
-	}
-    } else if (getLineType() == TWO_INF) {
-	if (dir == CUT_LEFT) {
-	    if (startPointX * a + startPointY * b < c && 
-		    endPointX * a + endPointY * b > c) {
-		startPointX = intersectPointX;
-		startPointY = intersectPointY;
-		isStartINF = false;
-	    } else if (startPointX * a + startPointY * b > c && 
-		    endPointX * a + endPointY * b < c) {
-		endPointX = intersectPointX;
-		endPointY = intersectPointY;
-		isEndINF = false;
-	    } else if (startPointX * a + startPointY * b >= c && 
-		    endPointX * a + endPointY * b >= c) {
-		if (distance(startPointX, startPointY, 
-			    intersectPointX, intersectPointY) < 
-			distance(endPointX, endPointY, 
-			    intersectPointX, intersectPointY)) {
-		    startPointX = intersectPointX;
-		    startPointY = intersectPointY;
-		    isStartINF = false;
-		} else {
-		    endPointX = intersectPointX;
-		    endPointY = intersectPointY;
-		    isEndINF = false;
-		}
-	    } else if (startPointX * a + startPointY * b <= c && 
-		    endPointX * a + endPointY * b <= c) {
-		if (distance(startPointX, startPointY, 
-			    intersectPointX, intersectPointY) > 
-			distance(endPointX, endPointY, 
-			    intersectPointX, intersectPointY)) {
-		    startPointX = intersectPointX;
-		    startPointY = intersectPointY;
-		    isStartINF = false;
-		    endPointX = startPointX*2-endPointX;
-		    endPointY = startPointY*2-endPointY;
-		} else {
-		    endPointX = intersectPointX;
-		    endPointY = intersectPointY;
-		    isEndINF = false;
-		    startPointX = endPointX*2-startPointX;
-		    startPointY = endPointY*2-startPointY;
-		}
-	    }
-	} else if (dir == CUT_RIGHT) {
-	    if (startPointX * a + startPointY * b > c && 
-		    endPointX * a + endPointY * b < c) {
-		startPointX = intersectPointX;
-		startPointY = intersectPointY;
-		isStartINF = false;
-	    } else if (startPointX * a + startPointY * b < c && 
-		    endPointX * a + endPointY * b > c) {
-		endPointX = intersectPointX;
-		endPointY = intersectPointY;
-		isEndINF = false;
-	    } else if (startPointX * a + startPointY * b >= c && 
-		    endPointX * a + endPointY * b >= c) {
-		if (distance(startPointX, startPointY, 
-			    intersectPointX, intersectPointY) > 
-			distance(endPointX, endPointY, 
-			    intersectPointX, intersectPointY)) {
-		    startPointX = intersectPointX;
-		    startPointY = intersectPointY;
-		    isStartINF = false;
-		    endPointX = startPointX*2-endPointX;
-		    endPointY = startPointY*2-endPointY;
-		} else {
-		    endPointX = intersectPointX;
-		    endPointY = intersectPointY;
-		    isEndINF = false;
-		    startPointX = endPointX*2-startPointX;
-		    startPointY = endPointY*2-startPointY;
-		}
-	    } else if (startPointX * a + startPointY * b <= c && 
-		    endPointX * a + endPointY * b <= c) {
-		if (distance(startPointX, startPointY, 
-			    intersectPointX, intersectPointY) < 
-			distance(endPointX, endPointY, 
-			    intersectPointX, intersectPointY)) {
-		    startPointX = intersectPointX;
-		    startPointY = intersectPointY;
-		    isStartINF = false;
-		} else {
-		    endPointX = intersectPointX;
-		    endPointY = intersectPointY;
-		    isEndINF = false;
-		}
-	    }
-	}
-    }
-
-    qDebug("!!Bisector of (%d,%d)-(%d,%d) whose two point (%f,%f) (%f,%f) is cut by (%f,%f).", 
-	    leftPoint->getX(), leftPoint->getY(), 
-	    rightPoint->getX(), rightPoint->getY(), 
-	    startPointX, startPointY, endPointX, endPointY, 
-	    intersectPointX, intersectPointY);
-
-    /* reset intersect point */
-    intersectPointX = -1;	intersectPointY = -1;
-    //cutter = NULL;
-} // }}}
-
-bool DiagramBisector::operator==(DiagramBisector &rhs) const
-{ // {{{
-    if ( *(rhs.getLeftPoint()) == *leftPoint
-	    && *(rhs.getRightPoint()) == *rightPoint ) {
-	return true;
-    } else if ( *(rhs.getRightPoint()) == *leftPoint
-	    && *(rhs.getLeftPoint()) == *rightPoint ) {
-	return true;
-    }
-    return false;
-} // }}}
-
-DiagramBisector::~DiagramBisector()
-{ // {{{
-    hide();
-} // }}}
-
-// }}}
+#include <qaction.h>
+#include <qpopupmenu.h>
+#include <qcanvas.h>
+#include <qpainter.h>
+#include <qmessagebox.h>
+#include <qdir.h>
+#include <qpoint.h>
+#include <qpair.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include <vector>
+
+#include "geometry.h"
+#include "tooltip.h"
+#include "algorithm.h"
+#include "fortune.h"
+#include "importer.h"
+#include "exporter.h"
+#include "sorter.h"
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+// 	DiagramView
+// {{{
+
+DiagramView::DiagramView(QCanvas *canvas, QWidget *parent, const char *name)
+    : QCanvasView(canvas, parent, name), menuPoint(-1), dragPoint(-1),
+    pointHash(DiagramPoint::DIAMETER),
+    diagram(VoronoiBox(0, 0, canvas->width(), canvas->height())),
+    editor(diagram),
+    cache((QDir::homeDirPath() + "/.voronoi-cache").latin1()),
+    calculated(false), dcelStale(false),
+    sweep(false)
+{ // {{{
+    viewport()->setMouseTracking(true);
+    dynTip = new DynamicTip(this);
+    createActions();
+} // }}}
+
+void DiagramView::createActions()
+{ // {{{
+    newAct = new QAction(tr("&New"), tr("Ctrl+N"), this);
+    newAct->setIconSet(QPixmap::fromMimeSource(
+		QDir::convertSeparators("images/filenew.png")));
+    connect(newAct, SIGNAL(activated()), this, SLOT(newFile()));
+    calAct = new QAction(tr("&Run"), tr("Ctrl+R"), this);
+    calAct->setIconSet(QPixmap::fromMimeSource(
+		QDir::convertSeparators("images/run.png")));
+    connect(calAct, SIGNAL(activated()), this, SLOT(calculate()));
+    delAct = new QAction(tr("&Delete"), tr("Del"), this);
+    connect(delAct, SIGNAL(activated()), this, SLOT(deletePoint()));
+} // }}}  
+
+void DiagramView::newFile()
+{ // {{{
+    /* the bisectors stay around for the next run */
+    eraseBisectors(0);
+
+    QValueVector<DiagramPoint*>::const_iterator it2;
+    for (it2 = pointList.begin(); it2!=pointList.end(); it2++)
+	delete (*it2);
+    pointList.clear();
+    pointHash.clear();
+    menuPoint = dragPoint = -1;
+    diagram.clear();
+    dcel.clear();
+    calculated = false;
+    dcelStale = false;
+
+    canvas()->update();
+    qDebug("-===========New=============-");
+} // }}}
+
+void DiagramView::calculate()
+{ // {{{
+    qDebug("-===========Calculate=============-");
+    /* sort before starting algorithm; equal points are dropped */
+    unsigned int count = pointList.size();
+    vector<int> pointX(count), pointY(count), order;
+    for (unsigned int i=0; i<count; i++) {
+	pointX[i] = pointList[i]->getX();
+	pointY[i] = pointList[i]->getY();
+    }
+    SiteSorter sorter;
+    if (count > 0)
+	sorter.sort(&pointX[0], &pointY[0], count, order);
+
+    /* the points follow the permutation, so that site ids stay indices */
+    QValueVector<DiagramPoint*> sorted(order.size());
+    vector<bool> kept(count, false);
+    for (unsigned int j=0; j<order.size(); j++) {
+	sorted[j] = pointList[order[j]];
+	kept[order[j]] = true;
+    }
+    for (unsigned int k=0; k<count; k++) {
+	if (!kept[k])
+	    delete pointList[k];
+    }
+    pointList = sorted;
+    indexPoints();
+
+    /* The algorithm works on its own copy of the sites */
+    diagram.clear();
+    diagram.setBox(VoronoiBox(0, 0, canvas()->width(), canvas()->height()));
+    QValueVector<DiagramPoint*>::const_iterator it2;
+    for (it2 = pointList.begin(); it2!=pointList.end(); it2++)
+	diagram.addSite((*it2)->getX(), (*it2)->getY());
+
+    /* the edges of the same sites from the cache, or a run and into it */
+    unsigned int options = VoronoiCache::optionsOf(sweep,
+	    VoronoiAlgo::DEFAULT_CUTOFF);
+    bool cached = cache.load(diagram, options), done = cached;
+    if (!cached && sweep) {
+	FortuneAlgo fortune(diagram);
+	done = fortune.start();
+    } else if (!cached) {
+	VoronoiAlgo algorithm(diagram);
+	done = algorithm.start();
+    }
+    if (!done)
+	qWarning("the Voronoi diagram of %d points can't be calculated.", 
+		pointList.size());
+    else if (!cached && !cache.store(diagram, options))
+	qWarning("the diagram can't be cached: %s", strerror(errno));
+
+    /* the editor only repairs a finished diagram, never a partial one */
+    if (done)
+	dcel.build(diagram);
+    else
+	dcel.clear();
+    calculated = done;
+    dcelStale = false;
+
+    const VoronoiArena &arena = diagram.getArena();
+    QString stats = QString("%1 edges, %2 vertices, %3 bytes in %4 "
+	    "allocations").arg(diagram.edgeCount()).arg(dcel.vertexCount())
+	.arg((ulong)arena.getBytes())
+	.arg((ulong)arena.getAllocations());
+    stats += QString(cached ? ", from the cache" : "") +
+	QString(" (cache: %1 hits, %2 misses)").arg(cache.getHits())
+	.arg(cache.getMisses());
+    qDebug("arena: %s, %lu bytes reserved", stats.latin1(), 
+	    (ulong)arena.getReserved());
+    emit message(stats);
+
+    /* draw the canvas, reusing the bisectors of the last run */
+    eraseBisectors(diagram.edgeCount());
+    for (int edge=0; edge<diagram.edgeCount(); edge++) {
+	drawBisector(edge);
+	qDebug("bisector of (%d,%d)-(%d,%d) has %d infinity end.", 
+		diagram.getX(diagram.getLeftPoint(edge)), 
+		diagram.getY(diagram.getLeftPoint(edge)), 
+		diagram.getX(diagram.getRightPoint(edge)), 
+		diagram.getY(diagram.getRightPoint(edge)), 
+		diagram.getLineType(edge));
+    }
+} // }}}
+
+void DiagramView::contentsContextMenuEvent(QContextMenuEvent *event)
+{ // {{{
+    QPopupMenu contextMenu(this);
+    newAct->addTo(&contextMenu);
+    calAct->addTo(&contextMenu);
+    menuPoint = pointAt(event->pos().x(), event->pos().y());
+    if (menuPoint != -1) {
+	contextMenu.insertSeparator();
+	delAct->addTo(&contextMenu);
+    }
+    contextMenu.exec(event->globalPos());
+} // }}}
+
+void DiagramView::deletePoint()
+{ // {{{
+    if (menuPoint < 0 || (unsigned int)menuPoint >= pointList.size())
+	return;
+    int site = menuPoint;
+    menuPoint = -1;
+    qDebug("(%d,%d) is been deleted.", pointList[site]->getX(),
+	    pointList[site]->getY());
+
+    /* the last point takes the place, as the last site does */
+    int last = pointList.size() - 1;
+    delete pointList[site];
+    pointList[site] = pointList[last];
+    pointList.pop_back();
+    pointHash.erase(site);
+    pointHash.erase(last);
+    if (site != last)
+	pointHash.insert(site, pointList[site]->getX(), pointList[site]->getY());
+
+    if (calculated) {
+	editor.removeSite(site);
+	drawTouched();
+    }
+    canvas()->update();
+} // }}}
+
+int DiagramView::pointAt(int x, int y) const
+{ // {{{
+    return pointHash.findNear(x, y, DiagramPoint::DIAMETER / 2);
+} // }}}
+
+void DiagramView::indexPoints()
+{ // {{{
+    pointHash.clear();
+    for (unsigned int i=0; i<pointList.size(); i++)
+	pointHash.insert(i, pointList[i]->getX(), pointList[i]->getY());
+} // }}}
+
+void DiagramView::eraseBisectors(unsigned int from)
+{ // {{{
+    for (unsigned int i=from; i<edgeList.size(); i++)
+	edgeList[i]->erase();
+    canvas()->update();
+} // }}}
+
+void DiagramView::drawBisector(int edge)
+{ // {{{
+    if (!diagram.isEnabled(edge) && (unsigned int)edge < edgeList.size()) {
+	/* its sites may be gone by now */
+	edgeList[edge]->erase();
+	return;
+    }
+
+    DiagramBisector *bisector;
+    if ((unsigned int)edge < edgeList.size()) {
+	bisector = edgeList[edge];
+	bisector->bind(diagram, edge);
+    } else {
+	bisector = new DiagramBisector(diagram, edge, canvas());
+	edgeList.push_back(bisector);
+    }
+    bisector->draw();
+} // }}}
+
+void DiagramView::drawTouched()
+{ // {{{
+    const vector<int> &touched = editor.getTouched();
+    for (unsigned int i=0; i<touched.size(); i++)
+	drawBisector(touched[i]);
+    canvas()->update();
+    dcelStale = true;
+    emit message(QString("%1 edges, %2 changed by the edit")
+	    .arg(diagram.edgeCount()).arg(touched.size()));
+} // }}}
+
+const VoronoiDcel & DiagramView::getDcel()
+{ // {{{
+    if (dcelStale) {
+	dcel.build(diagram);
+	dcelStale = false;
+    }
+    return dcel;
+} // }}}
+
+bool DiagramView::isDuplicate(int x, int y)
+{ // {{{
+    return pointHash.find(x, y) != SiteHash::NONE;
+} // }}}
+
+void DiagramView::contentsMousePressEvent(QMouseEvent *event)
+{ // {{{
+    if (event->button() == LeftButton) {
+	/* a point under the button is dragged, anywhere else one is added */
+	dragPoint = pointAt(event->pos().x(), event->pos().y());
+	if (dragPoint == -1)
+	    addPoint(event->pos().x(), event->pos().y());
+    }
+} // }}}
+
+void DiagramView::contentsMouseMoveEvent(QMouseEvent *event)
+{ // {{{
+    emit locationChanged(event->pos().x(), event->pos().y());
+    if (dragPoint != -1)
+	movePoint(dragPoint, event->pos().x(), event->pos().y());
+} // }}}
+
+void DiagramView::contentsMouseReleaseEvent(QMouseEvent *event)
+{ // {{{
+    if (event->button() == LeftButton)
+	dragPoint = -1;
+} // }}}
+
+void DiagramView::movePoint(int point, int x, int y)
+{ // {{{
+    if (x < 0 || x > canvas()->width() || y < 0 || y > canvas()->height())
+	return;
+
+    /* the diagram follows through the cells around the point */
+    if (calculated) {
+	/* a refused move still puts the site back, with new edges */
+	if (editor.moveSite(point, x, y)) {
+	    pointList[point]->moveTo(x, y);
+	    pointHash.move(point, x, y);
+	}
+	drawTouched();
+    } else if (!isDuplicate(x, y)) {
+	pointList[point]->moveTo(x, y);
+	pointHash.move(point, x, y);
+	canvas()->update();
+    }
+} // }}}
+
+void DiagramView::addPoint(int x, int y)
+{ // {{{
+    if (!isDuplicate(x, y) && 
+	    x >= 0 && x <= canvas()->width() && 
+	    y >= 0 && y <= canvas()->height()) {
+	DiagramPoint *newPoint = new DiagramPoint(x, y, 
+		DiagramPoint::DIAMETER, canvas());
+	pointList.push_back(newPoint);
+	pointHash.insert(pointList.size() - 1, x, y);
+	qDebug("(%d,%d) is been added.", x, y);
+
+	/* with a diagram up, only the cells around the new site change */
+	if (calculated) {
+	    editor.insertSite(x, y);
+	    drawTouched();
+	} else
+	    canvas()->update();
+    }
+} // }}}
+
+void DiagramView::addPoints(const int *x, const int *y, int count)
+{ // {{{
+    int added = 0;
+    for (int i=0; i<count; i++) {
+	if (isDuplicate(x[i], y[i]) ||
+		x[i] < 0 || x[i] > canvas()->width() ||
+		y[i] < 0 || y[i] > canvas()->height())
+	    continue;
+	pointList.push_back(new DiagramPoint(x[i], y[i],
+		    DiagramPoint::DIAMETER, canvas()));
+	pointHash.insert(pointList.size() - 1, x[i], y[i]);
+	added++;
+    }
+    qDebug("%d of %d points have been added.", added, count);
+
+    /* one run is cheaper than an edit for every point */
+    if (calculated && added > 0)
+	calculate();
+    else {
+	canvas()->update();
+	emit message(QString("%1 of %2 points added").arg(added).arg(count));
+    }
+} // }}}
+
+bool DiagramView::importFile(const QString &path)
+{ // {{{
+    SiteImporter importer;
+    importer.setThreads(0);
+    if (!importer.import(path.latin1())) {
+	if (importer.getErrorOffset() == -1) {
+	    QMessageBox::warning(this, tr("Import"),
+		    tr("%1 can't be read.").arg(path));
+	} else {
+	    QMessageBox::warning(this, tr("Import"),
+		    tr("%1 is malformed at byte %2.").arg(path)
+		    .arg((ulong)importer.getErrorOffset()));
+	}
+	return false;
+    }
+    addPoints(importer.getX(), importer.getY(), importer.siteCount());
+    return true;
+} // }}}
+
+bool DiagramView::exportFile(const QString &path, const VoronoiBox &box)
+{ // {{{
+    if (!calculated) {
+	QMessageBox::warning(this, tr("Export"),
+		tr("There is no diagram to export yet."));
+	return false;
+    }
+    QString name = path.lower();
+    VoronoiExporter::Format format = (name.endsWith(".geojson") ||
+	    name.endsWith(".json")) ? VoronoiExporter::GEOJSON
+	: VoronoiExporter::SVG;
+    VoronoiExporter exporter(diagram);
+    exporter.setBox(box);
+    exporter.setContent(VoronoiExporter::SITES | VoronoiExporter::EDGES |
+	    VoronoiExporter::CELLS);
+
+    FILE *out = fopen(path.latin1(), "w");
+    bool done = (out != NULL && exporter.write(out, format));
+    if (out != NULL && fclose(out) != 0)
+	done = false;
+    if (!done) {
+	QMessageBox::warning(this, tr("Export"),
+		tr("%1 can't be written.").arg(path));
+	return false;
+    }
+    emit message(QString("%1 edges exported").arg(diagram.edgeCount()));
+    return true;
+} // }}}
+
+DiagramView::~DiagramView()
+{ // {{{
+    delete dynTip;
+    dynTip = 0;
+} // }}}
+// }}}
+
+///////////////////////////////////////////////////////////////////////////////
+// 	DiagramPoint
+// {{{
+
+DiagramPoint::DiagramPoint(int x, int y, int diameter, QCanvas *canvas)
+    : QCanvasEllipse(diameter,diameter,canvas), posX(x), posY(y)
+{ // {{{
+    setBrush(QColor(Qt::black));
+    move(x, y);
+    show();
+} // }}}
+
+void DiagramPoint::moveTo(int x, int y)
+{ // {{{
+    posX = x;
+    posY = y;
+    move(x, y);
+} // }}}
+
+bool DiagramPoint::operator==(DiagramPoint &rhs) const
+{ // {{{
+    return ( posX == rhs.getX() && posY == rhs.getY());
+} // }}}
+
+DiagramPoint::~DiagramPoint()
+{ // {{{
+    hide();
+} // }}}
+// }}}
+
+///////////////////////////////////////////////////////////////////////////////
+// 	DiagramLine
+// {{{
+
+DiagramLine::DiagramLine(const VoronoiDiagram &diagram, int leftPoint, 
+	int rightPoint, QCanvas *canvas) 
+    : QCanvasLine(canvas)
+{ // {{{
+    setSites(diagram, leftPoint, rightPoint);
+} // }}}
+
+void DiagramLine::setSites(const VoronoiDiagram &diagram, int leftPoint, 
+	int rightPoint)
+{ // {{{
+    setPoints(diagram.getX(leftPoint), diagram.getY(leftPoint), 
+	    diagram.getX(rightPoint), diagram.getY(rightPoint));
+} // }}}
+
+void DiagramLine::draw()
+{ // {{{
+    setPen(QPen(QColor(Qt::red), 0, DotLine));
+    show();
+    canvas()->update();
+} // }}}
+
+DiagramLine::~DiagramLine()
+{ // {{{
+    hide();
+} // }}}
+// }}}
+
+///////////////////////////////////////////////////////////////////////////////
+// 	DiagramBisector
+// {{{
+
+DiagramBisector::DiagramBisector(const VoronoiDiagram &diagram, int edge, 
+	QCanvas *canvas)
+    : QCanvasLine(canvas), enable(diagram.isEnabled(edge)), 
+    line(diagram, diagram.getLeftPoint(edge), diagram.getRightPoint(edge), 
+	    canvas), 
+    leftX(diagram.getX(diagram.getLeftPoint(edge))), 
+    leftY(diagram.getY(diagram.getLeftPoint(edge))), 
+    rightX(diagram.getX(diagram.getRightPoint(edge))), 
+    rightY(diagram.getY(diagram.getRightPoint(edge))), 
+    startPointX(diagram.getStartPoint(edge).first), 
+    startPointY(diagram.getStartPoint(edge).second), 
+    endPointX(diagram.getEndPoint(edge).first), 
+    endPointY(diagram.getEndPoint(edge).second)
+{ // {{{
+} // }}}
+
+void DiagramBisector::bind(const VoronoiDiagram &diagram, int edge)
+{ // {{{
+    enable = diagram.isEnabled(edge);
+    line.setSites(diagram, diagram.getLeftPoint(edge), 
+	    diagram.getRightPoint(edge));
+    leftX = diagram.getX(diagram.getLeftPoint(edge));
+    leftY = diagram.getY(diagram.getLeftPoint(edge));
+    rightX = diagram.getX(diagram.getRightPoint(edge));
+    rightY = diagram.getY(diagram.getRightPoint(edge));
+    startPointX = diagram.getStartPoint(edge).first;
+    startPointY = diagram.getStartPoint(edge).second;
+    endPointX = diagram.getEndPoint(edge).first;
+    endPointY = diagram.getEndPoint(edge).second;
+} // }}}
+
+void DiagramBisector::erase()
+{ // {{{
+    line.hide();
+    hide();
+} // }}}
+
+void DiagramBisector::draw()
+{ // {{{
+    if (enable) {
+	line.draw(); /* Draw the line consist of two DigramPoint */
+	qDebug("!!Bisector of (%d,%d)-(%d,%d) whose two point (%f,%f) (%f,%f) to draw",
+		leftX, leftY, rightX, rightY, 
+		startPointX, startPointY, endPointX, endPointY); 
+	setPoints((int)startPointX, (int)startPointY, 
+		(int)endPointX, (int)endPointY);
+	setPen(QColor(Qt::blue));
+	show();
+	canvas()->update();
+    }
+} // }}}
+
+DiagramBisector::~DiagramBisector()
+{ // {{{
+    hide();
+} // }}}
+
+// }}}
@@ -0,0 +1,320 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+
+#include "importer.h"
+#include "sitehash.h"
+#include "taskpool.h"
+
+using namespace std;
+
+/* Bytes a chunk takes at least; smaller ones aren't worth a task */
+static const size_t MIN_CHUNK = 1 << 20;
+/* How much of a file AUTO looks at */
+static const size_t SNIFF_SIZE = 4096;
+
+/* One phase of an import over one chunk, or one share of the hashes */
+class ImportTask : public VoronoiTask
+{
+    public:
+	ImportTask(SiteImporter &importer, SiteImporter::Phase phase,
+		int chunk)
+	    : importer(importer), phase(phase), chunk(chunk) {};
+	void run(int) { importer.runChunk(phase, chunk); };
+
+    private:
+	SiteImporter &importer;
+	SiteImporter::Phase phase;
+	int chunk;
+};
+
+/* Spawns the chunks of a phase and waits for them */
+class ImportBatchTask : public VoronoiTask
+{
+    public:
+	ImportBatchTask(TaskPool &pool, std::vector<ImportTask> &chunks)
+	    : pool(pool), chunks(chunks) {};
+	void run(int worker)
+	{
+	    for (unsigned int i=0; i<chunks.size(); i++)
+		pool.spawn(worker, &chunks[i]);
+	    for (unsigned int j=0; j<chunks.size(); j++)
+		pool.join(worker, &chunks[j]);
+	};
+
+    private:
+	TaskPool &pool;
+	std::vector<ImportTask> &chunks;
+};
+
+static inline bool isBlank(char c)
+{ // {{{
+    return c == ' ' || c == '\t' || c == '\r';
+} // }}}
+
+static inline bool isSeparator(char c)
+{ // {{{
+    return isBlank(c) || c == ',' || c == ';';
+} // }}}
+
+/* Reads an int at p, leaving p after it; false if there is none */
+static bool readInt(const char *&p, const char *end, int &value)
+{ // {{{
+    bool negative = (p < end && *p == '-');
+    if (p < end && (*p == '-' || *p == '+'))
+	p++;
+    if (p == end || *p < '0' || *p > '9')
+	return false;
+
+    long long magnitude = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+	magnitude = magnitude * 10 + (*p++ - '0');
+	if (magnitude > 2147483648LL)
+	    return false;
+    }
+    if (!negative && magnitude > 2147483647LL)
+	return false;
+    value = (int)(negative ? -magnitude : magnitude);
+    return true;
+} // }}}
+
+static inline int readLittle(const unsigned char *p)
+{ // {{{
+    return (int)((unsigned int)p[0] | (unsigned int)p[1] << 8 |
+	    (unsigned int)p[2] << 16 | (unsigned int)p[3] << 24);
+} // }}}
+
+SiteImporter::SiteImporter()
+    : threads(1), pool(NULL), format(AUTO), data(NULL), size(0),
+    binary(false), errorOffset(-1), duplicates(0)
+{ // {{{
+} // }}}
+
+SiteImporter::~SiteImporter()
+{ // {{{
+    delete pool;
+} // }}}
+
+void SiteImporter::setThreads(int count)
+{ // {{{
+    int wanted = (count < 1) ? TaskPool::processorCount() : count;
+    if (wanted != threads) {
+	delete pool;
+	pool = NULL;
+    }
+    threads = wanted;
+} // }}}
+
+bool SiteImporter::import(const char *path)
+{ // {{{
+    errorOffset = -1;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+	return false;
+    struct stat info;
+    if (fstat(fd, &info) < 0) {
+	int error = errno;
+	close(fd);
+	errno = error;
+	return false;
+    }
+
+    /* an empty file can't be mapped, but holds no sites either */
+    size_t length = (size_t)info.st_size;
+    void *mapped = NULL;
+    if (length > 0) {
+	mapped = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (mapped == MAP_FAILED) {
+	    int error = errno;
+	    close(fd);
+	    errno = error;
+	    return false;
+	}
+    }
+    close(fd);
+
+    bool done = parse((const char *)mapped, length);
+    if (mapped != NULL)
+	munmap(mapped, length);
+    return done;
+} // }}}
+
+bool SiteImporter::parse(const char *bytes, size_t length)
+{ // {{{
+    data = bytes;
+    size = length;
+    siteX.clear();
+    siteY.clear();
+    errorOffset = -1;
+    duplicates = 0;
+
+    binary = (format == BINARY);
+    if (format == AUTO) {
+	for (size_t i=0; i<min(size, SNIFF_SIZE); i++) {
+	    unsigned char c = data[i];
+	    if ((c < 0x20 && c != '\t' && c != '\n' && c != '\r') || c >= 0x7f)
+		binary = true;
+	}
+    }
+
+    /* cut at line ends, or at whole sites */
+    size_t count = min((size_t)threads * 4, size / MIN_CHUNK + 1);
+    chunks.assign(count, Chunk());
+    size_t begin = 0;
+    for (size_t c=0; c<count; c++) {
+	size_t end = max(begin, size / count * (c + 1));
+	if (c + 1 == count)
+	    end = size;		/* with whatever is left over */
+	else if (binary)
+	    end -= (end - begin) % 8;
+	else {
+	    while (end > 0 && end < size && data[end-1] != '\n')
+		end++;
+	}
+	chunks[c].begin = begin;
+	chunks[c].end = end;
+	chunks[c].errorOffset = -1;
+	begin = end;
+    }
+    runPhase(PARSE);
+
+    size_t total = 0;
+    for (size_t d=0; d<count; d++) {
+	if (chunks[d].errorOffset != -1) {
+	    errorOffset = chunks[d].errorOffset;
+	    chunks.clear();
+	    return false;
+	}
+	total += chunks[d].x.size();
+    }
+    siteX.reserve(total);
+    siteY.reserve(total);
+    for (size_t e=0; e<count; e++) {
+	siteX.insert(siteX.end(), chunks[e].x.begin(), chunks[e].x.end());
+	siteY.insert(siteY.end(), chunks[e].y.begin(), chunks[e].y.end());
+    }
+    chunks.clear();
+
+    duplicate.assign(total, 0);
+    runPhase(DEDUPE);
+    int kept = 0;
+    for (size_t i=0; i<total; i++) {
+	if (duplicate[i])
+	    continue;
+	siteX[kept] = siteX[i];
+	siteY[kept] = siteY[i];
+	kept++;
+    }
+    duplicates = (int)total - kept;
+    siteX.resize(kept);
+    siteY.resize(kept);
+    duplicate.clear();
+    return true;
+} // }}}
+
+void SiteImporter::runPhase(Phase phase)
+{ // {{{
+    int count = (phase == PARSE) ? (int)chunks.size() : threads;
+    if (threads == 1 || count == 1) {
+	for (int chunk=0; chunk<count; chunk++)
+	    runChunk(phase, chunk);
+	return;
+    }
+
+    if (pool == NULL)
+	pool = new TaskPool(threads);
+    vector<ImportTask> tasks;
+    for (int chunk=0; chunk<count; chunk++)
+	tasks.push_back(ImportTask(*this, phase, chunk));
+    ImportBatchTask batch(*pool, tasks);
+    pool->execute(batch);
+} // }}}
+
+void SiteImporter::runChunk(Phase phase, int chunk)
+{ // {{{
+    if (phase == DEDUPE)
+	dedupe(chunk);
+    else if (binary)
+	parseBinary(chunks[chunk]);
+    else
+	parseText(chunks[chunk]);
+} // }}}
+
+void SiteImporter::parseText(Chunk &chunk)
+{ // {{{
+    const char *p = data + chunk.begin, *end = data + chunk.end;
+    bool firstLine = (chunk.begin == 0);
+    chunk.x.reserve((chunk.end - chunk.begin) / 8);
+    chunk.y.reserve((chunk.end - chunk.begin) / 8);
+
+    while (p < end) {
+	const char *line = p;
+	while (p < end && isBlank(*p))
+	    p++;
+	if (p == end || *p == '\n' || *p == '#') {
+	    while (p < end && *p++ != '\n')
+		;
+	    continue;
+	}
+
+	const char *first = p;
+	int x, y;
+	bool site = readInt(p, end, x);
+	if (site) {
+	    const char *gap = p;
+	    while (p < end && isSeparator(*p))
+		p++;
+	    site = (p > gap) && readInt(p, end, y);
+	}
+	/* whatever follows another separator is another field */
+	site = site && (p == end || *p == '\n' || isSeparator(*p));
+	if (site) {
+	    chunk.x.push_back(x);
+	    chunk.y.push_back(y);
+	} else if (!firstLine || (*first >= '0' && *first <= '9') ||
+		*first == '-' || *first == '+') {
+	    chunk.errorOffset = (long)(line - data);
+	    return;
+	}
+	firstLine = false;
+	while (p < end && *p++ != '\n')
+	    ;
+    }
+} // }}}
+
+void SiteImporter::parseBinary(Chunk &chunk)
+{ // {{{
+    if ((chunk.end - chunk.begin) % 8 != 0) {
+	chunk.errorOffset = (long)(chunk.end - (chunk.end - chunk.begin) % 8);
+	return;
+    }
+    size_t count = (chunk.end - chunk.begin) / 8;
+    const unsigned char *p = (const unsigned char *)data + chunk.begin;
+    chunk.x.resize(count);
+    chunk.y.resize(count);
+    for (size_t i=0; i<count; i++, p+=8) {
+	chunk.x[i] = readLittle(p);
+	chunk.y[i] = readLittle(p + 4);
+    }
+} // }}}
+
+void SiteImporter::dedupe(int share)
+{ // {{{
+    /* every share sees the sites in order, so the first one is kept */
+    SiteHash seen(1);
+    int shares = threads, local = 0;
+    for (size_t i=0; i<siteX.size(); i++) {
+	unsigned int hash = (unsigned int)siteX[i] * 2654435761u +
+	    (unsigned int)siteY[i] * 40503u;
+	if ((int)((hash >> 16) % shares) != share)
+	    continue;
+	if (seen.find(siteX[i], siteY[i]) != SiteHash::NONE)
+	    duplicate[i] = 1;
+	else
+	    seen.insert(local++, siteX[i], siteY[i]);
+    }
+} // }}}
@@ -0,0 +1,75 @@
+#ifndef IMPORTER_H
+#define IMPORTER_H
+
+#include <stddef.h>
+
+#include <vector>
+
+class TaskPool;
+
+/*
+ * Reads sites in bulk from a file mapped into memory, or from a buffer.
+ * Two formats are understood:
+ *
+ * TEXT, one site per line as "x y" or "x,y" (more fields are ignored),
+ * with blank lines, lines starting with '#' and a first line that isn't
+ * a site (a CSV header) skipped.
+ *
+ * BINARY, packed pairs of 32-bit little-endian integers, x before y.
+ *
+ * AUTO takes a file for BINARY when its first block holds a byte that
+ * no text has.  The file is cut into chunks at line ends and the chunks
+ * are parsed on a TaskPool; then every task drops the duplicates of a
+ * share of the hash values, so that the first of equal sites is kept and
+ * the sites stay in the order of the file.
+ */
+class SiteImporter
+{
+    public:
+	enum Format { AUTO, TEXT, BINARY };
+
+	SiteImporter();
+	~SiteImporter();
+	/* 1 runs serially, 0 takes every processor */
+	void setThreads(int count);
+	void setFormat(Format newFormat) { format = newFormat; };
+	/* false if the file can't be read (see errno) or is malformed */
+	bool import(const char *path);
+	bool parse(const char *data, size_t size);
+	/* the offset of the first malformed line, or -1 */
+	long getErrorOffset() const { return errorOffset; };
+	int siteCount() const { return (int)siteX.size(); };
+	const int * getX() const { return siteX.empty() ? NULL : &siteX[0]; };
+	const int * getY() const { return siteY.empty() ? NULL : &siteY[0]; };
+	/* dropped by the last import as equal to an earlier site */
+	int getDuplicates() const { return duplicates; };
+
+    private:
+	friend class ImportTask;
+	enum Phase { PARSE, DEDUPE };
+	struct Chunk {
+	    size_t begin, end;		/* of data */
+	    std::vector<int> x, y;
+	    long errorOffset;
+	};
+
+	void runPhase(Phase phase);
+	void runChunk(Phase phase, int chunk);
+	void parseText(Chunk &chunk);
+	void parseBinary(Chunk &chunk);
+	void dedupe(int share);
+
+	int threads;
+	TaskPool *pool;
+	Format format;
+	const char *data;
+	size_t size;
+	bool binary;
+	std::vector<Chunk> chunks;
+	std::vector<int> siteX, siteY;
+	std::vector<char> duplicate;	/* by index into siteX */
+	long errorOffset;
+	int duplicates;
+};
+
+#endif
@@ -0,0 +1,261 @@
+#include <math.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "diagram.h"
+#include "locator.h"
+#include "taskpool.h"
+
+using namespace std;
+
+/* Queries a chunk goes through serially; smaller ones aren't worth a task */
+static const int MIN_CHUNK = 4096;
+
+/* Locates one chunk of a batch */
+class LocateTask : public VoronoiTask
+{
+    public:
+	LocateTask(const VoronoiLocator &locator, const double *x,
+		const double *y, int count, int *sites)
+	    : locator(locator), x(x), y(y), count(count), sites(sites) {};
+	void run(int) { locator.locateChunk(x, y, count, sites); };
+
+    private:
+	const VoronoiLocator &locator;
+	const double *x, *y;
+	int count;
+	int *sites;
+};
+
+/* Spawns the chunks of a batch and waits for them */
+class BatchTask : public VoronoiTask
+{
+    public:
+	BatchTask(TaskPool &pool, std::vector<LocateTask> &chunks)
+	    : pool(pool), chunks(chunks) {};
+	void run(int worker)
+	{
+	    for (unsigned int i=0; i<chunks.size(); i++)
+		pool.spawn(worker, &chunks[i]);
+	    for (unsigned int j=0; j<chunks.size(); j++)
+		pool.join(worker, &chunks[j]);
+	};
+
+    private:
+	TaskPool &pool;
+	std::vector<LocateTask> &chunks;
+};
+
+/* The distance along a Hilbert curve through a 65536 by 65536 grid */
+static unsigned int hilbertKey(unsigned int x, unsigned int y)
+{ // {{{
+    unsigned int key = 0;
+    for (unsigned int s=1<<15; s>0; s>>=1) {
+	unsigned int rx = (x & s) ? 1 : 0, ry = (y & s) ? 1 : 0;
+	key += s * s * ((3 * rx) ^ ry);
+	/* turn the quadrant so that the curve runs on inside it */
+	if (ry == 0) {
+	    if (rx == 1) {
+		x = 0xffff - x;
+		y = 0xffff - y;
+	    }
+	    swap(x, y);
+	}
+    }
+    return key;
+} // }}}
+
+VoronoiLocator::VoronoiLocator(const VoronoiDiagram &diagram)
+    : diagram(diagram), threads(1), pool(NULL), gridSize(0),
+    gridX(0), gridY(0), cellWidth(1), cellHeight(1)
+{ // {{{
+    build();
+} // }}}
+
+VoronoiLocator::~VoronoiLocator()
+{ // {{{
+    delete pool;
+} // }}}
+
+void VoronoiLocator::setThreads(int count)
+{ // {{{
+    int wanted = (count < 1) ? TaskPool::processorCount() : count;
+    if (wanted != threads) {
+	delete pool;
+	pool = NULL;
+    }
+    threads = wanted;
+} // }}}
+
+void VoronoiLocator::build()
+{ // {{{
+    grid.clear();
+    int count = diagram.siteCount();
+    if (count == 0) {
+	gridSize = 0;
+	return;
+    }
+
+    /* about four sites to a cell */
+    double minX = diagram.getX(0), maxX = minX;
+    double minY = diagram.getY(0), maxY = minY;
+    for (int i=1; i<count; i++) {
+	minX = min(minX, (double)diagram.getX(i));
+	maxX = max(maxX, (double)diagram.getX(i));
+	minY = min(minY, (double)diagram.getY(i));
+	maxY = max(maxY, (double)diagram.getY(i));
+    }
+    gridSize = max(1, (int)sqrt(count / 4.0));
+    gridX = minX;
+    gridY = minY;
+    cellWidth = max(maxX - minX, 1.0) / gridSize;
+    cellHeight = max(maxY - minY, 1.0) / gridSize;
+
+    grid.assign(gridSize * gridSize, VoronoiDiagram::NONE);
+    for (int site=0; site<count; site++) {
+	int cell = cellOf(diagram.getX(site), diagram.getY(site));
+	if (grid[cell] == VoronoiDiagram::NONE)
+	    grid[cell] = site;
+    }
+
+    /* an empty cell borrows the site of the one before, or after */
+    int last = VoronoiDiagram::NONE;
+    for (unsigned int i=0; i<grid.size(); i++) {
+	if (grid[i] == VoronoiDiagram::NONE)
+	    grid[i] = last;
+	else
+	    last = grid[i];
+    }
+    for (int j=(int)grid.size()-1; j>=0; j--) {
+	if (grid[j] == VoronoiDiagram::NONE)
+	    grid[j] = last;
+	else
+	    last = grid[j];
+    }
+} // }}}
+
+int VoronoiLocator::cellOf(double x, double y) const
+{ // {{{
+    int column = (int)((x - gridX) / cellWidth);
+    int row = (int)((y - gridY) / cellHeight);
+    column = min(max(column, 0), gridSize - 1);
+    row = min(max(row, 0), gridSize - 1);
+    return row * gridSize + column;
+} // }}}
+
+int VoronoiLocator::walk(int site, double x, double y) const
+{ // {{{
+    double dx = diagram.getX(site) - x, dy = diagram.getY(site) - y;
+    double best = dx * dx + dy * dy;
+    for (;;) {
+	int next = site;
+	bool tied = false;
+	int first = diagram.firstEdge(site), edge = first;
+	if (first == VoronoiDiagram::NONE)
+	    return site;
+	do {
+	    int other = diagram.otherSite(edge, site);
+	    dx = diagram.getX(other) - x;
+	    dy = diagram.getY(other) - y;
+	    if (dx * dx + dy * dy < best) {
+		best = dx * dx + dy * dy;
+		next = other;
+		tied = false;
+	    } else if (dx * dx + dy * dy == best)
+		tied = true;
+	    edge = diagram.nextEdge(site, edge);
+	} while (edge != first);
+	if (next == site)
+	    return tied ? lowestTied(site, x, y, best) : site;
+	site = next;
+    }
+} // }}}
+
+int VoronoiLocator::lowestTied(int site, double x, double y,
+	double best) const
+{ // {{{
+    /*
+     * The sites as near as site lie on a circle around (x, y) with no
+     * site inside, so each is linked to the next one along it; where the
+     * walk came in depends on the start, the lowest id of them doesn't.
+     */
+    vector<int> ties(1, site);
+    int lowest = site;
+    for (unsigned int i=0; i<ties.size(); i++) {
+	int first = diagram.firstEdge(ties[i]), edge = first;
+	do {
+	    int other = diagram.otherSite(edge, ties[i]);
+	    double dx = diagram.getX(other) - x;
+	    double dy = diagram.getY(other) - y;
+	    if (dx * dx + dy * dy == best &&
+		    find(ties.begin(), ties.end(), other) == ties.end()) {
+		ties.push_back(other);
+		lowest = min(lowest, other);
+	    }
+	    edge = diagram.nextEdge(ties[i], edge);
+	} while (edge != first);
+    }
+    return lowest;
+} // }}}
+
+int VoronoiLocator::locate(double x, double y) const
+{ // {{{
+    if (grid.empty())
+	return VoronoiDiagram::NONE;
+    return walk(grid[cellOf(x, y)], x, y);
+} // }}}
+
+void VoronoiLocator::locateChunk(const double *x, const double *y,
+	int count, int *sites) const
+{ // {{{
+    if (count == 0)
+	return;
+    if (grid.empty()) {
+	fill(sites, sites + count, (int)VoronoiDiagram::NONE);
+	return;
+    }
+
+    /* along the curve through the box of the chunk */
+    double minX = x[0], maxX = x[0], minY = y[0], maxY = y[0];
+    for (int i=1; i<count; i++) {
+	minX = min(minX, x[i]);		maxX = max(maxX, x[i]);
+	minY = min(minY, y[i]);		maxY = max(maxY, y[i]);
+    }
+    double scaleX = 65535 / max(maxX - minX, 1e-9);
+    double scaleY = 65535 / max(maxY - minY, 1e-9);
+    vector< pair<unsigned int, int> > order(count);
+    for (int j=0; j<count; j++) {
+	order[j].first = hilbertKey((unsigned int)((x[j] - minX) * scaleX),
+		(unsigned int)((y[j] - minY) * scaleY));
+	order[j].second = j;
+    }
+    sort(order.begin(), order.end());
+
+    int site = grid[cellOf(x[order[0].second], y[order[0].second])];
+    for (int k=0; k<count; k++) {
+	int query = order[k].second;
+	site = walk(site, x[query], y[query]);
+	sites[query] = site;
+    }
+} // }}}
+
+void VoronoiLocator::locateAll(const double *x, const double *y, int count,
+	int *sites)
+{ // {{{
+    int chunk = max(MIN_CHUNK, count / (threads * 8) + 1);
+    if (threads == 1 || count <= chunk) {
+	locateChunk(x, y, count, sites);
+	return;
+    }
+
+    if (pool == NULL)
+	pool = new TaskPool(threads);
+    vector<LocateTask> chunks;
+    for (int begin=0; begin<count; begin+=chunk) {
+	chunks.push_back(LocateTask(*this, x + begin, y + begin,
+		    min(chunk, count - begin), sites + begin));
+    }
+    BatchTask batch(*pool, chunks);
+    pool->execute(batch);
+} // }}}
@@ -0,0 +1,57 @@
+#ifndef LOCATOR_H
+#define LOCATOR_H
+
+#include <vector>
+
+#include "diagram.h"
+
+class TaskPool;
+
+/*
+ * Finds the cell holding a point, that is the nearest site, in a finished
+ * VoronoiDiagram.  A query walks the rings from a start site to ever
+ * nearer neighbors; in the Delaunay graph that walk only stops at the
+ * nearest site.  The start comes from a coarse grid of sites.  Of
+ * several nearest sites the lowest id is taken, so the answer doesn't
+ * depend on the start.
+ *
+ * locateAll() cuts a batch into chunks for a TaskPool and sorts every
+ * chunk along a Hilbert curve first, so each walk starts from the answer
+ * to a query close by and takes a step or two.
+ *
+ * The diagram must stay unchanged while the locator is in use.
+ */
+class VoronoiLocator
+{
+    public:
+	VoronoiLocator(const VoronoiDiagram &diagram);
+	~VoronoiLocator();
+	/* 1 runs serially, 0 takes every processor */
+	void setThreads(int count);
+	/* the grid over the sites; again after the diagram has changed */
+	void build();
+	/* the nearest site, NONE for an empty diagram */
+	int locate(double x, double y) const;
+	/* sites[i] for (x[i], y[i]) */
+	void locateAll(const double *x, const double *y, int count,
+		int *sites);
+
+    private:
+	friend class LocateTask;
+
+	int cellOf(double x, double y) const;
+	int walk(int site, double x, double y) const;
+	int lowestTied(int site, double x, double y, double best) const;
+	void locateChunk(const double *x, const double *y, int count,
+		int *sites) const;
+
+	const VoronoiDiagram &diagram;
+	int threads;
+	TaskPool *pool;
+	int gridSize;
+	double gridX, gridY;		/* the corner of the grid */
+	double cellWidth, cellHeight;
+	std::vector<int> grid;		/* a site near every cell, by row */
+};
+
+#endif
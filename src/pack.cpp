@@ -0,0 +1,276 @@
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "diagfile.h"
+#include "packer.h"
+
+using namespace std;
+
+/*
+ * voronoi-pack: packs diagram files (see diagfile.h and packer.h), and
+ * unpacks them to the edge lines of voronoi-cli.
+ *
+ * With -b it packs and unpacks a diagram file in memory a number of
+ * rounds and prints how small the packed diagram is next to the file and
+ * next to the edges as the diagram keeps them (four coordinates of sites,
+ * the two ends and the line, 72 bytes an edge), how fast both sides run
+ * next to copying the file, and how far the ends moved.
+ *
+ *	voronoi-pack [-s step] in.vd out
+ *	voronoi-pack -u in [out.txt]
+ *	voronoi-pack -b [-s step] [-r rounds] in.vd
+ */
+
+static const int EDGE_LIST_BYTES = 4 * sizeof(int) + 7 * sizeof(double);
+
+static double now()
+{ // {{{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+} // }}}
+
+static int usage(const char *name)
+{ // {{{
+    fprintf(stderr, "Usage: %s [-s step] in.vd out\n"
+	    "       %s -u in [out.txt]\n"
+	    "       %s -b [-s step] [-r rounds] in.vd\n", name, name, name);
+    return 2;
+} // }}}
+
+static bool openFile(VoronoiFileReader &reader, const char *path)
+{ // {{{
+    errno = 0;
+    if (!reader.open(path) || !reader.validate()) {
+	fprintf(stderr, "%s: %s\n", path, (reader.getError() != NULL)
+		? reader.getError() : strerror(errno));
+	return false;
+    }
+    return true;
+} // }}}
+
+static void writeEdges(FILE *out, const VoronoiUnpacker &unpacker)
+{ // {{{
+    const vector<VoronoiFileSite> &sites = unpacker.getSites();
+    const vector<VoronoiFileEdge> &edges = unpacker.getEdges();
+    for (size_t i=0; i<edges.size(); i++) {
+	const VoronoiFileEdge &edge = edges[i];
+	const VoronoiFileSite &left = sites[edge.site[0]];
+	const VoronoiFileSite &right = sites[edge.site[1]];
+	int infinite = ((edge.flags & VORONOI_FILE_END0_INF) ? 1 : 0) +
+	    ((edge.flags & VORONOI_FILE_END1_INF) ? 1 : 0);
+	fprintf(out, "%d %d %d %d %.17g %.17g %.17g %.17g %d\n",
+		left.x, left.y, right.x, right.y,
+		edge.x[0], edge.y[0], edge.x[1], edge.y[1], infinite);
+    }
+} // }}}
+
+/* An edge by the coordinates of its sites, to match across numberings */
+struct EdgeKey
+{
+    int32_t coords[4];
+    int index;
+    bool operator<(const EdgeKey &other) const
+    {
+	return lexicographical_compare(coords, coords + 4,
+		other.coords, other.coords + 4);
+    };
+};
+
+static void keysOf(const VoronoiFileSite *sites, const VoronoiFileEdge *edges,
+	int count, vector<EdgeKey> &keys)
+{ // {{{
+    keys.resize(count);
+    for (int i=0; i<count; i++) {
+	keys[i].coords[0] = sites[edges[i].site[0]].x;
+	keys[i].coords[1] = sites[edges[i].site[0]].y;
+	keys[i].coords[2] = sites[edges[i].site[1]].x;
+	keys[i].coords[3] = sites[edges[i].site[1]].y;
+	keys[i].index = i;
+    }
+    sort(keys.begin(), keys.end());
+} // }}}
+
+/* How far the ends moved, or -1 if the edges don't match */
+static double compare(const VoronoiFileReader &reader,
+	const VoronoiUnpacker &unpacker)
+{ // {{{
+    const VoronoiFileHeader &header = reader.getHeader();
+    const vector<VoronoiFileEdge> &edges = unpacker.getEdges();
+    if ((int)edges.size() != header.edgeCount ||
+	    (int)unpacker.getSites().size() != header.siteCount ||
+	    (int)unpacker.getVertices().size() != header.vertexCount)
+	return -1;
+    if (edges.empty())
+	return 0;
+
+    vector<EdgeKey> before, after;
+    keysOf(reader.getSites(), reader.getEdges(), header.edgeCount, before);
+    keysOf(&unpacker.getSites()[0], &edges[0], header.edgeCount, after);
+    double worst = 0;
+    for (int i=0; i<header.edgeCount; i++) {
+	if (before[i] < after[i] || after[i] < before[i])
+	    return -1;
+	const VoronoiFileEdge &a = reader.getEdges()[before[i].index];
+	const VoronoiFileEdge &b = edges[after[i].index];
+	if (a.flags != b.flags)
+	    return -1;
+	for (int end=0; end<2; end++) {
+	    worst = max(worst, fabs(a.x[end] - b.x[end]));
+	    worst = max(worst, fabs(a.y[end] - b.y[end]));
+	}
+    }
+    return worst;
+} // }}}
+
+static int benchmark(const char *path, double step, int rounds)
+{ // {{{
+    VoronoiFileReader reader;
+    if (!openFile(reader, path))
+	return 1;
+    const VoronoiFileHeader &header = reader.getHeader();
+    VoronoiPacker packer;
+    if (step > 0)
+	packer.setStep(step);
+
+    char *packed = NULL;
+    size_t packedSize = 0;
+    double start = now();
+    for (int round=0; round<rounds; round++) {
+	free(packed);
+	packed = NULL;
+	FILE *out = open_memstream(&packed, &packedSize);
+	if (out == NULL || !packer.pack(reader, out) || fclose(out) != 0) {
+	    perror("pack");
+	    return 1;
+	}
+    }
+    double packTime = (now() - start) / rounds;
+
+    VoronoiUnpacker unpacker;
+    start = now();
+    for (int round=0; round<rounds; round++) {
+	FILE *in = fmemopen(packed, packedSize, "rb");
+	if (in == NULL || !unpacker.unpack(in)) {
+	    fprintf(stderr, "unpack: %s\n", (unpacker.getError() != NULL) ?
+		    unpacker.getError() : strerror(errno));
+	    return 1;
+	}
+	fclose(in);
+    }
+    double unpackTime = (now() - start) / rounds;
+
+    /* as fast as anything can touch the bytes of the file */
+    vector<char> copy(header.fileSize);
+    const char *data = (const char *)&header;
+    start = now();
+    for (int round=0; round<rounds; round++)
+	memcpy(&copy[0], data, header.fileSize);
+    double copyTime = max((now() - start) / rounds, 1e-9);
+
+    double moved = compare(reader, unpacker);
+    double fileMB = header.fileSize / 1e6;
+    double listBytes = (double)header.edgeCount * EDGE_LIST_BYTES;
+    printf("%d sites, %d vertices, %d edges, step %g\n",
+	    header.siteCount, header.vertexCount, header.edgeCount,
+	    step > 0 ? step : 1.0 / 1024);
+    printf("file %lu bytes, edge list %.0f bytes, packed %lu bytes "
+	    "(%.2f bytes an edge)\n", (unsigned long)header.fileSize,
+	    listBytes, (unsigned long)packedSize,
+	    (double)packedSize / max(header.edgeCount, 1));
+    printf("ratio %.2f to the file, %.2f to the edge list\n",
+	    (double)header.fileSize / packedSize, listBytes / packedSize);
+    printf("pack %.3f ms (%.0f MB/s of file), unpack %.3f ms "
+	    "(%.0f MB/s), copy %.3f ms (%.0f MB/s)\n",
+	    packTime * 1e3, fileMB / packTime, unpackTime * 1e3,
+	    fileMB / unpackTime, copyTime * 1e3, fileMB / copyTime);
+    free(packed);
+    if (moved < 0) {
+	printf("unpacked edges don't match the file\n");
+	return 1;
+    }
+    printf("ends moved by up to %g (half a step is %g)\n", moved,
+	    (step > 0 ? step : 1.0 / 1024) / 2);
+    return 0;
+} // }}}
+
+int main(int argc, char **argv)
+{ // {{{
+    char mode = 'p';
+    double step = 0;
+    int rounds = 10;
+    int argi = 1;
+    for (; argi < argc && argv[argi][0] == '-' && argv[argi][1] != '\0';
+	    argi++) {
+	if (strcmp(argv[argi], "-u") == 0 || strcmp(argv[argi], "-b") == 0)
+	    mode = argv[argi][1];
+	else if (strcmp(argv[argi], "-s") == 0 && argi + 1 < argc)
+	    step = atof(argv[++argi]);
+	else if (strcmp(argv[argi], "-r") == 0 && argi + 1 < argc)
+	    rounds = atoi(argv[++argi]);
+	else
+	    return usage(argv[0]);
+    }
+    int files = argc - argi;
+    if (step < 0 || isinf(step) || rounds < 1)
+	return usage(argv[0]);
+
+    if (mode == 'b') {
+	if (files != 1)
+	    return usage(argv[0]);
+	return benchmark(argv[argi], step, rounds);
+    }
+
+    if (mode == 'u') {
+	if (files < 1 || files > 2)
+	    return usage(argv[0]);
+	FILE *in = fopen(argv[argi], "rb");
+	if (in == NULL) {
+	    perror(argv[argi]);
+	    return 1;
+	}
+	VoronoiUnpacker unpacker;
+	errno = 0;
+	bool good = unpacker.unpack(in);
+	fclose(in);
+	if (!good) {
+	    fprintf(stderr, "%s: %s\n", argv[argi],
+		    (unpacker.getError() != NULL) ? unpacker.getError()
+		    : strerror(errno));
+	    return 1;
+	}
+	FILE *out = (files == 2) ? fopen(argv[argi+1], "w") : stdout;
+	if (out == NULL) {
+	    perror(argv[argi+1]);
+	    return 1;
+	}
+	writeEdges(out, unpacker);
+	if (out != stdout && fclose(out) != 0) {
+	    perror(argv[argi+1]);
+	    return 1;
+	}
+	return 0;
+    }
+
+    if (files != 2)
+	return usage(argv[0]);
+    VoronoiFileReader reader;
+    if (!openFile(reader, argv[argi]))
+	return 1;
+    VoronoiPacker packer;
+    if (step > 0)
+	packer.setStep(step);
+    FILE *out = fopen(argv[argi+1], "wb");
+    if (out == NULL || !packer.pack(reader, out) || fclose(out) != 0) {
+	perror(argv[argi+1]);
+	return 1;
+    }
+    return 0;
+} // }}}
@@ -0,0 +1,529 @@
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "packer.h"
+
+using namespace std;
+
+/*
+ * The stream: "VORPACK\0", the byte order as a uint32 and the version,
+ * the counts of sites, vertices and edges as varints, and the step and
+ * the box as doubles.  Then
+ *
+ *  - the sites in their new order, as zigzag varint deltas of x and y
+ *    from the site before;
+ *  - the vertices in their new order, as points from the vertex before;
+ *  - the count of edges with a vertex, then those edges by their lowest
+ *    vertex v: the step of v from the edge before, the other vertex w as
+ *    (w - v + 1) * 2 + the end v is at, or 1 for none, site 0 as a
+ *    zigzag delta from site 0 of the edge before and site 1 as one from
+ *    site 0; for a ray, the point of its end at infinity from v;
+ *  - the edges without a vertex: their sites the same way, then end 0
+ *    from site 0 and end 1 from end 0.
+ *
+ * A point is zigzag(dx) * 2 and zigzag(dy) in multiples of the step from
+ * a reference point, or 1 and x and y as doubles.  The reference of a
+ * point kept as doubles is the origin.
+ */
+
+static const size_t BUFFER = 65536;
+static const uint64_t PACK_VERSION = 1;
+static const uint32_t PACK_BYTE_ORDER = 0x01020304;
+
+/* Quantised coordinates up to this, so that zigzag(delta) * 2 fits */
+static const double LIMIT = 1152921504606846976.0;	/* 2^60 */
+
+static inline uint64_t zigzag(int64_t value)
+{ // {{{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+} // }}}
+
+static inline int64_t unzigzag(uint64_t value)
+{ // {{{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+} // }}}
+
+/* false for what doesn't fit in multiples of step */
+static inline bool quantise(double x, double y, double step,
+	int64_t &qx, int64_t &qy)
+{ // {{{
+    double sx = x / step, sy = y / step;
+    if (!(fabs(sx) < LIMIT && fabs(sy) < LIMIT))
+	return false;
+    qx = llround(sx);
+    qy = llround(sy);
+    return true;
+} // }}}
+
+/* The distance along a Hilbert curve through a 65536 by 65536 grid */
+static unsigned int hilbertKey(unsigned int x, unsigned int y)
+{ // {{{
+    unsigned int key = 0;
+    for (unsigned int s=1<<15; s>0; s>>=1) {
+	unsigned int rx = (x & s) ? 1 : 0, ry = (y & s) ? 1 : 0;
+	key += s * s * ((3 * rx) ^ ry);
+	if (ry == 0) {
+	    if (rx == 1) {
+		x = 0xffff - x;
+		y = 0xffff - y;
+	    }
+	    swap(x, y);
+	}
+    }
+    return key;
+} // }}}
+
+/*
+ * The order of the points along the curve through their box, and the
+ * place of every point in it.  Points that are left out go last.
+ */
+static void curveOrder(const vector<int64_t> &x, const vector<int64_t> &y,
+	const vector<bool> &left, vector<int> &order, vector<int> &rank)
+{ // {{{
+    int count = (int)x.size();
+    double minX = 0, maxX = 0, minY = 0, maxY = 0;
+    bool empty = true;
+    for (int i=0; i<count; i++) {
+	if (left[i])
+	    continue;
+	if (empty) {
+	    minX = maxX = (double)x[i];
+	    minY = maxY = (double)y[i];
+	    empty = false;
+	}
+	minX = min(minX, (double)x[i]);		maxX = max(maxX, (double)x[i]);
+	minY = min(minY, (double)y[i]);		maxY = max(maxY, (double)y[i]);
+    }
+    double scale = 65535 / max(max(maxX - minX, maxY - minY), 1.0);
+
+    /* the key above the index, to sort plain numbers */
+    vector<uint64_t> keys;
+    keys.reserve(count);
+    for (int i=0; i<count; i++) {
+	if (!left[i])
+	    keys.push_back((uint64_t)hilbertKey(
+			(unsigned int)(((double)x[i] - minX) * scale),
+			(unsigned int)(((double)y[i] - minY) * scale)) << 32 | i);
+    }
+    sort(keys.begin(), keys.end());
+
+    order.clear();
+    order.reserve(count);
+    for (size_t k=0; k<keys.size(); k++)
+	order.push_back((int)(keys[k] & 0xffffffffu));
+    for (int i=0; i<count; i++) {
+	if (left[i])
+	    order.push_back(i);
+    }
+    rank.resize(count);
+    for (int k=0; k<count; k++)
+	rank[order[k]] = k;
+} // }}}
+
+/* Gathers bytes and writes them a buffer at a time */
+class PackOutput
+{
+    public:
+	PackOutput(FILE *out) : out(out), buffer(BUFFER), used(0), good(true)
+	{};
+	void varint(uint64_t value)
+	{
+	    if (used > BUFFER - 10)
+		flush();
+	    while (value >= 0x80) {
+		buffer[used++] = (unsigned char)(value | 0x80);
+		value >>= 7;
+	    }
+	    buffer[used++] = (unsigned char)value;
+	};
+	void raw(const void *data, size_t length)
+	{
+	    if (used + length > BUFFER)
+		flush();
+	    memcpy(&buffer[used], data, length);
+	    used += length;
+	};
+	void number(double value) { raw(&value, sizeof(value)); };
+	/* a point from (refX, refY), which moves to it if it is quantised */
+	void point(int64_t &refX, int64_t &refY, double x, double y,
+		double step)
+	{
+	    int64_t qx, qy;
+	    if (!quantise(x, y, step, qx, qy)) {
+		varint(1);
+		number(x);
+		number(y);
+		return;
+	    }
+	    varint(zigzag(qx - refX) << 1);
+	    varint(zigzag(qy - refY));
+	    refX = qx;
+	    refY = qy;
+	};
+	bool flush()
+	{
+	    if (used > 0 && fwrite(&buffer[0], 1, used, out) != used)
+		good = false;
+	    used = 0;
+	    return good;
+	};
+
+    private:
+	FILE *out;
+	vector<unsigned char> buffer;
+	size_t used;
+	bool good;
+};
+
+/* Reads a buffer at a time; past the end every read fails */
+class PackInput
+{
+    public:
+	PackInput(FILE *in) : in(in), buffer(BUFFER), next(0), end(0),
+	    good(true)
+	{};
+	bool isGood() const { return good; };
+	uint64_t varint()
+	{
+	    if (end - next < 10)
+		refill();
+	    uint64_t value = 0;
+	    for (int shift=0; shift<64; shift+=7) {
+		if (next == end)
+		    break;
+		unsigned char byte = buffer[next++];
+		value |= (uint64_t)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0)
+		    return value;
+	    }
+	    good = false;
+	    return 0;
+	};
+	void raw(void *data, size_t length)
+	{
+	    if (end - next < length)
+		refill();
+	    if (end - next < length) {
+		good = false;
+		memset(data, 0, length);
+		return;
+	    }
+	    memcpy(data, &buffer[next], length);
+	    next += length;
+	};
+	double number()
+	{
+	    double value;
+	    raw(&value, sizeof(value));
+	    return value;
+	};
+	/* the reverse of PackOutput::point(), false for doubles */
+	bool point(int64_t &refX, int64_t &refY, double &x, double &y,
+		double step)
+	{
+	    uint64_t code = varint();
+	    if (code == 1) {
+		x = number();
+		y = number();
+		return false;
+	    }
+	    refX += unzigzag(code >> 1);
+	    refY += unzigzag(varint());
+	    x = refX * step;
+	    y = refY * step;
+	    return true;
+	};
+
+    private:
+	void refill()
+	{
+	    if (next > 0) {
+		memmove(&buffer[0], &buffer[next], end - next);
+		end -= next;
+		next = 0;
+	    }
+	    end += fread(&buffer[end], 1, BUFFER - end, in);
+	};
+
+	FILE *in;
+	vector<unsigned char> buffer;
+	size_t next, end;
+	bool good;
+};
+
+VoronoiPacker::VoronoiPacker()
+    : step(1.0 / 1024)
+{ // {{{
+} // }}}
+
+bool VoronoiPacker::pack(const VoronoiFileReader &file, FILE *out)
+{ // {{{
+    const VoronoiFileHeader &header = file.getHeader();
+    const VoronoiFileSite *sites = file.getSites();
+    const VoronoiFileVertex *vertices = file.getVertices();
+    const VoronoiFileEdge *edges = file.getEdges();
+    int siteCount = header.siteCount, vertexCount = header.vertexCount;
+    int edgeCount = header.edgeCount;
+
+    /* the new numbers of the sites and the vertices */
+    vector<int> siteOrder, siteRank;
+    vector<int64_t> x(siteCount), y(siteCount);
+    for (int i=0; i<siteCount; i++) {
+	x[i] = sites[i].x;
+	y[i] = sites[i].y;
+    }
+    curveOrder(x, y, vector<bool>(siteCount, false), siteOrder, siteRank);
+
+    vector<int> vertexOrder, vertexRank;
+    vector<bool> kept(vertexCount, false);
+    x.resize(vertexCount);
+    y.resize(vertexCount);
+    for (int i=0; i<vertexCount; i++) {
+	kept[i] = !quantise(vertices[i].x, vertices[i].y, step, x[i], y[i]);
+	if (kept[i])
+	    x[i] = y[i] = 0;
+    }
+    curveOrder(x, y, kept, vertexOrder, vertexRank);
+
+    /*
+     * The edges with a vertex by their lowest one, then the others: the
+     * lowest vertices are counted and the edges dealt out behind them.
+     */
+    vector<int> lowOf(edgeCount), edgeOrder(edgeCount);
+    vector<int> start(vertexCount + 2, 0);
+    for (int i=0; i<edgeCount; i++) {
+	int low = vertexCount;
+	for (int end=0; end<2; end++) {
+	    if (edges[i].vertex[end] != VORONOI_FILE_NO_VERTEX)
+		low = min(low, vertexRank[edges[i].vertex[end]]);
+	}
+	lowOf[i] = low;
+	start[low+1]++;
+    }
+    for (int v=0; v<=vertexCount; v++)
+	start[v+1] += start[v];
+    int withVertex = start[vertexCount];
+    for (int i=0; i<edgeCount; i++)
+	edgeOrder[start[lowOf[i]]++] = i;
+
+    PackOutput output(out);
+    output.raw("VORPACK", 8);
+    output.raw(&PACK_BYTE_ORDER, sizeof(PACK_BYTE_ORDER));
+    output.varint(PACK_VERSION);
+    output.varint(siteCount);
+    output.varint(vertexCount);
+    output.varint(edgeCount);
+    output.number(step);
+    output.number(header.minX);
+    output.number(header.minY);
+    output.number(header.maxX);
+    output.number(header.maxY);
+
+    int64_t lastX = 0, lastY = 0;
+    for (int k=0; k<siteCount; k++) {
+	const VoronoiFileSite &site = sites[siteOrder[k]];
+	output.varint(zigzag(site.x - lastX));
+	output.varint(zigzag(site.y - lastY));
+	lastX = site.x;
+	lastY = site.y;
+    }
+    lastX = lastY = 0;
+    for (int k=0; k<vertexCount; k++) {
+	const VoronoiFileVertex &vertex = vertices[vertexOrder[k]];
+	output.point(lastX, lastY, vertex.x, vertex.y, step);
+    }
+
+    output.varint(withVertex);
+    int64_t lastSite = 0;
+    int lastLow = 0;
+    for (int k=0; k<edgeCount; k++) {
+	const VoronoiFileEdge &edge = edges[edgeOrder[k]];
+	int64_t site0 = siteRank[edge.site[0]];
+	int64_t site1 = siteRank[edge.site[1]];
+	if (k < withVertex) {
+	    int low = lowOf[edgeOrder[k]];
+	    int lowEnd = (edge.vertex[0] != VORONOI_FILE_NO_VERTEX &&
+		    vertexRank[edge.vertex[0]] == low) ? 0 : 1;
+	    int other = edge.vertex[1 - lowEnd];
+	    uint64_t code = (other == VORONOI_FILE_NO_VERTEX) ? 0 :
+		(uint64_t)(vertexRank[other] - low) + 1;
+	    output.varint(low - lastLow);
+	    output.varint(code << 1 | lowEnd);
+	    output.varint(zigzag(site0 - lastSite));
+	    output.varint(zigzag(site1 - site0));
+	    if (other == VORONOI_FILE_NO_VERTEX) {
+		int64_t refX = x[vertexOrder[low]], refY = y[vertexOrder[low]];
+		output.point(refX, refY, edge.x[1 - lowEnd],
+			edge.y[1 - lowEnd], step);
+	    }
+	    lastLow = low;
+	} else {
+	    output.varint(zigzag(site0 - lastSite));
+	    output.varint(zigzag(site1 - site0));
+	    int64_t refX, refY;
+	    const VoronoiFileSite &site = sites[edge.site[0]];
+	    if (!quantise(site.x, site.y, step, refX, refY))
+		refX = refY = 0;
+	    output.point(refX, refY, edge.x[0], edge.y[0], step);
+	    output.point(refX, refY, edge.x[1], edge.y[1], step);
+	}
+	lastSite = site0;
+    }
+    return output.flush();
+} // }}}
+
+VoronoiUnpacker::VoronoiUnpacker()
+    : step(1), minX(0), minY(0), maxX(0), maxY(0), error(NULL)
+{ // {{{
+} // }}}
+
+bool VoronoiUnpacker::fail(const char *message)
+{ // {{{
+    error = message;
+    return false;
+} // }}}
+
+bool VoronoiUnpacker::unpack(FILE *in)
+{ // {{{
+    sites.clear();
+    vertices.clear();
+    edges.clear();
+    error = NULL;
+
+    PackInput input(in);
+    char magic[8];
+    uint32_t byteOrder;
+    input.raw(magic, sizeof(magic));
+    input.raw(&byteOrder, sizeof(byteOrder));
+    if (!input.isGood())
+	return ferror(in) ? false : fail("truncated");
+    if (memcmp(magic, "VORPACK", 8) != 0)
+	return fail("not a packed diagram");
+    if (byteOrder != PACK_BYTE_ORDER)
+	return fail("written with the other byte order");
+    if (input.varint() != PACK_VERSION)
+	return fail("of an unknown version");
+    uint64_t siteCount = input.varint(), vertexCount = input.varint();
+    uint64_t edgeCount = input.varint();
+    step = input.number();
+    minX = input.number();
+    minY = input.number();
+    maxX = input.number();
+    maxY = input.number();
+    if (!input.isGood())
+	return ferror(in) ? false : fail("truncated");
+    if (siteCount > 0x7fffffff || vertexCount > 0x7fffffff ||
+	    edgeCount > 0x7fffffff)
+	return fail("too large");
+    if (!(step > 0) || isinf(step))
+	return fail("with a bad step");
+
+    /* grown as the stream proves to hold them */
+    static const uint64_t RESERVE = 1 << 20;
+    sites.reserve(min(siteCount, RESERVE));
+    vertices.reserve(min(vertexCount, RESERVE));
+    edges.reserve(min(edgeCount, RESERVE));
+
+    int64_t lastX = 0, lastY = 0;
+    for (uint64_t k=0; k<siteCount && input.isGood(); k++) {
+	lastX += unzigzag(input.varint());
+	lastY += unzigzag(input.varint());
+	VoronoiFileSite site;
+	site.x = (int32_t)lastX;
+	site.y = (int32_t)lastY;
+	sites.push_back(site);
+    }
+    vector<int64_t> qx, qy;
+    qx.reserve(vertices.capacity());
+    qy.reserve(vertices.capacity());
+    lastX = lastY = 0;
+    for (uint64_t k=0; k<vertexCount && input.isGood(); k++) {
+	VoronoiFileVertex vertex;
+	bool quantised = input.point(lastX, lastY, vertex.x, vertex.y, step);
+	qx.push_back(quantised ? lastX : 0);
+	qy.push_back(quantised ? lastY : 0);
+	vertices.push_back(vertex);
+    }
+
+    uint64_t withVertex = input.varint();
+    if (input.isGood() && withVertex > edgeCount)
+	return fail("with more edges than it has");
+    int64_t lastSite = 0, low = 0;
+    for (uint64_t k=0; k<edgeCount && input.isGood(); k++) {
+	VoronoiFileEdge edge;
+	memset(&edge, 0, sizeof(edge));
+	if (k < withVertex) {
+	    low += input.varint();
+	    uint64_t code = input.varint();
+	    int lowEnd = (int)(code & 1);
+	    code >>= 1;
+	    int64_t site0 = lastSite + unzigzag(input.varint());
+	    int64_t site1 = site0 + unzigzag(input.varint());
+	    if (!input.isGood())
+		break;
+	    if (low < 0 || (uint64_t)low >= vertexCount ||
+		    (code > 0 && code - 1 >= vertexCount - low))
+		return fail("an edge with a vertex out of range");
+	    if (site0 < 0 || (uint64_t)site0 >= siteCount ||
+		    site1 < 0 || (uint64_t)site1 >= siteCount)
+		return fail("an edge with a site out of range");
+	    edge.site[0] = (int32_t)site0;
+	    edge.site[1] = (int32_t)site1;
+	    edge.vertex[lowEnd] = (int32_t)low;
+	    edge.x[lowEnd] = vertices[low].x;
+	    edge.y[lowEnd] = vertices[low].y;
+	    int otherEnd = 1 - lowEnd;
+	    if (code > 0) {
+		int other = (int)(low + code - 1);
+		edge.vertex[otherEnd] = other;
+		edge.x[otherEnd] = vertices[other].x;
+		edge.y[otherEnd] = vertices[other].y;
+	    } else {
+		int64_t refX = qx[low], refY = qy[low];
+		edge.vertex[otherEnd] = VORONOI_FILE_NO_VERTEX;
+		edge.flags = VORONOI_FILE_END0_INF << otherEnd;
+		input.point(refX, refY, edge.x[otherEnd], edge.y[otherEnd],
+			step);
+	    }
+	    lastSite = site0;
+	} else {
+	    int64_t site0 = lastSite + unzigzag(input.varint());
+	    int64_t site1 = site0 + unzigzag(input.varint());
+	    if (!input.isGood())
+		break;
+	    if (site0 < 0 || (uint64_t)site0 >= siteCount ||
+		    site1 < 0 || (uint64_t)site1 >= siteCount)
+		return fail("an edge with a site out of range");
+	    edge.site[0] = (int32_t)site0;
+	    edge.site[1] = (int32_t)site1;
+	    edge.vertex[0] = edge.vertex[1] = VORONOI_FILE_NO_VERTEX;
+	    edge.flags = VORONOI_FILE_END0_INF | VORONOI_FILE_END1_INF;
+	    int64_t refX, refY;
+	    if (!quantise(sites[site0].x, sites[site0].y, step, refX, refY))
+		refX = refY = 0;
+	    input.point(refX, refY, edge.x[0], edge.y[0], step);
+	    input.point(refX, refY, edge.x[1], edge.y[1], step);
+	    lastSite = site0;
+	}
+	edges.push_back(edge);
+    }
+    if (!input.isGood())
+	return ferror(in) ? false : fail("truncated");
+    return true;
+} // }}}
+
+void VoronoiUnpacker::lineOf(int edge, double &a, double &b, double &c) const
+{ // {{{
+    const VoronoiFileSite &left = sites[edges[edge].site[0]];
+    const VoronoiFileSite &right = sites[edges[edge].site[1]];
+    double la = (double)left.y - right.y;
+    double lb = (double)right.x - left.x;
+    double middleX = ((double)left.x + right.x) / 2;
+    double middleY = ((double)left.y + right.y) / 2;
+    a = lb;
+    b = -la;
+    c = lb * middleX - la * middleY;
+} // }}}
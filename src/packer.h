@@ -0,0 +1,68 @@
+#ifndef PACKER_H
+#define PACKER_H
+
+#include <stdio.h>
+
+#include <vector>
+
+#include "diagfile.h"
+
+/*
+ * A compact encoding of a diagram file, for archives and transfers.
+ *
+ * The sites and the vertices are renumbered along a Hilbert curve and
+ * written as varint deltas, so neighbors in space cost a few bytes.
+ * Vertex coordinates, and the ends of rays, are rounded to multiples of
+ * a step first; the rare ones too large for that are kept as doubles.
+ * Edges are ordered by their lowest vertex and refer to vertices and
+ * sites by varint differences.  Nothing that follows from the rest is
+ * stored: not the ends of finite edges, which are their vertices, nor
+ * the infinity flags, nor the coefficients of the bisectors.
+ *
+ * Both sides work through a buffer on a stream, front to back.  The
+ * decoded diagram has the new numbering and no adjacency.
+ */
+class VoronoiPacker
+{
+    public:
+	VoronoiPacker();
+	/* vertices move by at most half of it */
+	void setStep(double newStep) { step = newStep; };
+	/* false if writing failed (see errno) */
+	bool pack(const VoronoiFileReader &file, FILE *out);
+
+    private:
+	double step;
+};
+
+class VoronoiUnpacker
+{
+    public:
+	VoronoiUnpacker();
+	/* false if the stream can't be read or getError() */
+	bool unpack(FILE *in);
+	const char * getError() const { return error; };
+
+	double getStep() const { return step; };
+	double getMinX() const { return minX; };
+	double getMinY() const { return minY; };
+	double getMaxX() const { return maxX; };
+	double getMaxY() const { return maxY; };
+	const std::vector<VoronoiFileSite> & getSites() const { return sites; };
+	const std::vector<VoronoiFileVertex> & getVertices() const
+	{ return vertices; };
+	const std::vector<VoronoiFileEdge> & getEdges() const { return edges; };
+	/* ax+by=c of the bisector, as VoronoiDiagram::addEdge() has it */
+	void lineOf(int edge, double &a, double &b, double &c) const;
+
+    private:
+	bool fail(const char *message);
+
+	double step, minX, minY, maxX, maxY;
+	std::vector<VoronoiFileSite> sites;
+	std::vector<VoronoiFileVertex> vertices;
+	std::vector<VoronoiFileEdge> edges;
+	const char *error;
+};
+
+#endif
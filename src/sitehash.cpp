@@ -0,0 +1,120 @@
+#include <stdlib.h>
+
+#include "sitehash.h"
+
+using namespace std;
+
+SiteHash::SiteHash(int cellSize)
+    : cellSize(cellSize > 0 ? cellSize : 1), count(0)
+{ // {{{
+    heads.assign(16, NONE);
+} // }}}
+
+void SiteHash::clear()
+{ // {{{
+    count = 0;
+    pointX.clear();	pointY.clear();
+    next.clear();	used.clear();
+    heads.assign(16, NONE);
+} // }}}
+
+int SiteHash::cellOf(int coord) const
+{ // {{{
+    /* rounded down, also below zero */
+    return (coord >= 0) ? coord / cellSize : -((-coord - 1) / cellSize) - 1;
+} // }}}
+
+unsigned int SiteHash::bucketOf(int cellX, int cellY) const
+{ // {{{
+    unsigned int hash = (unsigned int)cellX * 73856093u ^
+	(unsigned int)cellY * 19349663u;
+    return hash & (unsigned int)(heads.size() - 1);
+} // }}}
+
+void SiteHash::rehash(unsigned int buckets)
+{ // {{{
+    heads.assign(buckets, NONE);
+    for (unsigned int id=0; id<used.size(); id++) {
+	if (!used[id])
+	    continue;
+	unsigned int bucket = bucketOf(cellOf(pointX[id]), cellOf(pointY[id]));
+	next[id] = heads[bucket];
+	heads[bucket] = id;
+    }
+} // }}}
+
+void SiteHash::insert(int id, int x, int y)
+{ // {{{
+    if (id >= (int)used.size()) {
+	pointX.resize(id + 1);	pointY.resize(id + 1);
+	next.resize(id + 1, NONE);
+	used.resize(id + 1, false);
+    }
+    if (used[id])
+	erase(id);
+
+    pointX[id] = x;
+    pointY[id] = y;
+    used[id] = true;
+    count++;
+    if (count > (int)heads.size()) {
+	rehash(heads.size() * 2);
+	return;
+    }
+    unsigned int bucket = bucketOf(cellOf(x), cellOf(y));
+    next[id] = heads[bucket];
+    heads[bucket] = id;
+} // }}}
+
+void SiteHash::erase(int id)
+{ // {{{
+    if (id < 0 || id >= (int)used.size() || !used[id])
+	return;
+
+    unsigned int bucket = bucketOf(cellOf(pointX[id]), cellOf(pointY[id]));
+    int *link = &heads[bucket];
+    while (*link != id)
+	link = &next[*link];
+    *link = next[id];
+    used[id] = false;
+    count--;
+} // }}}
+
+void SiteHash::move(int id, int x, int y)
+{ // {{{
+    erase(id);
+    insert(id, x, y);
+} // }}}
+
+int SiteHash::find(int x, int y) const
+{ // {{{
+    unsigned int bucket = bucketOf(cellOf(x), cellOf(y));
+    for (int id=heads[bucket]; id!=NONE; id=next[id]) {
+	if (pointX[id] == x && pointY[id] == y)
+	    return id;
+    }
+    return NONE;
+} // }}}
+
+int SiteHash::findNear(int x, int y, int radius) const
+{ // {{{
+    int best = NONE;
+    long bestDistance = 0;
+    for (int cellY=cellOf(y - radius); cellY<=cellOf(y + radius); cellY++) {
+	for (int cellX=cellOf(x - radius); cellX<=cellOf(x + radius);
+		cellX++) {
+	    unsigned int bucket = bucketOf(cellX, cellY);
+	    for (int id=heads[bucket]; id!=NONE; id=next[id]) {
+		long dx = (long)pointX[id] - x, dy = (long)pointY[id] - y;
+		if (labs(dx) > radius || labs(dy) > radius)
+		    continue;
+		/* other cells share the bucket; the test above skips them */
+		if (best == NONE || dx * dx + dy * dy < bestDistance) {
+		    best = id;
+		    bestDistance = dx * dx + dy * dy;
+		}
+	    }
+	}
+    }
+    return best;
+} // }}}
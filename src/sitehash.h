@@ -0,0 +1,43 @@
+#ifndef SITEHASH_H
+#define SITEHASH_H
+
+#include <vector>
+
+/*
+ * Integer points by id, hashed on a grid of square cells, for finding a
+ * point at or near a position without looking at all of them.  Ids are
+ * small integers chosen by the caller, as the indices of an array.
+ *
+ * Looking near a position reads the cells within the radius, so the
+ * cells should be about as large as the radius asked for.
+ */
+class SiteHash
+{
+    public:
+	enum { NONE = -1 };
+
+	SiteHash(int cellSize);
+	void clear();
+	void insert(int id, int x, int y);
+	void erase(int id);
+	void move(int id, int x, int y);
+	/* the point at (x, y), or NONE */
+	int find(int x, int y) const;
+	/* the nearest point at most radius away along both axes, or NONE */
+	int findNear(int x, int y, int radius) const;
+	int size() const { return count; };
+
+    private:
+	int cellOf(int coord) const;
+	unsigned int bucketOf(int cellX, int cellY) const;
+	void rehash(unsigned int buckets);
+
+	int cellSize;
+	int count;
+	std::vector<int> pointX, pointY;
+	std::vector<int> next;		/* in the bucket; NONE at the end */
+	std::vector<bool> used;
+	std::vector<int> heads;		/* a power of two of them */
+};
+
+#endif
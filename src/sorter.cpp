@@ -0,0 +1,162 @@
+#include <algorithm>
+
+#include "sorter.h"
+#include "taskpool.h"
+
+using namespace std;
+
+/* Keys a chunk takes at least; smaller ones aren't worth a task */
+static const int MIN_CHUNK = 65536;
+
+/* One phase of a pass over one chunk */
+class RadixTask : public VoronoiTask
+{
+    public:
+	RadixTask(SiteSorter &sorter, SiteSorter::Phase phase, int chunk,
+		int shift)
+	    : sorter(sorter), phase(phase), chunk(chunk), shift(shift) {};
+	void run(int) { sorter.runChunk(phase, chunk, shift); };
+
+    private:
+	SiteSorter &sorter;
+	SiteSorter::Phase phase;
+	int chunk, shift;
+};
+
+/* Spawns the chunks of a phase and waits for them */
+class PhaseTask : public VoronoiTask
+{
+    public:
+	PhaseTask(TaskPool &pool, std::vector<RadixTask> &chunks)
+	    : pool(pool), chunks(chunks) {};
+	void run(int worker)
+	{
+	    for (unsigned int i=0; i<chunks.size(); i++)
+		pool.spawn(worker, &chunks[i]);
+	    for (unsigned int j=0; j<chunks.size(); j++)
+		pool.join(worker, &chunks[j]);
+	};
+
+    private:
+	TaskPool &pool;
+	std::vector<RadixTask> &chunks;
+};
+
+SiteSorter::SiteSorter()
+    : threads(1), pool(NULL), pointX(NULL), pointY(NULL), count(0),
+    chunkSize(1), chunkCount(0), firstKey(0)
+{ // {{{
+} // }}}
+
+SiteSorter::~SiteSorter()
+{ // {{{
+    delete pool;
+} // }}}
+
+void SiteSorter::setThreads(int count)
+{ // {{{
+    int wanted = (count < 1) ? TaskPool::processorCount() : count;
+    if (wanted != threads) {
+	delete pool;
+	pool = NULL;
+    }
+    threads = wanted;
+} // }}}
+
+void SiteSorter::sort(const int *x, const int *y, int count,
+	vector<int> &order)
+{ // {{{
+    order.clear();
+    if (count <= 0)
+	return;
+
+    pointX = x;
+    pointY = y;
+    this->count = count;
+    chunkSize = max(MIN_CHUNK, count / (threads * 4) + 1);
+    chunkCount = (count + chunkSize - 1) / chunkSize;
+    keys.resize(count);		ids.resize(count);
+    spareKeys.resize(count);	spareIds.resize(count);
+    varying.assign(chunkCount, 0);
+    counts.assign(chunkCount * BUCKETS, 0);
+
+    /* the sign bits flipped, so that the keys compare as unsigned */
+    firstKey = (Key)((unsigned int)x[0] ^ 0x80000000u) << 32 |
+	((unsigned int)y[0] ^ 0x80000000u);
+    runPhase(MAKE_KEYS, 0);
+    Key differ = 0;
+    for (int c=0; c<chunkCount; c++)
+	differ |= varying[c];
+
+    for (int shift=0; shift<KEY_BITS; shift+=DIGIT_BITS) {
+	if (((differ >> shift) & (BUCKETS - 1)) == 0)
+	    continue;		/* the same byte in every key */
+	runPhase(COUNT, shift);
+
+	/* where every chunk starts to put the keys with every byte */
+	int position = 0;
+	for (int bucket=0; bucket<BUCKETS; bucket++) {
+	    for (int chunk=0; chunk<chunkCount; chunk++) {
+		int keysIn = counts[chunk * BUCKETS + bucket];
+		counts[chunk * BUCKETS + bucket] = position;
+		position += keysIn;
+	    }
+	}
+	runPhase(SCATTER, shift);
+	keys.swap(spareKeys);
+	ids.swap(spareIds);
+    }
+
+    /* equal points are next to each other now */
+    order.reserve(count);
+    for (int i=0; i<count; i++) {
+	if (i == 0 || keys[i] != keys[i-1])
+	    order.push_back(ids[i]);
+    }
+} // }}}
+
+void SiteSorter::runPhase(Phase phase, int shift)
+{ // {{{
+    if (threads == 1 || chunkCount == 1) {
+	for (int chunk=0; chunk<chunkCount; chunk++)
+	    runChunk(phase, chunk, shift);
+	return;
+    }
+
+    if (pool == NULL)
+	pool = new TaskPool(threads);
+    vector<RadixTask> chunks;
+    for (int chunk=0; chunk<chunkCount; chunk++)
+	chunks.push_back(RadixTask(*this, phase, chunk, shift));
+    PhaseTask batch(*pool, chunks);
+    pool->execute(batch);
+} // }}}
+
+void SiteSorter::runChunk(Phase phase, int chunk, int shift)
+{ // {{{
+    int begin = chunk * chunkSize, end = min(begin + chunkSize, count);
+    int *bucketCount = &counts[chunk * BUCKETS];
+
+    if (phase == MAKE_KEYS) {
+	Key differ = 0;
+	for (int i=begin; i<end; i++) {
+	    Key key = (Key)((unsigned int)pointX[i] ^ 0x80000000u) << 32 |
+		((unsigned int)pointY[i] ^ 0x80000000u);
+	    keys[i] = key;
+	    ids[i] = i;
+	    differ |= key ^ firstKey;
+	}
+	varying[chunk] = differ;
+    } else if (phase == COUNT) {
+	fill(bucketCount, bucketCount + BUCKETS, 0);
+	for (int i=begin; i<end; i++)
+	    bucketCount[(keys[i] >> shift) & (BUCKETS - 1)]++;
+    } else {
+	/* counts holds the first slot of every byte by now */
+	for (int i=begin; i<end; i++) {
+	    int slot = bucketCount[(keys[i] >> shift) & (BUCKETS - 1)]++;
+	    spareKeys[slot] = keys[i];
+	    spareIds[slot] = ids[i];
+	}
+    }
+} // }}}
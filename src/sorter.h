@@ -0,0 +1,49 @@
+#ifndef SORTER_H
+#define SORTER_H
+
+#include <vector>
+
+class TaskPool;
+
+/*
+ * Orders integer points by (x, y) without comparing them: every point
+ * becomes one 64-bit key, x in the high half and y in the low one, and
+ * an LSD radix sort goes over the keys a byte at a time.  Bytes that all
+ * the keys share are skipped, so small coordinates take few passes.
+ *
+ * Every pass counts and then scatters the keys in chunks on a TaskPool;
+ * the chunks keep their order, so points that are equal stay in the
+ * order they came in and the first of them is the one kept.
+ */
+class SiteSorter
+{
+    public:
+	SiteSorter();
+	~SiteSorter();
+	/* 1 runs serially, 0 takes every processor */
+	void setThreads(int count);
+	/* order gets the indices of the points by (x, y), less duplicates */
+	void sort(const int *x, const int *y, int count,
+		std::vector<int> &order);
+
+    private:
+	friend class RadixTask;
+	typedef unsigned long long Key;
+	enum { DIGIT_BITS = 8, BUCKETS = 1 << DIGIT_BITS, KEY_BITS = 64 };
+	enum Phase { MAKE_KEYS, COUNT, SCATTER };
+
+	void runPhase(Phase phase, int shift);
+	void runChunk(Phase phase, int chunk, int shift);
+
+	int threads;
+	TaskPool *pool;
+	const int *pointX, *pointY;
+	int count, chunkSize, chunkCount;
+	Key firstKey;
+	std::vector<Key> keys, spareKeys;
+	std::vector<int> ids, spareIds;
+	std::vector<Key> varying;	/* the bits of a chunk not all alike */
+	std::vector<int> counts;	/* BUCKETS of them for every chunk */
+};
+
+#endif
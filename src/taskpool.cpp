@@ -0,0 +1,160 @@
+#include <unistd.h>
+#include <sched.h>
+
+#include "taskpool.h"
+
+using namespace std;
+
+TaskPool::TaskPool(int threads)
+    : active(false), quit(false), busy(0)
+{ // {{{
+    pthread_mutex_init(&stateLock, NULL);
+    pthread_cond_init(&stateChanged, NULL);
+
+    if (threads < 1)
+	threads = 1;
+    for (int i=0; i<threads; i++) {
+	Worker *worker = new Worker;
+	worker->pool = this;
+	worker->id = i;
+	worker->victim = i + 1;
+	workers.push_back(worker);
+    }
+    /* worker 0 is whoever calls execute() */
+    for (unsigned int j=1; j<workers.size(); j++)
+	pthread_create(&workers[j]->thread, NULL, workerMain, workers[j]);
+} // }}}
+
+TaskPool::~TaskPool()
+{ // {{{
+    pthread_mutex_lock(&stateLock);
+    quit = true;
+    pthread_cond_broadcast(&stateChanged);
+    pthread_mutex_unlock(&stateLock);
+
+    for (unsigned int i=1; i<workers.size(); i++)
+	pthread_join(workers[i]->thread, NULL);
+    for (unsigned int j=0; j<workers.size(); j++)
+	delete workers[j];
+
+    pthread_cond_destroy(&stateChanged);
+    pthread_mutex_destroy(&stateLock);
+} // }}}
+
+int TaskPool::processorCount()
+{ // {{{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count < 1) ? 1 : (int)count;
+} // }}}
+
+void TaskPool::execute(VoronoiTask &root)
+{ // {{{
+    pthread_mutex_lock(&stateLock);
+    active = true;
+    pthread_cond_broadcast(&stateChanged);
+    pthread_mutex_unlock(&stateLock);
+
+    /* root joins everything it spawns, nothing is queued after it */
+    root.run(0);
+
+    pthread_mutex_lock(&stateLock);
+    active = false;
+    while (busy > 0)
+	pthread_cond_wait(&stateChanged, &stateLock);
+    pthread_mutex_unlock(&stateLock);
+} // }}}
+
+void TaskPool::spawn(int worker, VoronoiTask *task)
+{ // {{{
+    Worker *self = workers[worker];
+    self->lock.lock();
+    self->tasks.push_back(task);
+    self->lock.unlock();
+} // }}}
+
+void TaskPool::join(int worker, VoronoiTask *task)
+{ // {{{
+    while (!isDone(task)) {
+	if (!runOne(worker))
+	    sched_yield();
+    }
+} // }}}
+
+bool TaskPool::isDone(VoronoiTask *task)
+{ // {{{
+    doneLock.lock();
+    bool done = task->done;
+    doneLock.unlock();
+    return done;
+} // }}}
+
+bool TaskPool::runOne(int worker)
+{ // {{{
+    Worker *self = workers[worker];
+    VoronoiTask *task = NULL;
+
+    /* the newest task of our own first */
+    self->lock.lock();
+    if (!self->tasks.empty()) {
+	task = self->tasks.back();
+	self->tasks.pop_back();
+    }
+    self->lock.unlock();
+
+    /* then the oldest one of somebody else */
+    for (unsigned int i=0; task == NULL && i+1<workers.size(); i++) {
+	Worker *victim = workers[(self->victim + i) % workers.size()];
+	if (victim == self)
+	    continue;
+	victim->lock.lock();
+	if (!victim->tasks.empty()) {
+	    task = victim->tasks.front();
+	    victim->tasks.pop_front();
+	    self->victim = victim->id;
+	}
+	victim->lock.unlock();
+    }
+
+    if (task == NULL)
+	return false;
+
+    task->run(worker);
+    doneLock.lock();
+    task->done = true;
+    doneLock.unlock();
+    return true;
+} // }}}
+
+void *TaskPool::workerMain(void *arg)
+{ // {{{
+    Worker *self = (Worker *)arg;
+    TaskPool *pool = self->pool;
+
+    pthread_mutex_lock(&pool->stateLock);
+    for (;;) {
+	while (!pool->active && !pool->quit)
+	    pthread_cond_wait(&pool->stateChanged, &pool->stateLock);
+	if (pool->quit)
+	    break;
+	pool->busy++;
+	pthread_mutex_unlock(&pool->stateLock);
+
+	/* steal until execute() is done */
+	bool stop = false;
+	while (!stop) {
+	    if (pool->runOne(self->id))
+		continue;
+	    pthread_mutex_lock(&pool->stateLock);
+	    stop = !pool->active;
+	    pthread_mutex_unlock(&pool->stateLock);
+	    if (!stop)
+		sched_yield();
+	}
+
+	pthread_mutex_lock(&pool->stateLock);
+	pool->busy--;
+	pthread_cond_broadcast(&pool->stateChanged);
+    }
+    pthread_mutex_unlock(&pool->stateLock);
+    return NULL;
+} // }}}
@@ -0,0 +1,83 @@
+#ifndef TASKPOOL_H
+#define TASKPOOL_H
+
+#include <pthread.h>
+#include <deque>
+#include <vector>
+
+class VoronoiMutex
+{
+    public:
+	VoronoiMutex() { pthread_mutex_init(&mutex, NULL); };
+	~VoronoiMutex() { pthread_mutex_destroy(&mutex); };
+	void lock() { pthread_mutex_lock(&mutex); };
+	void unlock() { pthread_mutex_unlock(&mutex); };
+
+    private:
+	VoronoiMutex(const VoronoiMutex &);
+	VoronoiMutex & operator=(const VoronoiMutex &);
+
+	pthread_mutex_t mutex;
+};
+
+/* A piece of work for TaskPool; it is owned by whoever spawned it */
+class VoronoiTask
+{
+    public:
+	VoronoiTask() : done(false) {};
+	virtual ~VoronoiTask() {};
+	virtual void run(int worker) = 0;
+
+    private:
+	friend class TaskPool;
+	bool done;		/* guarded by TaskPool::doneLock */
+};
+
+/*
+ * Fork-join pool with one task deque per worker.  A worker takes its own
+ * newest task first and steals the oldest task of another worker when it
+ * runs dry, so a divide-and-conquer run hands out big halves first.
+ *
+ * The thread calling execute() is worker 0; join() keeps the waiting
+ * worker busy with other tasks instead of blocking it.
+ */
+class TaskPool
+{
+    public:
+	TaskPool(int threads);
+	~TaskPool();
+	int getThreads() const { return (int)workers.size(); };
+	void execute(VoronoiTask &root);
+	void spawn(int worker, VoronoiTask *task);
+	void join(int worker, VoronoiTask *task);
+
+	static int processorCount();
+
+    private:
+	TaskPool(const TaskPool &);
+	TaskPool & operator=(const TaskPool &);
+
+	struct Worker {
+	    TaskPool *pool;
+	    int id;
+	    pthread_t thread;
+	    VoronoiMutex lock;
+	    std::deque<VoronoiTask *> tasks;
+	    unsigned int victim;	/* where the next steal starts */
+	};
+
+	static void *workerMain(void *arg);
+	bool runOne(int worker);
+	bool isDone(VoronoiTask *task);
+
+	std::vector<Worker *> workers;
+	VoronoiMutex doneLock;
+
+	/* wakes the helpers for execute() and tells it when they are idle */
+	pthread_mutex_t stateLock;
+	pthread_cond_t stateChanged;
+	bool active, quit;
+	int busy;
+};
+
+#endif
@@ -0,0 +1,63 @@
+#!/bin/sh
+#
+# Regression checks on the inputs next to this script: grids, lines and
+# cocircular sites near the ends of the 32-bit range, duplicates, and a
+# few tiny sets.
+#
+# Every input has to go through voronoi-cli on one and four threads (the
+# same edges in the same order at the same cutoff) and with -f without a
+# word on stderr, its diagram files for both engines have to pass
+# voronoi-validate, and voronoi-check has to find the engines and the
+# editor in agreement with each other and with brute force.
+#
+#	check.sh [bindir]
+#
+# The programs are taken from bindir, the parent of tests/ by default.
+
+dir=`dirname "$0"`
+bin=${1:-$dir/..}
+tmp=`mktemp -d` || exit 2
+trap 'rm -rf "$tmp"' 0
+
+failed=0
+fail()
+{
+    echo "$input: $*" >&2
+    failed=1
+}
+
+# runs voronoi-cli with the options, and requires it to be quiet about it
+cli()
+{
+    "$bin/voronoi-cli" "$@" 2> "$tmp/err"
+    status=$?
+    if [ $status -ne 0 ] || [ -s "$tmp/err" ]; then
+	fail "voronoi-cli $* exited with $status:" `head -1 "$tmp/err"`
+	return 1
+    fi
+    return 0
+}
+
+for input in "$dir"/*.txt; do
+    cli -j 1 -c 16 "$input" "$tmp/one.txt" &&
+	cli -j 4 -c 16 "$input" "$tmp/four.txt" &&
+	{ cmp -s "$tmp/one.txt" "$tmp/four.txt" ||
+	    fail "other edges on four threads than on one"; }
+    cli -j 1 "$input" "$tmp/serial.txt"
+    cli -f "$input" "$tmp/sweep.txt"
+
+    cli -m -a "$input" "$tmp/serial.vd" &&
+	cli -j 4 -m -a "$input" "$tmp/parallel.vd" &&
+	cli -f -m -a "$input" "$tmp/sweep.vd" &&
+	{ "$bin/voronoi-validate" -q "$tmp/serial.vd" "$tmp/parallel.vd" \
+		"$tmp/sweep.vd" || fail "voronoi-validate failed"; }
+done
+
+"$bin/voronoi-check" "$dir"/*.txt > /dev/null || failed=1
+
+if [ $failed -ne 0 ]; then
+    echo "FAILED" >&2
+    exit 1
+fi
+echo "all passed"
+exit 0
@@ -0,0 +1,119 @@
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "diagfile.h"
+
+using namespace std;
+
+/*
+ * voronoi-validate: checks diagram files (see diagfile.h) as a reader
+ * would find them.
+ *
+ * Beyond VoronoiFileReader::validate(), every vertex and every end of an
+ * edge has to be finite, and every vertex the end of an edge and equally
+ * far from the two sites of every edge ending at it, up to the rounding
+ * of its coordinates.  One line per file tells
+ * what is in it and whether it passed; with -q only the failures.
+ *
+ *	voronoi-validate [-q] file...
+ */
+
+/* Relative to the magnitude of the coordinates */
+static const double TOLERANCE = 1e-9;
+
+/* Neither infinite nor NaN, without C99 */
+static bool isFinite(double value)
+{ // {{{
+    return value - value == 0;
+} // }}}
+
+static const char *checkGeometry(const VoronoiFileReader &reader)
+{ // {{{
+    const VoronoiFileHeader &header = reader.getHeader();
+    const VoronoiFileSite *sites = reader.getSites();
+    const VoronoiFileVertex *vertices = reader.getVertices();
+    const VoronoiFileEdge *edges = reader.getEdges();
+
+    for (int j=0; j<header.vertexCount; j++) {
+	if (!isFinite(vertices[j].x) || !isFinite(vertices[j].y))
+	    return "a vertex not at finite coordinates";
+    }
+
+    vector<bool> used(header.vertexCount, false);
+    for (int i=0; i<header.edgeCount; i++) {
+	const VoronoiFileEdge &edge = edges[i];
+	for (int end=0; end<2; end++) {
+	    if (!isFinite(edge.x[end]) || !isFinite(edge.y[end]))
+		return "an edge end not at finite coordinates";
+	    int vertex = edge.vertex[end];
+	    if (vertex == VORONOI_FILE_NO_VERTEX)
+		continue;
+	    used[vertex] = true;
+	    double x = vertices[vertex].x, y = vertices[vertex].y;
+	    if (edge.x[end] != x || edge.y[end] != y)
+		return "an edge whose end isn't at its vertex";
+
+	    const VoronoiFileSite &a = sites[edge.site[0]];
+	    const VoronoiFileSite &b = sites[edge.site[1]];
+	    double scale = max(max(fabs(x), fabs(y)), 1.0);
+	    scale = max(scale, max(fabs((double)a.x), fabs((double)a.y)));
+	    scale = max(scale, max(fabs((double)b.x), fabs((double)b.y)));
+	    double toA = hypot(x - a.x, y - a.y), toB = hypot(x - b.x, y - b.y);
+	    if (!(fabs(toA - toB) <= TOLERANCE * scale))
+		return "a vertex not as far from both sites of an edge";
+	}
+    }
+    for (int vertex=0; vertex<header.vertexCount; vertex++) {
+	if (!used[vertex])
+	    return "a vertex no edge ends at";
+    }
+    return NULL;
+} // }}}
+
+int main(int argc, char **argv)
+{ // {{{
+    bool quiet = false;
+    int argi = 1;
+    if (argi < argc && strcmp(argv[argi], "-q") == 0) {
+	quiet = true;
+	argi++;
+    }
+    if (argi >= argc) {
+	fprintf(stderr, "Usage: %s [-q] file...\n", argv[0]);
+	return 2;
+    }
+
+    int failed = 0;
+    for (; argi<argc; argi++) {
+	VoronoiFileReader reader;
+	errno = 0;
+	if (!reader.open(argv[argi])) {
+	    fprintf(stderr, "%s: %s\n", argv[argi], (reader.getError() != NULL)
+		    ? reader.getError() : strerror(errno));
+	    failed++;
+	    continue;
+	}
+
+	const char *error = NULL;
+	if (!reader.validate())
+	    error = reader.getError();
+	else
+	    error = checkGeometry(reader);
+	if (error != NULL) {
+	    fprintf(stderr, "%s: %s\n", argv[argi], error);
+	    failed++;
+	} else if (!quiet) {
+	    const VoronoiFileHeader &header = reader.getHeader();
+	    printf("%s: version %u, %d sites, %d vertices, %d edges%s: ok\n",
+		    argv[argi], header.version, header.siteCount,
+		    header.vertexCount, header.edgeCount,
+		    reader.hasAdjacency() ? ", adjacency" : "");
+	}
+    }
+    return (failed == 0) ? 0 : 1;
+} // }}}
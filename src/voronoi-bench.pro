@@ -0,0 +1,13 @@
+######################################################################
+# Micro-benchmark of the vector kernels, built without the Qt library
+######################################################################
+
+TEMPLATE = app
+CONFIG -= qt
+CONFIG += console warn_on release
+TARGET = voronoi-bench
+INCLUDEPATH += .
+
+# Input
+HEADERS += clipper.h diagram.h arena.h
+SOURCES += bench.cpp clipper.cpp
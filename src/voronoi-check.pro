@@ -0,0 +1,15 @@
+######################################################################
+# Regression checks of the engines and the editor (see tests/check.sh),
+# built without the Qt library
+######################################################################
+
+TEMPLATE = app
+CONFIG -= qt
+CONFIG += console warn_on release
+TARGET = voronoi-check
+INCLUDEPATH += .
+
+include(core.pri)
+
+# Input
+SOURCES += check.cpp
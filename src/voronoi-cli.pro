@@ -0,0 +1,14 @@
+######################################################################
+# Headless command-line driver, built without the Qt library
+######################################################################
+
+TEMPLATE = app
+CONFIG -= qt
+CONFIG += console warn_on release
+TARGET = voronoi-cli
+INCLUDEPATH += .
+
+include(core.pri)
+
+# Input
+SOURCES += cli.cpp
@@ -0,0 +1,13 @@
+######################################################################
+# Packer of binary diagram files, built without the Qt library
+######################################################################
+
+TEMPLATE = app
+CONFIG -= qt
+CONFIG += console warn_on release
+TARGET = voronoi-pack
+INCLUDEPATH += .
+
+# Input
+HEADERS += diagfile.h packer.h
+SOURCES += pack.cpp packer.cpp diagfile.cpp
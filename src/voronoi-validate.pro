@@ -0,0 +1,13 @@
+######################################################################
+# Checker of binary diagram files, built without the Qt library
+######################################################################
+
+TEMPLATE = app
+CONFIG -= qt
+CONFIG += console warn_on release
+TARGET = voronoi-validate
+INCLUDEPATH += .
+
+# Input
+HEADERS += diagfile.h
+SOURCES += validate.cpp diagfile.cpp
@@ -1,22 +1,20 @@
-######################################################################
-# Automatically generated by qmake (1.07a) ??? ??? 25 21:43:35 2004
-######################################################################
-
-TEMPLATE = app
-INCLUDEPATH += .
-
-# Input
-RC_FILE = app.rc
-HEADERS += algorithm.h \
-           convex.h \
-           geometry.h \
-           inputdialog.ui.h \
-           mainwindow.h \
-           tooltip.h
-INTERFACES += inputdialog.ui
-SOURCES += algorithm.cpp \
-           convex.cpp \
-           geometry.cpp \
-           main.cpp \
-           mainwindow.cpp \
-           tooltip.cpp
+######################################################################
+# Automatically generated by qmake (1.07a) ??? ??? 25 21:43:35 2004
+######################################################################
+
+TEMPLATE = app
+INCLUDEPATH += .
+
+include(core.pri)
+
+# Input
+RC_FILE = app.rc
+HEADERS += geometry.h \
+           inputdialog.ui.h \
+           mainwindow.h \
+           tooltip.h
+INTERFACES += inputdialog.ui
+SOURCES += geometry.cpp \
+           main.cpp \
+           mainwindow.cpp \
+           tooltip.cpp